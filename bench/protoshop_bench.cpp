@@ -0,0 +1,601 @@
+// protoshop_bench：文档相关热点路径的基准测试（QtTest QBENCHMARK）
+// 无显示环境下默认使用 offscreen 平台。结果可用 QtTest 的输出参数导出为机器可读格式，例如
+//   protoshop_bench -o results.xml,xml -o -,txt
+//   protoshop_bench -o results.csv,csv
+// CMake 中的 run_protoshop_bench 目标会同时写出 XML 和 CSV。
+#include <QtTest>
+#include <QApplication>
+#include <QBuffer>
+#include <QTemporaryFile>
+#include <QDir>
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <QUndoStack>
+#include "common.h"
+#include "itemstate.h"
+#include "canvasscene.h"
+#include "documentio.h"
+#include "strokefitting.h"
+#include "livestrokeitem.h"
+#include "scenegenerator.h"
+#include "documentloader.h"
+#include "tiledexport.h"
+#include "customview.h"
+#include "transformablepathitem.h"
+#include "transformablecurveitem.h"
+#include "undocommands.h"
+
+static QJsonArray makeDocument(int count)
+{
+    QJsonArray doc;
+    SceneGeneratorOptions opt;
+    opt.setUniformMix(count);
+    for (const ItemState &st : generateScene(opt))
+        doc.append(itemStateToJson(st));
+    return doc;
+}
+
+// 随机游走的笔画采样点
+static QPolygonF makeStroke(int count)
+{
+    QRandomGenerator rng(7);
+    QPolygonF points;
+    points.reserve(count);
+    QPointF p(0, 0);
+    for (int i = 0; i < count; ++i) {
+        p += QPointF(rng.bounded(4.0) - 1.0, rng.bounded(4.0) - 2.0);
+        points << p;
+    }
+    return points;
+}
+
+class ProtoshopBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void itemToJson_data() { sceneSizes(); }
+    void itemToJson();
+    void jsonToItem_data() { sceneSizes(); }
+    void jsonToItem();
+    void captureSceneState_data() { sceneSizes(); }
+    void captureSceneState();
+    void undoRedo_data();
+    void undoRedo();
+    void broadcastMouseMove_data();
+    void broadcastMouseMove();
+    void penStrokeAppend_data() { strokeSizes(); }
+    void penStrokeAppend();
+    void penStrokeFit_data() { strokeSizes(); }
+    void penStrokeFit();
+    void renderToPng_data() { sceneSizes(); }
+    void renderToPng();
+    void zoomedOutPaint_data();
+    void zoomedOutPaint();
+    void polygonVertexDrag_data();
+    void polygonVertexDrag();
+    void curvePointDrag_data();
+    void curvePointDrag();
+    void strokeHitTest_data() { strokeSizes(); }
+    void strokeHitTest();
+    void partialStrokeRepaint_data() { strokeSizes(); }
+    void partialStrokeRepaint();
+    void cachedRepaint_data();
+    void cachedRepaint();
+    void tiledExport_data();
+    void tiledExport();
+    void openDocument_data();
+    void openDocument();
+    void progressiveOpen_data() { openDocument_data(); }
+    void progressiveOpen();
+    void progressiveFirstBatch_data() { openDocument_data(); }
+    void progressiveFirstBatch();
+
+private:
+    static void sceneSizes();
+    static void strokeSizes();
+};
+
+void ProtoshopBench::sceneSizes()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("100") << 100;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void ProtoshopBench::strokeSizes()
+{
+    QTest::addColumn<int>("points");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+}
+
+void ProtoshopBench::itemToJson()
+{
+    QFETCH(int, count);
+    CanvasScene scene;
+    loadDocumentInto(makeDocument(count), &scene);
+    const QList<QGraphicsItem*> items = scene.items();
+
+    QBENCHMARK {
+        QJsonArray array;
+        for (QGraphicsItem *it : items)
+            array.append(::itemToJson(it));
+    }
+}
+
+void ProtoshopBench::jsonToItem()
+{
+    QFETCH(int, count);
+    const QJsonArray doc = makeDocument(count);
+
+    QBENCHMARK {
+        QList<QGraphicsItem*> items;
+        items.reserve(count);
+        for (const QJsonValue &v : doc)
+            items.append(::jsonToItem(v.toObject(), nullptr));
+        qDeleteAll(items);
+    }
+}
+
+// 编辑开始前记录图元状态（取代原来的整场景快照）
+void ProtoshopBench::captureSceneState()
+{
+    QFETCH(int, count);
+    CanvasScene scene;
+    loadDocumentInto(makeDocument(count), &scene);
+    const QList<QGraphicsItem*> items = scene.items();
+
+    QBENCHMARK {
+        QHash<QGraphicsItem*, ItemState> states;
+        states.reserve(items.size());
+        for (QGraphicsItem *it : items)
+            states.insert(it, captureItemState(it));
+    }
+}
+
+void ProtoshopBench::undoRedo_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<QString>("command");
+    for (const QString &command : {QString("delete"), QString("move")}) {
+        QTest::newRow(qPrintable("100:" + command)) << 100 << command;
+        QTest::newRow(qPrintable("10k:" + command)) << 10000 << command;
+        QTest::newRow(qPrintable("100k:" + command)) << 100000 << command;
+    }
+}
+
+// 撤销再重做一次编辑（取代原来按快照恢复整个场景），改动的是堆叠中部的 10 个图元
+void ProtoshopBench::undoRedo()
+{
+    QFETCH(int, count);
+    QFETCH(QString, command);
+    CanvasScene scene;
+    loadDocumentInto(makeDocument(count), &scene);
+    QList<QGraphicsItem*> items;
+    for (QGraphicsItem *item : scene.items(Qt::AscendingOrder))
+        if (dynamic_cast<ItemCommon*>(item))
+            items.append(item);
+    QList<QGraphicsItem*> edited;
+    for (int i = 0; i < 10; ++i)
+        edited.append(items[items.size() / 2 + i * (items.size() / 40)]);
+
+    QUndoStack stack;
+    if (command == "delete") {
+        stack.push(new RemoveItemsCommand(&scene, edited));
+    } else {
+        QList<MoveItemsCommand::Entry> entries;
+        for (QGraphicsItem *item : std::as_const(edited))
+            entries.append({item, item->pos(), item->pos() + QPointF(37, -21)});
+        stack.push(new MoveItemsCommand(entries));
+    }
+
+    QBENCHMARK {
+        stack.undo();
+        stack.redo();
+    }
+}
+
+void ProtoshopBench::broadcastMouseMove_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("selected");
+    QTest::newRow("100:0") << 100 << 0;
+    QTest::newRow("10k:0") << 10000 << 0;
+    QTest::newRow("100k:0") << 100000 << 0;
+    QTest::newRow("10k:100") << 10000 << 100;
+}
+
+// 选择工具下无按键移动鼠标，走完整的 CustomView::mouseMoveEvent
+void ProtoshopBench::broadcastMouseMove()
+{
+    QFETCH(int, count);
+    QFETCH(int, selected);
+    CustomView view;
+    CanvasScene scene;
+    view.setScene(&scene);
+    view.resize(800, 600);
+    loadDocumentInto(makeDocument(count), &scene);
+    const QList<QGraphicsItem*> items = scene.items();
+    for (int i = 0; i < selected && i < items.size(); ++i)
+        items[i]->setSelected(true);
+
+    QBENCHMARK {
+        for (int i = 0; i < 100; ++i) {
+            const QPointF pos(4 * i + 10, 3 * i + 10);
+            QMouseEvent ev(QEvent::MouseMove, pos, view.viewport()->mapToGlobal(pos),
+                           Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+            QCoreApplication::sendEvent(view.viewport(), &ev);
+        }
+    }
+}
+
+void ProtoshopBench::penStrokeAppend()
+{
+    QFETCH(int, points);
+    const QPolygonF stroke = makeStroke(points);
+    CanvasScene scene;
+
+    QBENCHMARK {
+        auto *live = new LiveStrokeItem(stroke.first(), QPen(Qt::black, 2));
+        scene.addItem(live);
+        for (qsizetype i = 1; i < stroke.size(); ++i)
+            live->appendPoint(stroke[i]);
+        scene.removeItem(live);
+        delete live;
+    }
+}
+
+// 松开鼠标时的简化与曲线拟合
+void ProtoshopBench::penStrokeFit()
+{
+    QFETCH(int, points);
+    const QPolygonF stroke = makeStroke(points);
+
+    QBENCHMARK {
+        const QPainterPath path = smoothStroke(stroke, 1.0);
+        Q_UNUSED(path);
+    }
+}
+
+void ProtoshopBench::renderToPng()
+{
+    QFETCH(int, count);
+    CanvasScene scene;
+    loadDocumentInto(makeDocument(count), &scene);
+    // 大场景只渲染一块固定大小的区域，避免测试内存随场景线性增长
+    const QRectF source = scene.itemsBoundingRect() & QRectF(0, 0, 4096, 4096);
+
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        renderScene(&scene, source).save(&buffer, "PNG");
+    }
+}
+
+void ProtoshopBench::zoomedOutPaint_data()
+{
+    QTest::addColumn<int>("items");
+    QTest::addColumn<int>("points");
+    QTest::newRow("10x10k") << 10 << 10000;
+    QTest::newRow("100x1k") << 100 << 1000;
+}
+
+// 把密集的笔画和多边形整体缩小画进一张 512x512 的图（相当于缩小到全图时重绘视图），走 LOD 路径
+void ProtoshopBench::zoomedOutPaint()
+{
+    QFETCH(int, items);
+    QFETCH(int, points);
+    SceneGeneratorOptions opt;
+    opt.pathCount = items;
+    opt.polygonCount = items;
+    opt.strokePointsMin = opt.strokePointsMax = points;
+    opt.polygonVerticesMin = opt.polygonVerticesMax = points;
+    opt.sizeMin = 2000;
+    opt.sizeMax = 4000;
+    CanvasScene scene;
+    loadDocumentInto(generateScene(opt), &scene);
+    const QRectF source = scene.itemsBoundingRect();
+    QImage image(512, 512, QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        scene.render(&painter, image.rect(), source);
+    }
+}
+
+void ProtoshopBench::polygonVertexDrag_data()
+{
+    QTest::addColumn<int>("vertices");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("100k") << 100000;
+}
+
+// 选中一个顶点很多的多边形，命中最后一个顶点后拖动 100 次
+void ProtoshopBench::polygonVertexDrag()
+{
+    QFETCH(int, vertices);
+    QPolygonF poly;
+    poly.reserve(vertices);
+    for (int i = 0; i < vertices; ++i) {
+        const qreal a = 2 * M_PI * i / vertices;
+        poly << QPointF(5000 + 4000 * qCos(a), 5000 + 4000 * qSin(a));
+    }
+    CanvasScene scene;
+    auto *item = new TransformablePolygonItem(poly);
+    scene.addItem(item);
+    item->setSelected(true);
+    const QPointF last = poly.last();
+
+    QBENCHMARK {
+        const int handle = item->handleAt(last);
+        QVERIFY(handle != 0);
+        item->beginHandleDrag(handle, last);
+        for (int i = 1; i <= 100; ++i)
+            item->dragHandle(last - QPointF(i, i));
+        item->dragHandle(last);
+        item->endHandleDrag();
+    }
+}
+
+void ProtoshopBench::curvePointDrag_data()
+{
+    QTest::addColumn<int>("segments");
+    QTest::newRow("100") << 100;
+    QTest::newRow("1k") << 1000;
+}
+
+// 选中一条很多段的贝塞尔曲线，拖动中间的锚点 100 次，每次拖动后做一次点选（触发重新展平）
+void ProtoshopBench::curvePointDrag()
+{
+    QFETCH(int, segments);
+    QPolygonF points;
+    points << QPointF(0, 0);
+    for (int s = 0; s < segments; ++s) {
+        const qreal x = 30.0 * s;
+        points << QPointF(x + 10, -20) << QPointF(x + 20, 20) << QPointF(x + 30, 0);
+    }
+    CanvasScene scene;
+    auto *item = new TransformableCurveItem(points);
+    scene.addItem(item);
+    item->setSelected(true);
+    const QPointF anchor = points.at(3 * (segments / 2));
+
+    QBENCHMARK {
+        const int handle = item->handleAt(anchor);
+        QVERIFY(handle != 0);
+        item->beginHandleDrag(handle, anchor);
+        for (int i = 1; i <= 100; ++i) {
+            item->dragHandle(anchor + QPointF(0, i));
+            item->contains(anchor);
+        }
+        item->dragHandle(anchor);
+        item->endHandleDrag();
+    }
+}
+
+// 长笔画上 1000 次点选和 100 次框选（精确形状，走线段 BVH）
+void ProtoshopBench::strokeHitTest()
+{
+    QFETCH(int, points);
+    const QPolygonF stroke = makeStroke(points);
+    QPainterPath path(stroke.first());
+    for (int i = 1; i < stroke.size(); ++i)
+        path.lineTo(stroke.at(i));
+    TransformablePathItem item(path);
+    const QRectF bounds = item.tightBoundingRect();
+
+    QRandomGenerator rng(11);
+    QList<QPointF> probes;
+    for (int i = 0; i < 1000; ++i)
+        probes << QPointF(bounds.left() + rng.bounded(bounds.width()),
+                          bounds.top() + rng.bounded(bounds.height()));
+
+    QBENCHMARK {
+        int hits = 0;
+        for (const QPointF &p : std::as_const(probes))
+            hits += item.contains(p);
+        for (int i = 0; i < 100; ++i) {
+            QPainterPath area;
+            area.addRect(QRectF(probes.at(i), QSizeF(20, 20)));
+            hits += item.collidesWithPath(area);
+        }
+        Q_UNUSED(hits)
+    }
+}
+
+// 长笔画只有起点附近 200x200 的区域需要重绘
+void ProtoshopBench::partialStrokeRepaint()
+{
+    QFETCH(int, points);
+    const QPolygonF stroke = makeStroke(points);
+    QPainterPath path(stroke.first());
+    for (int i = 1; i < stroke.size(); ++i)
+        path.lineTo(stroke.at(i));
+    CanvasScene scene;
+    auto *item = new TransformablePathItem(path);
+    item->setPen(QPen(Qt::black, 2));
+    scene.addItem(item);
+    const QRectF source(stroke.first() - QPointF(100, 100), QSizeF(200, 200));
+    QImage image(200, 200, QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        scene.render(&painter, image.rect(), source);
+    }
+}
+
+void ProtoshopBench::cachedRepaint_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("no cache") << false;
+    QTest::newRow("render cache") << true;
+}
+
+// 密集笔画、多边形和宽虚线图元在 800x600 的视图中整屏重绘，对比开启绘制缓存前后
+void ProtoshopBench::cachedRepaint()
+{
+    QFETCH(bool, cached);
+    SceneGeneratorOptions opt;
+    opt.pathCount = 100;
+    opt.polygonCount = 100;
+    opt.rectCount = 200;
+    opt.strokePointsMin = opt.strokePointsMax = 2000;
+    opt.polygonVerticesMin = opt.polygonVerticesMax = 500;
+    CustomView view;
+    CanvasScene scene;
+    scene.renderCache()->setBudget(cached ? RenderCache::DEFAULT_BUDGET : 0);
+    view.setScene(&scene);
+    view.resize(800, 600);
+    loadDocumentInto(generateScene(opt), &scene);
+    view.centerOn(scene.itemsBoundingRect().center());
+    // 绘制后在事件循环里才按最近使用分配缓存，先画一帧让缓存就位
+    view.viewport()->grab();
+    QCoreApplication::processEvents();
+    if (cached) {
+        QVERIFY(scene.renderCache()->cachedCount() > 0);
+        QVERIFY(scene.renderCache()->usedBytes() <= scene.renderCache()->budget());
+    } else {
+        QCOMPARE(scene.renderCache()->cachedCount(), 0);
+    }
+
+    QBENCHMARK {
+        view.viewport()->grab();
+    }
+}
+
+void ProtoshopBench::tiledExport_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<int>("threads");
+    const int cores = qMax(1, QThread::idealThreadCount());
+    for (int count : {10000, 100000}) {
+        const QByteArray size = QByteArray::number(count / 1000) + "k";
+        QTest::newRow(size + ":1 thread") << count << 1;
+        QTest::newRow(size + ":" + QByteArray::number(cores) + " threads") << count << cores;
+    }
+}
+
+// 与 renderToPng 相同的区域，走分块并行导出
+void ProtoshopBench::tiledExport()
+{
+    QFETCH(int, count);
+    QFETCH(int, threads);
+    SceneGeneratorOptions opt;
+    opt.setUniformMix(count);
+    const QList<ItemState> states = generateScene(opt);
+    ExportOptions options;
+    options.source = itemStatesBounds(states) & QRectF(0, 0, 4096, 4096);
+    options.threads = threads;
+    QTemporaryFile file(QDir::tempPath() + "/protoshop_bench_XXXXXX.png");
+    QVERIFY(file.open());
+    file.close();
+
+    QBENCHMARK {
+        QVERIFY(exportTiledPng(file.fileName(), states, options));
+    }
+}
+
+void ProtoshopBench::openDocument_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<QString>("suffix");
+    for (int count : {100, 10000, 100000}) {
+        const QByteArray size = count >= 1000 ? QByteArray::number(count / 1000) + "k"
+                                              : QByteArray::number(count);
+        QTest::newRow(size + ":json") << count << "json";
+        QTest::newRow(size + ":psb") << count << "psb";
+    }
+}
+
+// onOpen() 去掉文件对话框后的部分：读文件、解析、载入场景
+void ProtoshopBench::openDocument()
+{
+    QFETCH(int, count);
+    QFETCH(QString, suffix);
+    QTemporaryFile file(QDir::tempPath() + "/protoshop_bench_XXXXXX." + suffix);
+    QVERIFY(file.open());
+    file.close();
+    SceneGeneratorOptions opt;
+    opt.setUniformMix(count);
+    QVERIFY(writeDocumentStates(file.fileName(), generateScene(opt)));
+
+    QBENCHMARK {
+        QList<ItemState> states;
+        QVERIFY(readDocumentStates(file.fileName(), &states));
+        CanvasScene scene;
+        loadDocumentInto(states, &scene);
+    }
+}
+
+// 后台分批载入的完整时间
+void ProtoshopBench::progressiveOpen()
+{
+    QFETCH(int, count);
+    QFETCH(QString, suffix);
+    QTemporaryFile file(QDir::tempPath() + "/protoshop_bench_XXXXXX." + suffix);
+    QVERIFY(file.open());
+    file.close();
+    SceneGeneratorOptions opt;
+    opt.setUniformMix(count);
+    QVERIFY(writeDocumentStates(file.fileName(), generateScene(opt)));
+
+    QBENCHMARK {
+        CanvasScene scene;
+        DocumentLoader loader(&scene);
+        QEventLoop loop;
+        connect(&loader, &DocumentLoader::finished, &loop, &QEventLoop::quit);
+        QVERIFY(loader.start(file.fileName(), QRectF(0, 0, 1920, 1080)));
+        loop.exec();
+    }
+}
+
+// 从开始载入到第一批图元加入场景的时间，要求在 1 秒以内。
+// 只测一次（首批出现后就取消载入），结果以毫秒报告
+void ProtoshopBench::progressiveFirstBatch()
+{
+    QFETCH(int, count);
+    QFETCH(QString, suffix);
+    QTemporaryFile file(QDir::tempPath() + "/protoshop_bench_XXXXXX." + suffix);
+    QVERIFY(file.open());
+    file.close();
+    SceneGeneratorOptions opt;
+    opt.setUniformMix(count);
+    QVERIFY(writeDocumentStates(file.fileName(), generateScene(opt)));
+
+    CanvasScene scene;
+    DocumentLoader loader(&scene);
+    QEventLoop loop;
+    QElapsedTimer clock;
+    qint64 firstBatch = -1;
+    connect(&loader, &DocumentLoader::itemsAdded, &loop, [&] {
+        if (firstBatch < 0) firstBatch = clock.nsecsElapsed();
+        loader.cancel();
+    });
+    connect(&loader, &DocumentLoader::finished, &loop, &QEventLoop::quit);
+    clock.start();
+    QVERIFY(loader.start(file.fileName(), QRectF(0, 0, 1920, 1080)));
+    loop.exec();
+
+    QVERIFY(firstBatch >= 0);
+    const qreal msecs = firstBatch / 1e6;
+    QVERIFY2(msecs < 1000, qPrintable(QString("first batch after %1 ms").arg(msecs)));
+    QTest::setBenchmarkResult(msecs, QTest::WalltimeMilliseconds);
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    ProtoshopBench bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "protoshop_bench.moc"
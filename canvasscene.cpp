@@ -0,0 +1,238 @@
+#include "canvasscene.h"
+#include "selectionoverlay.h"
+#include <algorithm>
+
+CanvasScene::CanvasScene(QObject *parent)
+    : QGraphicsScene(parent)
+{
+    m_overlay = new SelectionOverlay;
+    addItem(m_overlay);
+}
+
+void CanvasScene::subscribeMouse(QGraphicsItem *item)
+{
+    for (const MouseReceiver &r : std::as_const(m_mouseReceivers))
+        if (r.item == item) return;
+
+    auto *receiver = dynamic_cast<IMousePositionReceiver*>(item);
+    auto *common = dynamic_cast<ItemCommon*>(item);
+    if (!receiver || !common) return;
+    m_mouseReceivers.append({item, receiver, common});
+}
+
+void CanvasScene::unsubscribeMouse(QGraphicsItem *item)
+{
+    m_mouseReceivers.removeIf([item](const MouseReceiver &r) { return r.item == item; });
+}
+
+void CanvasScene::updateMouseSubscription(QGraphicsItem *item)
+{
+    auto *cs = qobject_cast<CanvasScene*>(item->scene());
+    if (!cs) return;
+
+    ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+    if (item->isSelected() || (common && common->isRotateHandling))
+        cs->subscribeMouse(item);
+    else
+        cs->unsubscribeMouse(item);
+}
+
+void CanvasScene::itemChanged(QGraphicsItem *item, QGraphicsItem::GraphicsItemChange change)
+{
+    switch (change) {
+    case QGraphicsItem::ItemSceneChange:
+        // 即将离开当前场景
+        if (auto *cs = qobject_cast<CanvasScene*>(item->scene())) {
+            cs->unsubscribeMouse(item);
+            cs->unindexItem(item);
+            cs->m_overlay->itemRemoved(item);
+            cs->m_renderCache.itemRemoved(item);
+        }
+        break;
+    case QGraphicsItem::ItemSceneHasChanged:
+        if (auto *cs = qobject_cast<CanvasScene*>(item->scene())) {
+            // Qt 把新加入的顶层图元放在同一 z 值的最上面，序号跟着递增
+            if (ItemCommon *common = dynamic_cast<ItemCommon*>(item))
+                common->stackOrder = cs->m_nextStackOrder++;
+            cs->reindexItem(item);
+            cs->m_overlay->itemSelectionChanged(item);
+            cs->m_renderCache.itemChanged(item);
+        }
+        updateMouseSubscription(item);
+        break;
+    case QGraphicsItem::ItemSelectedHasChanged:
+        if (auto *cs = qobject_cast<CanvasScene*>(item->scene()))
+            cs->m_overlay->itemSelectionChanged(item);
+        updateMouseSubscription(item);
+        break;
+    case QGraphicsItem::ItemPositionHasChanged:
+    case QGraphicsItem::ItemTransformHasChanged:
+    case QGraphicsItem::ItemRotationHasChanged:
+    case QGraphicsItem::ItemScaleHasChanged:
+    case QGraphicsItem::ItemTransformOriginPointHasChanged:
+        itemGeometryChanged(item);
+        break;
+    default:
+        break;
+    }
+}
+
+void CanvasScene::itemDestroyed(QGraphicsItem *item)
+{
+    // 场景析构时 qobject_cast 会失败，此时订阅表和索引已随场景一起释放
+    if (auto *cs = qobject_cast<CanvasScene*>(item->scene())) {
+        cs->unsubscribeMouse(item);
+        cs->unindexItem(item);
+        cs->m_overlay->itemRemoved(item);
+        cs->m_renderCache.itemRemoved(item, true);
+    }
+}
+
+void CanvasScene::itemGeometryChanged(QGraphicsItem *item)
+{
+    if (auto *cs = qobject_cast<CanvasScene*>(item->scene())) {
+        cs->reindexItem(item);
+        cs->m_overlay->itemGeometryChanged(item);
+        cs->m_renderCache.itemChanged(item);
+    }
+}
+
+void CanvasScene::itemRegionChanged(QGraphicsItem *item, const QRectF &localRect)
+{
+    // 包围盒没变，空间索引不用更新
+    if (auto *cs = qobject_cast<CanvasScene*>(item->scene())) {
+        cs->m_overlay->itemRegionChanged(item, localRect);
+        cs->m_renderCache.itemChanged(item);
+    }
+}
+
+void CanvasScene::noteRendered(const QRectF &rect)
+{
+    if (m_renderCache.isEmpty()) return;
+    if (!m_renderCache.touch(m_index.intersecting(rect)) || m_rebalanceQueued) return;
+    // 刚画过的图元没有缓存：等这一帧画完再按最近使用重新分配
+    m_rebalanceQueued = true;
+    QMetaObject::invokeMethod(this, [this] {
+        m_rebalanceQueued = false;
+        m_renderCache.rebalance();
+    }, Qt::QueuedConnection);
+}
+
+QRectF CanvasScene::indexRect(QGraphicsItem *item)
+{
+    ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+    const QRectF local = common ? common->tightBoundingRect() : item->boundingRect();
+    return item->sceneTransform().mapRect(local);
+}
+
+void CanvasScene::reindexItem(QGraphicsItem *item)
+{
+    // 只索引画布上的图形，绘制中的临时笔画等不参与
+    if (m_bulkLoading || !dynamic_cast<ItemCommon*>(item)) return;
+    m_index.update(item, indexRect(item));
+}
+
+void CanvasScene::unindexItem(QGraphicsItem *item)
+{
+    if (m_bulkLoading) return;
+    m_index.remove(item);
+}
+
+void CanvasScene::beginBulkLoad()
+{
+    m_bulkLoading = true;
+}
+
+void CanvasScene::endBulkLoad()
+{
+    m_bulkLoading = false;
+    QList<QPair<QGraphicsItem*, QRectF>> entries;
+    const QList<QGraphicsItem*> all = items();
+    entries.reserve(all.size());
+    for (QGraphicsItem *item : all)
+        if (dynamic_cast<ItemCommon*>(item))
+            entries.append({item, indexRect(item)});
+    m_index.bulkLoad(entries);
+}
+
+bool CanvasScene::stackedAbove(QGraphicsItem *a, QGraphicsItem *b)
+{
+    if (a->zValue() != b->zValue())
+        return a->zValue() > b->zValue();
+    ItemCommon *ca = dynamic_cast<ItemCommon*>(a);
+    ItemCommon *cb = dynamic_cast<ItemCommon*>(b);
+    return ca && cb && ca->stackOrder > cb->stackOrder;
+}
+
+void CanvasScene::restoreItems(const QList<QGraphicsItem*> &items, const QList<quint64> &stackOrders)
+{
+    Q_ASSERT(items.size() == stackOrders.size());
+    QList<QPair<quint64, QGraphicsItem*>> restored;
+    restored.reserve(items.size());
+    for (qsizetype i = 0; i < items.size(); ++i)
+        restored.append({stackOrders[i], items[i]});
+    std::sort(restored.begin(), restored.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    if (restored.isEmpty()) return;
+
+    // 每个放回的图元在场景现有图元中的后继：堆叠序号比它大的图元里最小的一个
+    QList<QGraphicsItem*> successors(restored.size(), nullptr);
+    const QList<QGraphicsItem*> live = m_bulkLoading ? this->items() : m_index.values();
+    for (QGraphicsItem *item : live) {
+        ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+        if (!common || item->parentItem()) continue;
+        auto slot = std::upper_bound(restored.cbegin(), restored.cend(), common->stackOrder,
+                                     [](quint64 order, const auto &r) { return order < r.first; });
+        if (slot == restored.cbegin()) continue;
+        QGraphicsItem *&succ = successors[std::prev(slot) - restored.cbegin()];
+        if (!succ || common->stackOrder < dynamic_cast<ItemCommon*>(succ)->stackOrder)
+            succ = item;
+    }
+    // 上面只在到下一个放回的图元为止的区间内找，区间内没有现有图元时沿用下一个放回图元的后继
+    for (qsizetype i = restored.size() - 2; i >= 0; --i)
+        if (!successors[i])
+            successors[i] = successors[i + 1];
+    // 同一个后继下面的图元按序号从小到大逐个放在后继正下方，相对顺序保持不变
+    for (qsizetype i = 0; i < restored.size(); ++i) {
+        QGraphicsItem *item = restored[i].second;
+        addItem(item);
+        if (ItemCommon *common = dynamic_cast<ItemCommon*>(item))
+            common->stackOrder = restored[i].first;
+        if (successors[i])
+            item->stackBefore(successors[i]);
+    }
+}
+
+QList<QGraphicsItem*> CanvasScene::indexedItemsAt(const QPointF &pos) const
+{
+    QList<QGraphicsItem*> result;
+    for (QGraphicsItem *item : m_index.containing(pos))
+        if (item->contains(item->mapFromScene(pos)))
+            result.append(item);
+    std::sort(result.begin(), result.end(), stackedAbove);
+    return result;
+}
+
+QList<QGraphicsItem*> CanvasScene::indexedItems(const QRectF &rect, Qt::ItemSelectionMode mode) const
+{
+    QList<QGraphicsItem*> candidates = m_index.intersecting(rect);
+    if (mode == Qt::IntersectsItemBoundingRect) return candidates;
+
+    QPainterPath area;
+    area.addRect(rect);
+    QList<QGraphicsItem*> result;
+    for (QGraphicsItem *item : std::as_const(candidates)) {
+        if (mode == Qt::ContainsItemBoundingRect) {
+            if (rect.contains(indexRect(item))) result.append(item);
+        } else if (item->collidesWithPath(item->mapFromScene(area), mode)) {
+            result.append(item);
+        }
+    }
+    return result;
+}
+
+QGraphicsItem *CanvasScene::nearestItem(const QPointF &pos, qreal maxDistance) const
+{
+    const QList<QGraphicsItem*> hits = m_index.nearest(pos, 1, maxDistance);
+    return hits.isEmpty() ? nullptr : hits.first();
+}
@@ -0,0 +1,85 @@
+#ifndef CANVASSCENE_H
+#define CANVASSCENE_H
+
+#include <QGraphicsScene>
+#include <QList>
+#include "common.h"
+#include "rtree.h"
+#include "rendercache.h"
+
+class SelectionOverlay;
+
+// 画布场景：在 QGraphicsScene 的基础上维护画布级别的数据
+class CanvasScene : public QGraphicsScene
+{
+    Q_OBJECT
+public:
+    explicit CanvasScene(QObject *parent = nullptr);
+
+    // 鼠标坐标广播的订阅者。只有选中或正在旋转的图元需要接收广播，
+    // 图元在选中状态变化、旋转开始结束时加入或退出订阅
+    struct MouseReceiver {
+        QGraphicsItem *item;
+        IMousePositionReceiver *receiver;
+        ItemCommon *common;
+    };
+    const QList<MouseReceiver> &mouseReceivers() const { return m_mouseReceivers; }
+    void subscribeMouse(QGraphicsItem *item);
+    void unsubscribeMouse(QGraphicsItem *item);
+
+    // 根据图元当前的选中、旋转状态更新其在所在场景中的订阅
+    static void updateMouseSubscription(QGraphicsItem *item);
+    // 供图元在 itemChange()、析构函数以及形状变化后调用
+    static void itemChanged(QGraphicsItem *item, QGraphicsItem::GraphicsItemChange change);
+    static void itemDestroyed(QGraphicsItem *item);
+    static void itemGeometryChanged(QGraphicsItem *item);
+    // 形状只在 localRect（图元坐标）内变化、紧凑包围盒不变时代替 itemGeometryChanged() 调用
+    static void itemRegionChanged(QGraphicsItem *item, const QRectF &localRect);
+
+    // 空间索引：按图元的紧凑包围盒（不含控制点，场景坐标）建立的 R 树，
+    // 用于点选、框选和填色工具
+    // pos 处的图元，按堆叠顺序从上到下，并按 shape() 精确判断
+    QList<QGraphicsItem*> indexedItemsAt(const QPointF &pos) const;
+    // 与 rect 相交的图元（不排序）
+    QList<QGraphicsItem*> indexedItems(const QRectF &rect,
+                                       Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const;
+    // 离 pos 最近的图元（按包围盒距离），maxDistance 内没有则返回 nullptr
+    QGraphicsItem *nearestItem(const QPointF &pos, qreal maxDistance) const;
+    // 批量载入期间不做增量更新，结束时整体重建索引
+    void beginBulkLoad();
+    void endBulkLoad();
+    // 图元在场景坐标中的紧凑包围盒
+    static QRectF indexRect(QGraphicsItem *item);
+    // a 是否叠在 b 上面：先比较 z 值，z 值相同时比较加入场景的先后（ItemCommon::stackOrder）
+    static bool stackedAbove(QGraphicsItem *a, QGraphicsItem *b);
+    // 把移出场景的图元按原来的堆叠序号 stackOrders 放回原来的位置（撤销删除时使用）：
+    // 序号比场景中所有图元都大的直接加到最上面，否则用 stackBefore() 叠到紧挨着的图元下面
+    void restoreItems(const QList<QGraphicsItem*> &items, const QList<quint64> &stackOrders);
+    // item 是否是本场景中的图元。按空间索引判断，不访问 item（item 可能已经释放），批量载入期间除外
+    bool containsItem(QGraphicsItem *item) const {
+        return m_bulkLoading ? item->scene() == this : m_index.contains(item);
+    }
+    // 所有已索引图元的外包矩形，直接取自 R 树根结点，不遍历图元
+    QRectF itemsBounds() const { return m_index.bounds(); }
+
+    // 绘制选中图元控制点的覆盖层，随场景创建
+    SelectionOverlay *selectionOverlay() const { return m_overlay; }
+    // 开销大的图元的绘制缓存
+    RenderCache *renderCache() { return &m_renderCache; }
+    // 视图重绘了场景中的 rect 区域，其中的图元记为最近绘制
+    void noteRendered(const QRectF &rect);
+
+private:
+    void reindexItem(QGraphicsItem *item);
+    void unindexItem(QGraphicsItem *item);
+
+    QList<MouseReceiver> m_mouseReceivers;
+    RTree<QGraphicsItem*> m_index;
+    bool m_bulkLoading = false;
+    quint64 m_nextStackOrder = 1; // 下一个加入场景的图元的堆叠序号
+    SelectionOverlay *m_overlay = nullptr;
+    RenderCache m_renderCache;
+    bool m_rebalanceQueued = false; // 已安排在这一帧绘制结束后重新分配绘制缓存
+};
+
+#endif // CANVASSCENE_H
@@ -6,6 +6,12 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QGraphicsItem>
+#include <QCursor>
+#include <QPainterPath>
+#include <QPen>
+#include <array>
+
+class QPainter;
 
 #define PRECISION 0.0001
 
@@ -21,25 +27,115 @@ public:
     virtual void receiveSceneMousePosition(const QPointF &scenePos, const MouseLeftClickStatus mouseLeftClickStatus) = 0;
 };
 
+// 图元的派生几何：各图元只在形状变化（setRect / setLine / setPolygon / setPath）时重新计算，
+// 包围盒、命中测试、绘制控制点和旋转广播都直接读取，不再每次从形状推算
+struct HandleGeometry {
+    QRectF bounds;                  // 形状本身的包围盒（不含线宽）
+    QPointF center;                 // 旋转中心
+    QPointF rotateAnchor;           // 旋转控制点连线的起点
+    QPointF rotateHandle;           // 旋转控制点的中心
+    std::array<QRectF, 4> handles;  // 缩放 / 端点控制点，前 handleCount 个有效
+    int handleCount = 0;
+
+    // 第一个包含 pos 的缩放 / 端点控制点的下标，没有时返回 -1
+    int handleIndexAt(const QPointF &pos) const {
+        for (int i = 0; i < handleCount; ++i)
+            if (handles[i].contains(pos)) return i;
+        return -1;
+    }
+};
+
 //
 class ItemCommon {
 public:
+    virtual ~ItemCommon() = default;
+    // 不含控制点的紧凑包围盒（图形外扩半个线宽或 hitPadding()，item 坐标），用于空间索引
+    virtual QRectF tightBoundingRect() const = 0;
+
+    // 控制点：由 SelectionOverlay 统一绘制和命中测试，图元的 boundingRect() 不包含控制点。
+    // 坐标均为 item 坐标，控制点编号由各图元自己定义，0 表示不在控制点上。
+    // 控制点用 0 宽（cosmetic）画笔描边，线宽和尺寸一样不随视图缩放变化
+    virtual void paintHandles(QPainter *painter) const = 0;
+    virtual int handleAt(const QPointF &pos) const = 0;
+    virtual Qt::CursorShape handleCursor(int handle) const = 0;
+    // 拖动缩放 / 节点控制点；旋转控制点仍通过鼠标坐标广播处理
+    virtual void beginHandleDrag(int handle, const QPointF &pos) = 0;
+    virtual void dragHandle(const QPointF &pos) = 0;
+    virtual void endHandleDrag() = 0;
+    // 重新计算控制点位置：形状变化和 handleScale() 变化后调用
+    virtual void updateHandleGeometry() = 0;
+
+    // 控制点在屏幕上保持固定的像素大小：视图缩放后 CustomView 把它设为 1 / zoom，
+    // 控制点尺寸、旋转控制点偏移按它换算成 item 坐标下的长度
+    static qreal handleScale() { return s_handleScale; }
+    static void setHandleScale(qreal scale) { s_handleScale = scale; }
+    static qreal handleSize() { return HANDLE_SIZE * s_handleScale; }
+    static qreal rotateHandleOffset() { return ROTATE_HANDLE_OFFSET * s_handleScale; }
+    // 以 c 为中心的控制点方块
+    static QRectF handleRectAt(const QPointF &c) {
+        const qreal size = handleSize();
+        return QRectF(c.x() - size / 2, c.y() - size / 2, size, size);
+    }
+    // 点选容差：放大时按屏幕像素换算，缩小时不超过 HIT_TOLERANCE 个场景单位，
+    // 这样包围盒只需外扩固定的 HIT_TOLERANCE，不必随缩放变化
+    static qreal hitTolerance() {
+        return HIT_TOLERANCE * qMin(s_handleScale, qreal(1));
+    }
+    // 命中测试的半宽：细线也至少留出 hitTolerance()，方便点选
+    static qreal hitRadius(qreal penWidth) {
+        return qMax(penWidth / 2, hitTolerance());
+    }
+    // 任何缩放下 hitRadius() 的上限。按描边命中的图元（线段、多边形、曲线、任意画笔）
+    // 的包围盒按它外扩，保证 shape() 落在 boundingRect() 内、空间索引也覆盖点选容差
+    static qreal hitPadding(qreal penWidth) {
+        return qMax(penWidth / 2, qreal(HIT_TOLERANCE));
+    }
+    // path 按 pen 的端点、连接样式描边得到的实线轮廓，宽度为 2 * hitRadius，用作 shape()
+    static QPainterPath strokeShape(const QPainterPath &path, const QPen &pen) {
+        QPainterPathStroker stroker;
+        stroker.setWidth(2 * hitRadius(pen.widthF()));
+        stroker.setCapStyle(pen.capStyle());
+        stroker.setJoinStyle(pen.joinStyle());
+        stroker.setMiterLimit(pen.miterLimit());
+        return stroker.createStroke(path);
+    }
+    // 控制点可能占据的区域（紧凑包围盒外扩控制点大小和旋转控制点偏移）
+    QRectF handlesBoundingRect() const {
+        const qreal extra = handleSize() + rotateHandleOffset();
+        return tightBoundingRect().adjusted(-extra, -extra, extra, extra);
+    }
+
     // 是否处于旋转点
     bool isRotateHandle = false;
     // 是否正在旋转
     bool isRotateHandling = false;
-    // 控制点的大小
-    const int HANDLE_SIZE = 10;
-    // 旋转控制点距离顶部的偏移
-    const float ROTATE_HANDLE_OFFSET = 20;
+    // 控制点的大小（屏幕像素）
+    static constexpr int HANDLE_SIZE = 10;
+    // 旋转控制点距离顶部的偏移（屏幕像素）
+    static constexpr float ROTATE_HANDLE_OFFSET = 20;
+    // 点选时离笔画的最大距离（屏幕像素）
+    static constexpr int HIT_TOLERANCE = 3;
     // 图形属性
     QColor penColor = Qt::black;
     QColor brushColor = Qt::white; // 填充色
     int penWidth = 1; // 线宽
     Qt::PenStyle penStyle = Qt::SolidLine; // 画笔类型
+    // 序列化时写入 "id" 字段。
+    // ID 只在一篇文档内唯一，不同文档（例如各自从 1 编号的生成文档）的 ID 会重复，不能用来在文档之间对应图元
+    quint64 itemId = nextItemId();
+    // 同一 z 值下的堆叠先后，越大越靠上，与 Qt 的绘制顺序一致。加入 CanvasScene 时由场景分配
+    quint64 stackOrder = 0;
+
+    static quint64 nextItemId();
+    // 载入带 ID 的图元后调用，保证之后分配的 ID 不会与之冲突
+    static void reserveItemId(quint64 id);
+
+private:
+    static inline qreal s_handleScale = 1;
 };
 
 QJsonObject itemToJson(QGraphicsItem *item);
-void jsonToItem(const QJsonObject &obj, QGraphicsScene *scene);
+// 创建图元并加入 scene（scene 为空时只创建），返回新图元，类型未知时返回 nullptr
+QGraphicsItem *jsonToItem(const QJsonObject &obj, QGraphicsScene *scene);
 
 #endif // COMMON_H
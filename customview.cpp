@@ -8,6 +8,19 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QBuffer>
+#include <QSet>
+#include "undocommands.h"
+#include "canvasscene.h"
+#include "strokefitting.h"
+#include "documentio.h"
+#include "documentloader.h"
+#include "documentsaver.h"
+#include "tiledexport.h"
+#include <QProgressDialog>
+#include <QMessageBox>
+#include <QScrollBar>
+#include <QPixmapCache>
+#include <QtMath>
 
 CustomView::CustomView(QWidget *parent)
     : QGraphicsView(parent)
@@ -17,8 +30,20 @@ CustomView::CustomView(QWidget *parent)
     // setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     // setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setTransformationAnchor(QGraphicsView::NoAnchor);
-    undoStack.push(QJsonArray());
+    undoStack = new QUndoStack(this);
+    undoStack->setUndoLimit(maxUndoSteps);
+    m_saver = new DocumentSaver(this);
+    // 保存在后台进行，失败（磁盘已满、没有写权限等）时在这里提示
+    connect(m_saver, &DocumentSaver::saved, this, [this](const QString &fileName, bool ok) {
+        if (!ok)
+            QMessageBox::warning(this, "保存失败", QString("无法保存文档：%1").arg(fileName));
+    });
+    m_autosaver = new Autosaver(undoStack, this);
     this->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    // 背景只在新露出的区域重绘，滚动时由视图直接平移已绘制的内容
+    setCacheMode(QGraphicsView::CacheBackground);
+    // 图元都不接收悬停事件，视图不会自动开启鼠标跟踪；坐标显示和控制点光标需要无按键时的移动事件
+    viewport()->setMouseTracking(true);
 }
 
 void CustomView::setPainterStatus(const PainterStatus ps) {painterStatus = ps;}
@@ -33,21 +58,37 @@ static ItemCommon *itemCommonOf(QGraphicsItem *it)
     if (auto t = qgraphicsitem_cast<TransformableLineItem*>(it))    return t;
     if (auto t = qgraphicsitem_cast<TransformablePolygonItem*>(it)) return t;
     if (auto t = qgraphicsitem_cast<TransformablePathItem*>(it))    return t;
+    if (auto t = qgraphicsitem_cast<TransformableCurveItem*>(it))   return t;
     return nullptr;
 }
 
+// 向订阅了广播的图元（选中或正在旋转的图元）发送鼠标坐标
+void CustomView::broadcastMousePosition(const QPointF &scenePos, MouseLeftClickStatus status)
+{
+    auto *cs = qobject_cast<CanvasScene*>(scene());
+    if (!cs) return;
+    // 接收者可能在回调中退出订阅，遍历副本
+    const QList<CanvasScene::MouseReceiver> receivers = cs->mouseReceivers();
+    for (const CanvasScene::MouseReceiver &r : receivers)
+        r.receiver->receiveSceneMousePosition(scenePos, status);
+}
+
 void CustomView::mousePressEvent(QMouseEvent *event)
 {
-    // 为所有items广播鼠标坐标
+    // 中键拖动平移画布，不影响当前工具
+    if (event->button() == Qt::MiddleButton) {
+        m_panning = true;
+        m_panLast = event->pos();
+        setViewportCursor(Qt::ClosedHandCursor);
+        event->accept();
+        return;
+    }
+
+    // 为选中的items广播鼠标坐标
     if (event->button() == Qt::LeftButton)
     {
-        QPointF scenePos = mapToScene(event->pos());
-        for (QGraphicsItem *item : scene()->items()) {
-            IMousePositionReceiver *receiver = dynamic_cast<IMousePositionReceiver*>(item);
-            if (receiver) {
-                receiver->receiveSceneMousePosition(scenePos, MouseLeftClickStatus::PRESS);
-            }
-        }
+        trackSelectedItems();
+        broadcastMousePosition(mapToScene(event->pos()), MouseLeftClickStatus::PRESS);
     }
 
     // 如果是鼠标左键按下，开始绘图
@@ -58,16 +99,10 @@ void CustomView::mousePressEvent(QMouseEvent *event)
             if (event->button() == Qt::LeftButton) {
                 m_startPoint = mapToScene(event->pos());
                 m_isDrawing = true;
-                m_livePath = QPainterPath();
-                m_livePath.moveTo(m_startPoint);
-
-                m_currentPathItem = new TransformablePathItem(m_livePath);
-                m_currentPathItem->setPen(QPen(penColor, penWidth, penStyle));
-                m_currentPathItem->penColor = penColor;
-                m_currentPathItem->penWidth = penWidth;
-                m_currentPathItem->brushColor = brushColor;
-                m_currentPathItem->penStyle = penStyle;
-                scene()->addItem(m_currentPathItem);
+
+                // 绘制过程中使用只追加的临时笔画，松开鼠标后再生成 TransformablePathItem
+                m_liveStroke = new LiveStrokeItem(m_startPoint, QPen(penColor, penWidth, penStyle), zoom());
+                scene()->addItem(m_liveStroke);
             } else {
                 QGraphicsView::mousePressEvent(event);
             }
@@ -95,6 +130,32 @@ void CustomView::mousePressEvent(QMouseEvent *event)
             }
             break;
         }
+        case PainterStatus::CURVE:
+        {
+            // 每次点击确定一个锚点，按住拖动时拉出该锚点两侧对称的控制点
+            if (event->button() == Qt::LeftButton) {
+                const QPointF scenePos = mapToScene(event->pos());
+                m_isDrawing = true;
+                m_curveDragging = true;
+
+                if (!m_currentCurveItem) {     // 第一次点击：新建
+                    m_liveCurve = QPolygonF{scenePos};
+                    m_currentCurveItem = new TransformableCurveItem(m_liveCurve);
+                    m_currentCurveItem->setPen(QPen(penColor, penWidth, penStyle));
+                    m_currentCurveItem->penColor = penColor;
+                    m_currentCurveItem->penWidth = penWidth;
+                    m_currentCurveItem->brushColor = brushColor;
+                    m_currentCurveItem->penStyle = penStyle;
+                    scene()->addItem(m_currentCurveItem);
+                } else {                       // 后续点击：追加一段，同时去掉预览段
+                    m_liveCurve << m_curveOut << scenePos << scenePos;
+                    m_currentCurveItem->setPoints(m_liveCurve);
+                }
+                m_curveOut = scenePos;
+                updateCurveGuide();
+            }
+            break;
+        }
         case PainterStatus::RECT:
         {
             if (event->button() == Qt::LeftButton) {
@@ -165,39 +226,38 @@ void CustomView::mousePressEvent(QMouseEvent *event)
         case PainterStatus::FILLSELECT:
         {
             if (event->button() == Qt::LeftButton) {
+                auto *cs = qobject_cast<CanvasScene*>(scene());
+                if (!cs) break;
                 QGraphicsItem *hit = nullptr;
-                for (auto it : scene()->items(mapToScene(event->pos()))) {
+                for (auto it : cs->indexedItemsAt(mapToScene(event->pos()))) {
                     if (itemCommonOf(it)) { hit = it; break; }
                 }
                 if (!hit) break;
+                // Line 和 Path 没有 brush，忽略 FILL
+                if (colorType == FILL && !itemHasBrush(hit)) break;
 
-                auto *c = itemCommonOf(hit);
-                if (auto *rect = qgraphicsitem_cast<TransformableRectItem*>(hit)) {
-                    if (colorType == BOARD) { c->penColor = penColor; rect->setPen(QPen(penColor, c->penWidth, c->penStyle)); }
-                    else                    { c->brushColor = brushColor; rect->setBrush(QBrush(brushColor)); }
-                } else if (auto *ell = qgraphicsitem_cast<TransformableEllipseItem*>(hit)) {
-                    if (colorType == BOARD) { c->penColor = penColor; ell->setPen(QPen(penColor, c->penWidth, c->penStyle)); }
-                    else                    { c->brushColor = brushColor; ell->setBrush(QBrush(brushColor)); }
-                } else if (auto *ln = qgraphicsitem_cast<TransformableLineItem*>(hit)) {
-                    if (colorType == BOARD) { c->penColor = penColor; ln->setPen(QPen(penColor, c->penWidth, c->penStyle)); }
-                    // Line 没有 brush，忽略 FILL
-                } else if (auto *pl = qgraphicsitem_cast<TransformablePolygonItem*>(hit)) {
-                    if (colorType == BOARD) { c->penColor = penColor; pl->setPen(QPen(penColor, c->penWidth, c->penStyle)); }
-                    else                    { c->brushColor = brushColor; pl->setBrush(QBrush(brushColor)); }
-                } else if (auto *pa = qgraphicsitem_cast<TransformablePathItem*>(hit)) {
-                    if (colorType == BOARD) { c->penColor = penColor; pa->setPen(QPen(penColor, c->penWidth, c->penStyle)); }
-                    // Path 没有 brush，忽略 FILL
-                }
+                const ItemStyle before = itemStyle(hit);
+                ItemStyle after = before;
+                if (colorType == BOARD) after.penColor = penColor;
+                else                    after.brushColor = brushColor;
+                if (after == before) break;
 
-                hit->update();
-                saveSceneState();
+                undoStack->push(new RestyleItemsCommand({{hit, before, after}}));
             }
             break;
         }
         default:
         {
-            setDragMode(QGraphicsView::RubberBandDrag);
+            // 框选由 CustomView 自己基于空间索引完成，不用 QGraphicsView 的 RubberBandDrag
+            setDragMode(QGraphicsView::NoDrag);
             QGraphicsView::mousePressEvent(event);
+            if (event->button() == Qt::LeftButton) {
+                // 点击未选中的图元会在这里被选中并随后被拖动
+                trackSelectedItems();
+                // 点在空白处（且不是在拖旋转手柄）时开始框选
+                if (!event->isAccepted() && !isRotateCursor)
+                    beginRubberBand(event->pos(), event->modifiers() & Qt::ControlModifier);
+            }
         }
     }
 }
@@ -207,33 +267,44 @@ void CustomView::mouseMoveEvent(QMouseEvent *event)
     // 给坐标标签发送鼠标位置
     emit sendMousePos(mapToScene(event->pos()));
 
-    // 为所有items广播鼠标坐标
-    QPointF scenePos = mapToScene(event->pos());
-    // 判断是否需要将鼠标设为旋转指针
-    isRotateCursor = false;
+    if (m_panning) {
+        scrollViewBy(m_panLast - event->pos());
+        m_panLast = event->pos();
+        return;
+    }
 
-    for (QGraphicsItem *item : scene()->items()) {
-        IMousePositionReceiver *receiver = dynamic_cast<IMousePositionReceiver*>(item);
-        if (receiver) {
-            receiver->receiveSceneMousePosition(scenePos, MouseLeftClickStatus::MOVE);
-        }
-        ItemCommon * itemCommon = dynamic_cast<ItemCommon*>(item);
+    // 为选中的items广播鼠标坐标
+    QPointF scenePos = mapToScene(event->pos());
+    broadcastMousePosition(scenePos, MouseLeftClickStatus::MOVE);
 
-        if (itemCommon->isRotateHandle || itemCommon->isRotateHandling) {
-            isRotateCursor = true;
+    // 判断是否需要将鼠标设为旋转指针，只有订阅广播的图元才可能处于旋转点
+    isRotateCursor = false;
+    if (auto *cs = qobject_cast<CanvasScene*>(scene())) {
+        for (const CanvasScene::MouseReceiver &r : cs->mouseReceivers()) {
+            if (r.common->isRotateHandle || r.common->isRotateHandling) {
+                isRotateCursor = true;
+                break;
+            }
         }
     }
 
     // 如果需要将鼠标设为旋转指针, 则执行
     if (isRotateCursor) {
-        this->viewport()->setCursor(Qt::SizeAllCursor);
+        setViewportCursor(Qt::SizeAllCursor);
     }
     else if (painterStatus == FILLSELECT) {
-        viewport()->setCursor(Qt::CrossCursor);
+        setViewportCursor(Qt::CrossCursor);
         return;   // 后面逻辑全部跳过
     }
+    else if (m_handleCursor != Qt::ArrowCursor && event->buttons() != Qt::NoButton) {
+        // 拖动控制点期间保持按下时的光标
+        setViewportCursor(m_handleCursor);
+    }
     else {
-        this->viewport()->setCursor(Qt::ArrowCursor);
+        // 控制点上的光标统一由 SelectionOverlay 命中测试，没有选中图元时不做任何查询
+        auto *cs = qobject_cast<CanvasScene*>(scene());
+        m_handleCursor = cs ? cs->selectionOverlay()->cursorAt(scenePos) : Qt::ArrowCursor;
+        setViewportCursor(m_handleCursor);
     }
 
     switch (painterStatus)
@@ -241,9 +312,7 @@ void CustomView::mouseMoveEvent(QMouseEvent *event)
         case PainterStatus::PEN:
         {
             if (m_isDrawing) {
-                QPointF currentPoint = mapToScene(event->pos());
-                m_livePath.lineTo(currentPoint);
-                m_currentPathItem->setPath(m_livePath);
+                m_liveStroke->appendPoint(mapToScene(event->pos()));
             } else {
                 QGraphicsView::mouseMoveEvent(event);
             }
@@ -260,6 +329,31 @@ void CustomView::mouseMoveEvent(QMouseEvent *event)
             }
             break;
         }
+        case PainterStatus::CURVE:
+        {
+            if (!m_isDrawing) {
+                QGraphicsView::mouseMoveEvent(event);
+                break;
+            }
+            const QPointF pos = mapToScene(event->pos());
+            const int n = int(m_liveCurve.size());
+            if (m_curveDragging) {
+                // 后侧控制点跟随鼠标，前一段的第二个控制点与之关于锚点对称
+                m_curveOut = pos;
+                if (n >= 4) {
+                    m_liveCurve[n - 2] = 2 * m_liveCurve.last() - pos;
+                    m_currentCurveItem->movePoint(n - 2, m_liveCurve.at(n - 2));
+                }
+                updateCurveGuide();
+            } else if (m_currentCurveItem->points().size() == n + 3) {
+                // 已确定的控制点之后跟一段随鼠标移动的预览段，移动时只改这一段
+                m_currentCurveItem->movePoint(n + 1, pos);
+                m_currentCurveItem->movePoint(n + 2, pos);
+            } else {
+                m_currentCurveItem->setPoints(QPolygonF(m_liveCurve) << m_curveOut << pos << pos);
+            }
+            break;
+        }
         case PainterStatus::RECT:
         {
             if (m_isDrawing) {
@@ -274,10 +368,12 @@ void CustomView::mouseMoveEvent(QMouseEvent *event)
         case PainterStatus::POLYGON:
         {
             if (m_isDrawing) {
-                m_currentPolygonItem->setPolygon(m_livePolygon);
-                QPolygonF poly = m_currentPolygonItem->polygon();    // 简单示意：让所有共点跟随鼠标
-                poly << mapToScene(event->pos());
-                m_currentPolygonItem->setPolygon(poly);
+                // 已确定的顶点之后跟一个随鼠标移动的顶点，移动时只改这一个顶点
+                const QPointF pos = mapToScene(event->pos());
+                if (m_currentPolygonItem->polygon().size() == m_livePolygon.size() + 1)
+                    m_currentPolygonItem->moveVertex(m_livePolygon.size(), pos);
+                else
+                    m_currentPolygonItem->setPolygon(QPolygonF(m_livePolygon) << pos);
             } else {
                 QGraphicsView::mouseMoveEvent(event);
             }
@@ -316,12 +412,8 @@ void CustomView::mouseMoveEvent(QMouseEvent *event)
         }
         default:
         {
-            if(isRotateCursor){
-                setDragMode(QGraphicsView::NoDrag);
-            }
-            else{
-                setDragMode(QGraphicsView::RubberBandDrag);
-            }
+            if (m_rubberBanding)
+                updateRubberBand(event->pos());
             QGraphicsView::mouseMoveEvent(event);
         }
     }
@@ -329,29 +421,37 @@ void CustomView::mouseMoveEvent(QMouseEvent *event)
 
 void CustomView::mouseReleaseEvent(QMouseEvent *event)
 {
-    // 为所有items广播鼠标坐标
-    if (event->button() == Qt::LeftButton)
-    {
-        QPointF scenePos = mapToScene(event->pos());
-        for (QGraphicsItem *item : scene()->items()) {
-            IMousePositionReceiver *receiver = dynamic_cast<IMousePositionReceiver*>(item);
-            if (receiver) {
-                receiver->receiveSceneMousePosition(scenePos, MouseLeftClickStatus::RELEASE);
-            }
-        }
+    if (event->button() == Qt::MiddleButton && m_panning) {
+        m_panning = false;
+        setViewportCursor(Qt::ArrowCursor);
+        return;
     }
 
+    // 为选中的items广播鼠标坐标
+    if (event->button() == Qt::LeftButton)
+        broadcastMousePosition(mapToScene(event->pos()), MouseLeftClickStatus::RELEASE);
+
     switch (painterStatus)
     {
         case PainterStatus::PEN:
         {
             if (event->button() == Qt::LeftButton && m_isDrawing) {
                 m_isDrawing = false;
-                if (m_currentPathItem && m_currentPathItem->path().isEmpty()) {
-                    scene()->removeItem(m_currentPathItem);
-                    delete m_currentPathItem;
+                if (m_liveStroke->points().size() > 1) {
+                    // 简化采样点并拟合成三次曲线，容差按屏幕像素换算成场景单位
+                    const QPolygonF points(m_liveStroke->points());
+                    auto *pathItem = new TransformablePathItem(smoothStroke(points, strokeTolerance / zoom()));
+                    pathItem->setPen(QPen(penColor, penWidth, penStyle));
+                    pathItem->penColor = penColor;
+                    pathItem->penWidth = penWidth;
+                    pathItem->brushColor = brushColor;
+                    pathItem->penStyle = penStyle;
+                    scene()->addItem(pathItem);
+                    pushAddItem(pathItem);
                 }
-                m_currentPathItem = nullptr;
+                scene()->removeItem(m_liveStroke);
+                delete m_liveStroke;
+                m_liveStroke = nullptr;
             }
             break;
         }
@@ -362,6 +462,8 @@ void CustomView::mouseReleaseEvent(QMouseEvent *event)
                 if (m_currentLineItem && m_currentLineItem->line().isNull()) {
                     scene()->removeItem(m_currentLineItem);
                     delete m_currentLineItem;
+                } else {
+                    pushAddItem(m_currentLineItem);
                 }
                 m_currentLineItem = nullptr;
 
@@ -370,6 +472,31 @@ void CustomView::mouseReleaseEvent(QMouseEvent *event)
             }
             break;
         }
+        case PainterStatus::CURVE:
+        {
+            if (event->button() == Qt::LeftButton) {
+                m_curveDragging = false;
+                updateCurveGuide();
+            } else if (event->button() == Qt::RightButton && m_isDrawing) {
+                m_isDrawing = false;
+                m_curveDragging = false;
+                updateCurveGuide();
+                if (m_currentCurveItem) {
+                    m_currentCurveItem->setPoints(m_liveCurve); // 去掉预览段
+                    if (m_currentCurveItem->segmentCount() == 0) {
+                        scene()->removeItem(m_currentCurveItem);
+                        delete m_currentCurveItem;
+                    } else {
+                        pushAddItem(m_currentCurveItem);
+                    }
+                }
+                m_liveCurve.clear();
+                m_currentCurveItem = nullptr;
+            } else {
+                QGraphicsView::mouseReleaseEvent(event);
+            }
+            break;
+        }
         case PainterStatus::RECT:
         {
             if (event->button() == Qt::LeftButton && m_isDrawing) {
@@ -378,6 +505,8 @@ void CustomView::mouseReleaseEvent(QMouseEvent *event)
                 if (m_currentRectItem && m_currentRectItem->rect().isEmpty()) {
                     scene()->removeItem(m_currentRectItem);
                     delete m_currentRectItem;
+                } else {
+                    pushAddItem(m_currentRectItem);
                 }
                 m_currentRectItem = nullptr;
 
@@ -390,10 +519,14 @@ void CustomView::mouseReleaseEvent(QMouseEvent *event)
         {
             if (event->button() == Qt::RightButton && m_isDrawing) {
                 m_isDrawing = false;
+                if (m_currentPolygonItem)
+                    m_currentPolygonItem->settleVertices();
                 if (m_currentPolygonItem &&
                     m_currentPolygonItem->polygon().boundingRect().isEmpty()) {
                     scene()->removeItem(m_currentPolygonItem);
                     delete m_currentPolygonItem;
+                } else {
+                    pushAddItem(m_currentPolygonItem);
                 }
                 m_livePolygon.clear();
                 m_currentPolygonItem = nullptr;
@@ -410,6 +543,8 @@ void CustomView::mouseReleaseEvent(QMouseEvent *event)
                 if (m_currentEllipseItem && m_currentEllipseItem->rect().isEmpty()) {
                     scene()->removeItem(m_currentEllipseItem);
                     delete m_currentEllipseItem;
+                } else {
+                    pushAddItem(m_currentEllipseItem);
                 }
                 m_currentEllipseItem = nullptr;
             } else {
@@ -419,37 +554,235 @@ void CustomView::mouseReleaseEvent(QMouseEvent *event)
         }
         default:
         {
-            setDragMode(QGraphicsView::RubberBandDrag);
+            if (m_rubberBanding && event->button() == Qt::LeftButton)
+                endRubberBand();
             QGraphicsView::mouseReleaseEvent(event);
         }
     }
 
     if (m_isDrawing == false){
-        saveSceneState();
+        commitEdit();
     }
 }
 
 void CustomView::keyPressEvent(QKeyEvent *event)
 {
+    // 键盘缩放以光标为中心，光标不在视图内时以视图中心为准
+    QPoint anchor = viewport()->mapFromGlobal(QCursor::pos());
+    if (!viewport()->rect().contains(anchor))
+        anchor = viewport()->rect().center();
+
+    const bool ctrl = event->modifiers() & Qt::ControlModifier;
     if (event->key() == Qt::Key_Delete) {
         deleteSelectedItem();
+    } else if (ctrl && (event->key() == Qt::Key_Equal || event->key() == Qt::Key_Plus)) {
+        zoomBy(1.25, anchor);
+    } else if (ctrl && event->key() == Qt::Key_Minus) {
+        zoomBy(0.8, anchor);
+    } else if (ctrl && event->key() == Qt::Key_0) {
+        zoomBy(1 / zoom(), anchor);
     } else {
         QGraphicsView::keyPressEvent(event); // 其他按键交给基类处理
     }
 }
 
+void CustomView::wheelEvent(QWheelEvent *event)
+{
+    // 按住 Shift 时保持滚动条的默认行为（横向滚动）
+    if ((event->modifiers() & Qt::ShiftModifier) || event->angleDelta().y() == 0) {
+        QGraphicsView::wheelEvent(event);
+        return;
+    }
+    // 按滚动量连续缩放，触控板的小步滚动也能平滑缩放；鼠标滚一格（120）约放大 1.2 倍
+    zoomBy(std::pow(1.0015, event->angleDelta().y()), event->position().toPoint());
+    event->accept();
+}
+
+void CustomView::zoomBy(qreal factor, const QPoint &viewPos)
+{
+    const qreal target = qBound(MIN_ZOOM, zoom() * factor, MAX_ZOOM);
+    if (qFuzzyCompare(target, zoom())) return;
+
+    // 缩放后把光标下原来的场景点移回光标处
+    const QPointF anchor = mapToScene(viewPos);
+    const qreal f = target / zoom();
+    scale(f, f);
+    if (m_liveStroke) m_liveStroke->setRasterScale(zoom());
+    // 控制点和点选容差按屏幕像素计
+    ItemCommon::setHandleScale(1 / zoom());
+    if (auto *cs = qobject_cast<CanvasScene*>(scene()))
+        cs->selectionOverlay()->handleScaleChanged();
+    updateCurveGuide();
+    updateRenderCacheScale();
+    growSceneRect();
+    scrollViewBy(mapFromScene(anchor) - viewPos);
+}
+
+void CustomView::setViewportCursor(Qt::CursorShape shape)
+{
+    if (viewport()->cursor().shape() != shape)
+        viewport()->setCursor(shape);
+}
+
+void CustomView::scrollViewBy(const QPoint &delta)
+{
+    horizontalScrollBar()->setValue(horizontalScrollBar()->value() + delta.x());
+    verticalScrollBar()->setValue(verticalScrollBar()->value() + delta.y());
+}
+
+void CustomView::resizeEvent(QResizeEvent *event)
+{
+    QGraphicsView::resizeEvent(event);
+    updateRenderCacheScale();
+    growSceneRect();
+}
+
+void CustomView::updateRenderCacheScale()
+{
+    auto *cs = qobject_cast<CanvasScene*>(scene());
+    if (!cs) return;
+    const qreal dpr = devicePixelRatioF();
+    cs->renderCache()->setViewScale(zoom() * dpr, QSizeF(viewport()->size()) * dpr);
+}
+
+void CustomView::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+    growSceneRect();
+}
+
+void CustomView::growSceneRect()
+{
+    if (m_growingSceneRect || !scene()) return;
+    m_growingSceneRect = true;
+
+    // 图元范围取自空间索引的根结点，不必遍历图元
+    QRectF wanted = sceneRect();
+    if (auto *cs = qobject_cast<CanvasScene*>(scene()))
+        wanted |= cs->itemsBounds();
+    // 可见区域外不足一屏时一次向四周扩出两屏，避免平移时频繁调整
+    const QRectF visible = mapToScene(viewport()->rect()).boundingRect();
+    const qreal w = visible.width(), h = visible.height();
+    if (!wanted.contains(visible.adjusted(-w, -h, w, h)))
+        wanted |= visible.adjusted(-2 * w, -2 * h, 2 * w, 2 * h);
+
+    if (wanted != sceneRect()) {
+        // 场景范围向左上扩大时滚动条的值不变，需要把原来左上角的场景点移回原处
+        const QPointF topLeft = mapToScene(QPoint(0, 0));
+        setSceneRect(wanted);
+        scrollViewBy(mapFromScene(topLeft));
+    }
+    m_growingSceneRect = false;
+}
+
+void CustomView::drawBackground(QPainter *painter, const QRectF &rect)
+{
+    // 背景按缩放后坐标中对齐场景原点的固定大小图块绘制，图块绘制一次后缓存，
+    // 平移和局部重绘时只是贴图
+    const qreal z = zoom();
+    const qreal step = BACKGROUND_TILE / z; // 一个图块在场景坐标中的边长
+    const int left = qFloor(rect.left() / step), right = qFloor(rect.right() / step);
+    const int top = qFloor(rect.top() / step), bottom = qFloor(rect.bottom() / step);
+
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    for (int j = top; j <= bottom; ++j) {
+        for (int i = left; i <= right; ++i) {
+            const QPixmap tile = backgroundTile(i, j, z);
+            painter->drawPixmap(QRectF(i * step, j * step, step, step), tile,
+                                QRectF(QPointF(0, 0), tile.size()));
+        }
+    }
+    painter->restore();
+}
+
+void CustomView::updateCurveGuide()
+{
+    QRectF guide;
+    if (m_curveDragging && !m_liveCurve.isEmpty()) {
+        const QPointF anchor = m_liveCurve.last();
+        const qreal half = ItemCommon::handleSize() / 2 + 1 / zoom();
+        guide = QRectF(anchor, m_curveOut).normalized()
+                    .united(QRectF(anchor, 2 * anchor - m_curveOut).normalized())
+                    .adjusted(-half, -half, half, half);
+    }
+    if (guide == m_curveGuide) return;
+    // 空矩形会让 QGraphicsScene::update() 重绘整个场景
+    if (scene() && !m_curveGuide.isEmpty()) scene()->update(m_curveGuide);
+    if (scene() && !guide.isEmpty()) scene()->update(guide);
+    m_curveGuide = guide;
+}
+
+void CustomView::drawForeground(QPainter *painter, const QRectF &rect)
+{
+    // 曲线工具拖出控制点时画出锚点两侧的控制柄。正在绘制的曲线没有选中，
+    // SelectionOverlay 不画它的控制点；第一个锚点还没有曲线段，不画的话拖动时什么也看不到
+    if (m_curveDragging && !m_liveCurve.isEmpty() && m_curveGuide.intersects(rect)) {
+        const QPointF anchor = m_liveCurve.last();
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(QPen(Qt::black, 0));
+        painter->setBrush(Qt::white);
+        // 第一个锚点之前没有曲线段，只有后侧的控制点
+        const QPointF in = m_liveCurve.size() > 1 ? 2 * anchor - m_curveOut : anchor;
+        painter->drawLine(in, m_curveOut);
+        painter->drawRect(ItemCommon::handleRectAt(anchor));
+        painter->drawEllipse(ItemCommon::handleRectAt(m_curveOut));
+        if (in != anchor)
+            painter->drawEllipse(ItemCommon::handleRectAt(in));
+        painter->restore();
+    }
+
+    // 用于绘制缓存的最近使用统计
+    if (auto *cs = qobject_cast<CanvasScene*>(scene()))
+        cs->noteRendered(rect);
+}
+
+QPixmap CustomView::backgroundTile(int i, int j, qreal zoom) const
+{
+    const qreal dpr = devicePixelRatioF();
+    const QString key = QString("protoshop-bg-%1-%2-%3-%4")
+                            .arg(zoom, 0, 'g', 12).arg(dpr).arg(i).arg(j);
+    QPixmap tile;
+    if (QPixmapCache::find(key, &tile)) return tile;
+
+    tile = QPixmap(QSize(BACKGROUND_TILE, BACKGROUND_TILE) * dpr);
+    tile.setDevicePixelRatio(dpr);
+    tile.fill(Qt::white);
+
+    // 网格间距取 10 的整数次幂个场景单位，保证细线在屏幕上至少相隔 8 像素，每 10 条细线画一条粗线
+    const qreal spacing = std::pow(10.0, std::ceil(std::log10(8.0 / zoom)));
+    const qreal px = spacing * zoom;              // 细线间距（缩放后坐标）
+    const qreal x0 = qreal(i) * BACKGROUND_TILE;  // 图块左上角（缩放后坐标）
+    const qreal y0 = qreal(j) * BACKGROUND_TILE;
+    const QPen minor(QColor(238, 238, 238), 0);
+    const QPen major(QColor(214, 214, 214), 0);
+
+    QPainter p(&tile);
+    for (qint64 k = qCeil(x0 / px); k * px < x0 + BACKGROUND_TILE; ++k) {
+        p.setPen(k % 10 == 0 ? major : minor);
+        const qreal x = k * px - x0;
+        p.drawLine(QPointF(x, 0), QPointF(x, BACKGROUND_TILE));
+    }
+    for (qint64 k = qCeil(y0 / px); k * px < y0 + BACKGROUND_TILE; ++k) {
+        p.setPen(k % 10 == 0 ? major : minor);
+        const qreal y = k * px - y0;
+        p.drawLine(QPointF(0, y), QPointF(BACKGROUND_TILE, y));
+    }
+    p.end();
+
+    QPixmapCache::insert(key, tile);
+    return tile;
+}
+
 void CustomView::deleteSelectedItem()
 {
     // 获取所有选中的图元
     QList<QGraphicsItem*> selectedItems = scene()->selectedItems();
+    if (selectedItems.isEmpty()) return;
 
-    // 删除选中的图元
-    for (QGraphicsItem *item : selectedItems) {
-        scene()->removeItem(item);
-        delete item;
-    }
-
-    saveSceneState();
+    // 删除选中的图元（图元交由命令保管，以便撤销）
+    undoStack->push(new RemoveItemsCommand(scene(), selectedItems));
 }
 
 void CustomView::palatteButtonClicked()
@@ -476,82 +809,208 @@ void CustomView::onDeleteActionClicked()
 
 void CustomView::onSaveAs()
 {
-    QString filter = "PNG 图片 (*.png);;JSON 源码 (*.json)";
+    QString filter = "PNG 图片 (*.png);;JSON 源码 (*.json);;Protoshop 二进制文档 (*.psb)";
     QString fileName = QFileDialog::getSaveFileName(this, "保存为", "", filter);
     if (fileName.isEmpty()) return;
 
     if (fileName.endsWith(".png", Qt::CaseInsensitive)) {
-        // 1. 画布截屏
-        QRectF r = scene()->sceneRect();
-        QImage img(r.size().toSize(), QImage::Format_ARGB32);
-        img.fill(Qt::transparent);
-        qDebug() << r;
-        QPainter painter(&img);
-        scene()->render(&painter);
-        img.save(fileName);
-    } else if (fileName.endsWith(".json", Qt::CaseInsensitive)) {
-        // 2. 导出 JSON
-        QJsonArray array;
-        for (QGraphicsItem *it : scene()->items())
-            array.append(itemToJson(it));
-
-        QJsonDocument doc(array);
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly))
-            file.write(doc.toJson());
+        // 1. 画布截屏：分块并行绘制，边画边压缩写出
+        exportPng(fileName);
+    } else if (fileName.endsWith(".json", Qt::CaseInsensitive) || isPsbFile(fileName)) {
+        // 2. 导出 JSON / 二进制文档：这里只拍快照，序列化和写文件在后台进行
+        m_saver->save(fileName, DocumentSaver::snapshot(scene()));
+    }
+}
+
+void CustomView::exportPng(const QString &fileName, ExportOptions options, ExportRegion region)
+{
+    // 按绘制顺序（自下而上）拍快照，导出在后台进行，期间可以继续绘图
+    QList<ItemState> states;
+    for (QGraphicsItem *item : scene()->items(Qt::AscendingOrder))
+        if (itemCommonOf(item) && (region != ExportRegion::Selection || item->isSelected()))
+            states.append(captureItemState(item));
+
+    // 文档没有固定的页面大小，画布从场景原点开始，延伸到所有图元
+    options.source = itemStatesBounds(states);
+    if (options.source.isEmpty()) return;
+    if (region == ExportRegion::Canvas) {
+        const QRectF drawing = options.source;
+        options.source = QRectF(QPointF(qMin<qreal>(0, drawing.left()), qMin<qreal>(0, drawing.top())),
+                                QPointF(qMax<qreal>(0, drawing.right()), qMax<qreal>(0, drawing.bottom())));
     }
+
+    auto *job = new ExportJob(this);
+    auto *dialog = new QProgressDialog("正在导出图片…", "取消", 0, 100, this);
+    dialog->setWindowModality(Qt::NonModal);
+    dialog->setMinimumDuration(500);
+    dialog->setValue(0);
+    connect(job, &ExportJob::progress, dialog, &QProgressDialog::setValue);
+    connect(dialog, &QProgressDialog::canceled, job, &ExportJob::cancel);
+    // 与保存文档一样，失败（磁盘已满、没有写权限、图片过大等）时提示，用户取消时不提示
+    connect(job, &ExportJob::finished, this, [this, job, dialog, fileName](bool ok) {
+        dialog->deleteLater();
+        job->deleteLater();
+        if (!ok && !job->wasCancelled())
+            QMessageBox::warning(this, "导出失败", QString("无法导出图片：%1").arg(fileName));
+    });
+    job->start(fileName, states, options);
 }
 
 void CustomView::onOpen()
 {
-    QString fileName = QFileDialog::getOpenFileName(this, "打开", "", "JSON 源码 (*.json)");
+    QString fileName = QFileDialog::getOpenFileName(this, "打开", "",
+        "Protoshop 文档 (*.json *.psb);;JSON 源码 (*.json);;Protoshop 二进制文档 (*.psb);;自动保存 (*.psbz)");
     if (fileName.isEmpty()) return;
 
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) return;
+    openDocument(fileName);
+}
 
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    if (!doc.isArray()) return;
+void CustomView::openDocument(const QString &fileName)
+{
+    if (m_loader) m_loader->cancel();
+
+    // 解析在后台进行，图元分批加入场景，窗口在载入期间保持响应
+    auto *loader = new DocumentLoader(scene(), this);
+    auto *dialog = new QProgressDialog("正在打开文档…", "取消", 0, 100, this);
+    dialog->setWindowModality(Qt::NonModal);
+    dialog->setMinimumDuration(500);
+    dialog->setValue(0);
+
+    // 第一批图元就绪时才清空画布，文件打不开或一开始就解析失败时画布保持原样
+    connect(loader, &DocumentLoader::firstBatchReady, this, [this] {
+        m_editStates.clear();
+        undoStack->clear();
+        auto *cs = qobject_cast<CanvasScene*>(scene());
+        if (cs) cs->beginBulkLoad();
+        for (QGraphicsItem *item : scene()->items()) {
+            if (itemCommonOf(item)) {
+                scene()->removeItem(item);
+                delete item;
+            }
+        }
+        if (cs) cs->endBulkLoad();
+    });
+    connect(loader, &DocumentLoader::progress, dialog, &QProgressDialog::setValue);
+    connect(dialog, &QProgressDialog::canceled, loader, &DocumentLoader::cancel);
+    connect(loader, &DocumentLoader::finished, this, [this, loader, dialog, fileName](bool ok) {
+        dialog->deleteLater();
+        loader->deleteLater();
+        if (m_loader == loader) m_loader = nullptr;
+        if (ok || loader->wasCancelled()) return;
+        // 读取出错：还没动过画布时画布保持原样；已经替换了画布时告诉用户现在的内容不完整，
+        // 避免把残缺的文档当成完整的保存回去
+        if (loader->addedCount() == 0)
+            QMessageBox::warning(this, "打开失败", QString("无法读取文档：%1").arg(fileName));
+        else
+            QMessageBox::warning(this, "文档不完整",
+                QString("读取 %1 时出错，只载入了其中 %2 个图元。\n画布上是不完整的文档，请不要覆盖原文件。")
+                    .arg(fileName).arg(loader->addedCount()));
+    });
+
+    m_loader = loader;
+    if (!loader->start(fileName, mapToScene(viewport()->rect()).boundingRect())) {
+        m_loader = nullptr;
+        dialog->deleteLater();
+        loader->deleteLater();
+        QMessageBox::warning(this, "打开失败", QString("无法打开文档：%1").arg(fileName));
+    }
+}
 
-    scene()->clear();          // 先清空
-    for (const QJsonValue &v : doc.array())
-        jsonToItem(v.toObject(), scene());
+void CustomView::beginRubberBand(const QPoint &pos, bool keepSelection)
+{
+    if (!m_rubberBand)
+        m_rubberBand = new QRubberBand(QRubberBand::Rectangle, viewport());
+    m_rubberBanding = true;
+    m_rubberBandOrigin = pos;
+    m_rubberBandBase = keepSelection ? scene()->selectedItems() : QList<QGraphicsItem*>();
+    m_rubberBand->setGeometry(QRect(pos, QSize()));
+    m_rubberBand->show();
+}
 
-    saveSceneState();
+void CustomView::updateRubberBand(const QPoint &pos)
+{
+    const QRect bandRect = QRect(m_rubberBandOrigin, pos).normalized();
+    m_rubberBand->setGeometry(bandRect);
+
+    auto *cs = qobject_cast<CanvasScene*>(scene());
+    if (!cs) return;
+
+    // 候选图元来自空间索引，再按 shape 精确判断；只改动选中状态有变化的图元
+    const QRectF sceneRect = mapToScene(bandRect).boundingRect();
+    const QList<QGraphicsItem*> hits = cs->indexedItems(sceneRect, Qt::IntersectsItemShape);
+    QSet<QGraphicsItem*> wanted(hits.cbegin(), hits.cend());
+    for (QGraphicsItem *item : std::as_const(m_rubberBandBase))
+        wanted.insert(item);
+
+    for (QGraphicsItem *item : scene()->selectedItems())
+        if (!wanted.contains(item))
+            item->setSelected(false);
+    for (QGraphicsItem *item : std::as_const(wanted))
+        if (!item->isSelected())
+            item->setSelected(true);
 }
 
-void CustomView::saveSceneState()
+void CustomView::endRubberBand()
 {
-    QJsonArray state;
-    for (QGraphicsItem *it : scene()->items())
-        state.append(itemToJson(it));
+    m_rubberBanding = false;
+    m_rubberBandBase.clear();
+    m_rubberBand->hide();
+}
 
-    undoStack.push(state);
-    if (undoStack.size() > maxUndoSteps)
-        undoStack.pop_front();
+void CustomView::trackSelectedItems()
+{
+    for (QGraphicsItem *item : scene()->selectedItems())
+        if (!m_editStates.contains(item))
+            m_editStates.insert(item, captureItemState(item));
+}
 
-    redoStack.clear(); // 新操作后清空重做栈
+void CustomView::commitEdit()
+{
+    if (m_editStates.isEmpty()) return;
+
+    QList<MoveItemsCommand::Entry> moves;
+    QList<RotateItemsCommand::Entry> rotations;
+    QList<ReshapeItemsCommand::Entry> reshapes;
+    for (auto it = m_editStates.cbegin(); it != m_editStates.cend(); ++it) {
+        QGraphicsItem *item = it.key();
+        if (item->scene() != scene()) continue; // 已被删除，由删除命令记录
+        const ItemState &before = it.value();
+        const ItemState after = captureItemState(item);
+
+        if (before.pos != after.pos)
+            moves.append({item, before.pos, after.pos});
+        if (before.geometry != after.geometry)
+            reshapes.append({item, {before.geometry, before.origin}, {after.geometry, after.origin}});
+        else if (before.rotation != after.rotation || before.origin != after.origin)
+            rotations.append({item, {before.rotation, before.origin}, {after.rotation, after.origin}});
+    }
+    m_editStates.clear();
+
+    auto *edit = new QUndoCommand("编辑图元");
+    if (!moves.isEmpty())     new MoveItemsCommand(moves, edit);
+    if (!rotations.isEmpty()) new RotateItemsCommand(rotations, edit);
+    if (!reshapes.isEmpty())  new ReshapeItemsCommand(reshapes, edit);
+    if (edit->childCount() == 0) {
+        delete edit;
+        return;
+    }
+    if (edit->childCount() == 1)
+        edit->setText(edit->child(0)->text());
+    undoStack->push(edit);
 }
 
-void CustomView::restoreSceneState(const QJsonArray &state)
+void CustomView::pushAddItem(QGraphicsItem *item)
 {
-    scene()->clear();
-    for (const QJsonValue &v : state)
-        jsonToItem(v.toObject(), scene());
+    if (!item) return;
+    undoStack->push(new AddItemsCommand(scene(), {item}));
 }
 
 void CustomView::onRevoke()
 {
-    if (undoStack.size() <= 1) return;
-
-    redoStack.push(undoStack.pop());
-    restoreSceneState(undoStack.top());
+    undoStack->undo();
 }
 
 void CustomView::onUndo()
 {
-    if (redoStack.isEmpty()) return;
-
-    undoStack.push(redoStack.pop());
-    restoreSceneState(undoStack.top());
+    undoStack->redo();
 }
@@ -4,16 +4,26 @@
 #include <QGraphicsView>
 #include <QMouseEvent>
 #include <QGraphicsRectItem>
+#include <QRubberBand>
 #include <QColorDialog>
 #include <QVector>
-#include <QStack>
+#include <QHash>
+#include <QUndoStack>
 #include <QJsonArray>
 #include "common.h"
+#include "itemstate.h"
 #include "transformablepathitem.h"
 #include "transformablelineitem.h"
 #include "transformablerectitem.h"
 #include "transformablepolygonitem.h"
 #include "transformableellipseitem.h"
+#include "transformablecurveitem.h"
+#include "livestrokeitem.h"
+#include "tiledexport.h"
+
+class DocumentLoader;
+class DocumentSaver;
+class Autosaver;
 
 class CustomView : public QGraphicsView
 {
@@ -22,30 +32,67 @@ public:
     explicit CustomView(QWidget *parent = nullptr);
 
     void setPainterStatus(const PainterStatus ps);
-    //撤销重做相关
-    void saveSceneState();   // 保存当前场景状态
-    void restoreSceneState(const QJsonArray &state); // 恢复场景状态
+    // 后台分批载入文档，替换当前画布内容
+    void openDocument(const QString &fileName);
+    Autosaver *autosaver() const { return m_autosaver; }
+    // 导出区域：整个画布（场景原点到所有图元的范围）/ 所有图元的包围盒 / 选中图元的包围盒（只画选中的图元）。
+    // 视图的滚动范围随平移和缩放扩大，不作为导出区域
+    enum class ExportRegion { Canvas, Drawing, Selection };
+    // 导出为 PNG（后台分块绘制），options.source 由 region 决定，其余选项原样使用
+    void exportPng(const QString &fileName, ExportOptions options = ExportOptions(),
+                   ExportRegion region = ExportRegion::Drawing);
+    // 以视图坐标 viewPos 处为中心缩放，缩放比例限制在 [MIN_ZOOM, MAX_ZOOM]
+    void zoomBy(qreal factor, const QPoint &viewPos);
+    qreal zoom() const { return transform().m11(); }
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void drawBackground(QPainter *painter, const QRectF &rect) override;
+    void drawForeground(QPainter *painter, const QRectF &rect) override;
 
 private:
     void deleteSelectedItem();
+    void broadcastMousePosition(const QPointF &scenePos, MouseLeftClickStatus status);
+    // 撤销重做相关
+    void trackSelectedItems(); // 记录可能被本次鼠标操作修改的图元的初始状态
+    void commitEdit();         // 将本次鼠标操作的改动作为命令入栈
+    void pushAddItem(QGraphicsItem *item);
+    // 框选相关
+    void beginRubberBand(const QPoint &pos, bool keepSelection);
+    void updateRubberBand(const QPoint &pos);
+    void endRubberBand();
+    // 光标不变时不重复设置
+    void setViewportCursor(Qt::CursorShape shape);
+    // 按视图像素平移（调整滚动条）
+    void scrollViewBy(const QPoint &delta);
+    // 把当前缩放和视口大小告诉绘制缓存
+    void updateRenderCacheScale();
+    // 曲线工具拖出控制点时重绘前景中的控制柄
+    void updateCurveGuide();
+    // 背景图块：第 (i, j) 块覆盖缩放后坐标中 [i * TILE, (i + 1) * TILE) 的范围
+    QPixmap backgroundTile(int i, int j, qreal zoom) const;
 
 private:
     PainterStatus painterStatus = PainterStatus::SELECT;
 
     QPointF m_startPoint; // 记录鼠标按下的起始点
-    TransformablePathItem *m_currentPathItem = nullptr;
-    QPainterPath m_livePath;
+    LiveStrokeItem *m_liveStroke = nullptr; // 画笔工具正在绘制的笔画
     TransformableLineItem *m_currentLineItem = nullptr;
     TransformableRectItem *m_currentRectItem = nullptr; // 当前正在绘制的矩形
     TransformablePolygonItem *m_currentPolygonItem = nullptr;
     QPolygonF m_livePolygon;   // 正在采集的顶点
     TransformableEllipseItem *m_currentEllipseItem = nullptr;
+    TransformableCurveItem *m_currentCurveItem = nullptr;
+    QPolygonF m_liveCurve;     // 已确定的曲线控制点
+    QPointF m_curveOut;        // 最后一个锚点后侧的控制点（下一段的第一个控制点）
+    bool m_curveDragging = false; // 按下鼠标后正在拖出锚点的控制点
+    QRectF m_curveGuide;       // 前景中控制柄上次绘制的范围（场景坐标）
     bool m_isDrawing = false; // 是否正在绘制的标志
 
     // 画笔相关
@@ -55,13 +102,33 @@ private:
     // 旋转相关
     bool isRotateCursor = false;
 
+    // 框选相关
+    QRubberBand *m_rubberBand = nullptr;
+    bool m_rubberBanding = false;
+    QPoint m_rubberBandOrigin;
+    QList<QGraphicsItem*> m_rubberBandBase; // 按住 Ctrl 框选时保留的原有选中图元
+
+    // 缩放与平移相关
+    static constexpr qreal MIN_ZOOM = 0.01;
+    static constexpr qreal MAX_ZOOM = 64;
+    static constexpr int BACKGROUND_TILE = 256; // 背景图块边长（设备像素）
+    bool m_panning = false;    // 正在用鼠标中键拖动视图
+    QPoint m_panLast;
+    bool m_growingSceneRect = false;
+    Qt::CursorShape m_handleCursor = Qt::ArrowCursor; // 最近一次停在控制点上时的光标
+
     // 撤销重做相关
     const int maxUndoSteps = 50; // 最大撤销步数
-    QStack<QJsonArray> undoStack; // 重做栈
-    QStack<QJsonArray> redoStack; // 撤销栈
+    QUndoStack *undoStack = nullptr; // 命令栈
+    QHash<QGraphicsItem*, ItemState> m_editStates; // 本次鼠标操作开始前相关图元的状态
+
+    DocumentLoader *m_loader = nullptr; // 正在进行的文档载入
+    DocumentSaver *m_saver = nullptr;   // 后台保存
+    Autosaver *m_autosaver = nullptr;
 
 public:
     int penWidth = 1; // 线宽
+    qreal strokeTolerance = 1.0; // 任意画笔的简化容差（像素），0 表示保留全部采样点
     Qt::PenStyle penStyle = Qt::SolidLine; // 画笔类型
     ColorType colorType = BOARD; // 着色类型
 
@@ -69,6 +136,8 @@ signals:
     void sendMousePos(QPointF pos);
 
 public slots:
+    // 画布没有边界：视图的场景范围始终覆盖所有图元以及可见区域外一屏，只增不减
+    void growSceneRect();
     void palatteButtonClicked();
     void onDeleteActionClicked();
     void onSaveAs();     // 弹出对话框 → 选 *.png / *.json
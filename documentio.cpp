@@ -0,0 +1,134 @@
+#include "documentio.h"
+#include "common.h"
+#include "canvasscene.h"
+#include "psbformat.h"
+#include "jsonstream.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QPainter>
+
+bool isPsbFile(const QString &fileName)
+{
+    return fileName.endsWith(".psb", Qt::CaseInsensitive) || isCompressedPsb(fileName);
+}
+
+bool forEachDocumentItem(const QString &fileName, const std::function<void(ItemState &&)> &visit)
+{
+    if (isPsbFile(fileName)) {
+        PsbReader reader;
+        if (!reader.open(fileName)) return false;
+        for (int i = 0; i < reader.itemCount(); ++i)
+            visit(reader.itemState(i));
+        return true;
+    }
+
+    // JSON 逐个图元解析，不构造整篇文档的 DOM
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    JsonItemReader reader(&file);
+    QJsonObject obj;
+    while (reader.next(&obj))
+        visit(jsonToItemState(obj));
+    return !reader.hasError();
+}
+
+bool readDocumentStates(const QString &fileName, QList<ItemState> *states)
+{
+    QList<ItemState> result;
+    if (!forEachDocumentItem(fileName, [&result](ItemState &&st) { result.append(std::move(st)); }))
+        return false;
+    *states = std::move(result);
+    return true;
+}
+
+bool writeDocument(const QString &fileName, QGraphicsScene *scene)
+{
+    const QList<QGraphicsItem*> items = scene->items(Qt::AscendingOrder);
+    if (isPsbFile(fileName)) {
+        QList<ItemState> states;
+        states.reserve(items.size());
+        for (QGraphicsItem *it : items)
+            if (dynamic_cast<ItemCommon*>(it))
+                states.append(captureItemState(it));
+        return writePsb(fileName, states);
+    }
+
+    // JSON 逐个图元写出，不在内存中拼出整篇文档
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    JsonItemWriter writer(&file);
+    bool ok = writer.begin();
+    for (QGraphicsItem *it : items)
+        if (ok && dynamic_cast<ItemCommon*>(it))
+            ok = writer.write(itemToJson(it));
+    ok = ok && writer.end();
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool writeDocumentStates(const QString &fileName, const QList<ItemState> &states)
+{
+    if (isPsbFile(fileName))
+        return writePsb(fileName, states);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    JsonItemWriter writer(&file);
+    bool ok = writer.begin();
+    for (const ItemState &st : states)
+        if (ok)
+            ok = writer.write(itemStateToJson(st));
+    ok = ok && writer.end();
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+int loadDocumentInto(const QJsonArray &items, QGraphicsScene *scene)
+{
+    auto *cs = qobject_cast<CanvasScene*>(scene);
+    if (cs) cs->beginBulkLoad();
+
+    int count = 0;
+    for (const QJsonValue &v : items)
+        if (jsonToItem(v.toObject(), scene))
+            ++count;
+
+    if (cs) cs->endBulkLoad();
+    return count;
+}
+
+int loadDocumentInto(const QList<ItemState> &states, QGraphicsScene *scene)
+{
+    auto *cs = qobject_cast<CanvasScene*>(scene);
+    if (cs) cs->beginBulkLoad();
+
+    int count = 0;
+    for (const ItemState &st : states) {
+        if (QGraphicsItem *item = createItem(st)) {
+            scene->addItem(item);
+            ++count;
+        }
+    }
+
+    if (cs) cs->endBulkLoad();
+    return count;
+}
+
+QImage renderScene(QGraphicsScene *scene, const QRectF &source, qreal scale,
+                   const QColor &background)
+{
+    const QSize size = (source.size() * scale).toSize();
+    if (size.isEmpty()) return QImage();
+
+    QImage img(size, QImage::Format_ARGB32);
+    img.fill(background);
+    QPainter painter(&img);
+    scene->render(&painter, QRectF(QPointF(0, 0), size), source);
+    return img;
+}
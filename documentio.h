@@ -0,0 +1,36 @@
+#ifndef DOCUMENTIO_H
+#define DOCUMENTIO_H
+
+#include <QString>
+#include <QJsonArray>
+#include <QImage>
+#include <QGraphicsScene>
+#include <functional>
+#include "itemstate.h"
+
+// 文档读写与渲染，不依赖窗口界面，GUI 和命令行工具共用
+
+// 文档按扩展名区分 .psb 二进制格式与 JSON（顶层为图元数组）。
+// JSON 流式读写，内存占用与单个图元而不是整篇文档的大小相关
+
+// 依次读出文档中的每个图元交给 visit，文件无法打开或格式错误时返回 false
+// （出错前已读出的图元仍会交给 visit）
+bool forEachDocumentItem(const QString &fileName, const std::function<void(ItemState &&)> &visit);
+// 读取整篇文档为图元状态列表，出错时不修改 states
+bool readDocumentStates(const QString &fileName, QList<ItemState> *states);
+// 把场景中的全部图元按堆叠顺序自下而上写成文档，载入时按文档顺序加入场景，堆叠顺序不变
+bool writeDocument(const QString &fileName, QGraphicsScene *scene);
+// states 应按堆叠顺序自下而上排列（见 DocumentSaver::snapshot()）
+bool writeDocumentStates(const QString &fileName, const QList<ItemState> &states);
+// 按已读出的文档新建图元加入 scene，返回加入的图元数
+int loadDocumentInto(const QJsonArray &items, QGraphicsScene *scene);
+int loadDocumentInto(const QList<ItemState> &states, QGraphicsScene *scene);
+// .psb / .psbz 文件扩展名判断
+bool isPsbFile(const QString &fileName);
+
+// 把场景的 source 区域渲染成图片，图片大小为 source 乘以 scale，
+// background 默认透明
+QImage renderScene(QGraphicsScene *scene, const QRectF &source, qreal scale = 1.0,
+                   const QColor &background = Qt::transparent);
+
+#endif // DOCUMENTIO_H
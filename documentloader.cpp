@@ -0,0 +1,296 @@
+#include "documentloader.h"
+#include "documentio.h"
+#include "jsonstream.h"
+#include "psbformat.h"
+#include "canvasscene.h"
+#include <QFile>
+#include <QJsonDocument>
+#include <QMap>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <atomic>
+#include <limits>
+
+static constexpr int BatchSize = 1024;
+// GUI 线程最多攒这么多批待加入的图元
+static constexpr int MaxPendingBatches = 4;
+
+// 工作线程与 GUI 线程共享的载入状态，由双方共同持有，
+// 载入器先于后台任务销毁时也不会悬空
+struct DocumentLoader::Job {
+    struct Batch {
+        QList<Pending> visible;
+        QList<Pending> rest;
+    };
+
+    QRectF priorityRect;
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> permilleRead{0}; // 文件读取进度（千分比）
+    // 限制已读出但 GUI 线程还没取走的批次数：读文件线程派发批次前取一个许可，
+    // pump() 取走批次时才归还，读文件和解析都不会远远跑在加入场景前面
+    const int maxInFlight = 2 * qMax(1, QThread::idealThreadCount());
+    QSemaphore inFlight{maxInFlight};
+
+    QMutex mutex;
+    QMap<int, Batch> ready; // 批次序号 -> 已解析的批次
+    int batchCount = 0;     // 已派发的批次数
+    bool readerDone = false;
+    bool failed = false;
+
+    // 除最后一批外每批都是 BatchSize 个图元，批次序号换算成文档序号
+    void publish(int seq, const QList<ItemState> &states)
+    {
+        Batch batch;
+        qint64 index = qint64(seq) * BatchSize;
+        for (const ItemState &st : states) {
+            if (!priorityRect.isNull() && itemStateBounds(st).intersects(priorityRect))
+                batch.visible.append({index++, st});
+            else
+                batch.rest.append({index++, st});
+        }
+        QMutexLocker lock(&mutex);
+        ready.insert(seq, std::move(batch));
+    }
+
+    void fail()
+    {
+        cancelled = true;
+        QMutexLocker lock(&mutex);
+        failed = true;
+    }
+
+    // 停止载入；读文件线程可能正等着许可，多归还一些让它醒来后看到 cancelled 退出
+    void abort()
+    {
+        cancelled = true;
+        inFlight.release(maxInFlight);
+    }
+};
+
+void DocumentLoader::readJob(const QSharedPointer<Job> &job, const QString &fileName)
+{
+    QThreadPool *pool = QThreadPool::globalInstance();
+    int seq = 0;
+    bool ok = true;
+
+    if (isPsbFile(fileName)) {
+        auto reader = QSharedPointer<PsbReader>::create();
+        ok = reader->open(fileName);
+        const int n = ok ? reader->itemCount() : 0;
+        for (int begin = 0; begin < n && !job->cancelled; begin += BatchSize) {
+            job->inFlight.acquire();
+            const int end = qMin(n, begin + BatchSize);
+            pool->start([job, reader, begin, end, seq] {
+                QList<ItemState> states;
+                if (!job->cancelled) {
+                    states.reserve(end - begin);
+                    for (int i = begin; i < end; ++i)
+                        states.append(reader->itemState(i));
+                }
+                job->publish(seq, states);
+            });
+            ++seq;
+            job->permilleRead = int(qint64(end) * 1000 / n);
+        }
+    } else {
+        QFile file(fileName);
+        ok = file.open(QIODevice::ReadOnly);
+        const qint64 size = qMax<qint64>(1, file.size());
+        JsonItemReader reader(&file);
+        QList<QByteArray> raw;
+        auto dispatch = [&] {
+            job->inFlight.acquire();
+            pool->start([job, raw, seq] {
+                QList<ItemState> states;
+                if (!job->cancelled) {
+                    states.reserve(raw.size());
+                    for (const QByteArray &bytes : raw) {
+                        QJsonParseError err;
+                        const QJsonDocument doc = QJsonDocument::fromJson(bytes, &err);
+                        if (err.error != QJsonParseError::NoError) {
+                            job->fail();
+                            break;
+                        }
+                        states.append(jsonToItemState(doc.object()));
+                    }
+                }
+                job->publish(seq, states);
+            });
+            ++seq;
+            raw.clear();
+            job->permilleRead = int(file.pos() * 1000 / size);
+        };
+
+        QByteArray bytes;
+        while (ok && !job->cancelled && reader.nextRaw(&bytes)) {
+            raw.append(bytes);
+            if (raw.size() == BatchSize)
+                dispatch();
+        }
+        if (!raw.isEmpty() && !job->cancelled)
+            dispatch();
+        if (reader.hasError())
+            ok = false;
+    }
+
+    if (!ok)
+        job->fail();
+    job->permilleRead = 1000;
+    QMutexLocker lock(&job->mutex);
+    job->batchCount = seq;
+    job->readerDone = true;
+}
+
+DocumentLoader::DocumentLoader(QGraphicsScene *scene, QObject *parent)
+    : QObject(parent), m_scene(scene)
+{
+    m_timer.setInterval(16); // 大约每帧一次
+    connect(&m_timer, &QTimer::timeout, this, &DocumentLoader::pump);
+}
+
+DocumentLoader::~DocumentLoader()
+{
+    if (m_job)
+        m_job->abort();
+}
+
+bool DocumentLoader::start(const QString &fileName, const QRectF &priorityRect)
+{
+    if (m_job || !QFile::exists(fileName)) return false;
+
+    m_job = QSharedPointer<Job>::create();
+    m_job->priorityRect = priorityRect;
+    m_cancelled = false;
+    m_nextBatch = 0;
+    m_received = 0;
+    m_added = 0;
+    m_restAdded = 0;
+
+    QThread *reader = QThread::create(&DocumentLoader::readJob, m_job, fileName);
+    connect(reader, &QThread::finished, reader, &QObject::deleteLater);
+    reader->start();
+    m_timer.start();
+    return true;
+}
+
+void DocumentLoader::cancel()
+{
+    if (!m_job) return;
+    m_cancelled = true;
+    finish(false);
+}
+
+void DocumentLoader::pump()
+{
+    if (!m_job) return;
+    QElapsedTimer clock;
+    clock.start();
+
+    // 按序号收取已解析好的批次，保持同一队列内图元的文档顺序。
+    // 待加入的非可见图元攒够 MaxPendingBatches 批后暂停收取，等加入场景后再收，
+    // 每取走一批归还一个许可，整篇文档不会一次全部留在内存里
+    bool readerDone = false;
+    bool failed = false;
+    {
+        QMutexLocker lock(&m_job->mutex);
+        for (auto it = m_job->ready.find(m_nextBatch);
+             it != m_job->ready.end() && m_rest.size() < MaxPendingBatches * BatchSize;
+             it = m_job->ready.find(m_nextBatch)) {
+            m_received += int(it->visible.size() + it->rest.size());
+            m_visible.append(std::move(it->visible));
+            m_rest.append(std::move(it->rest));
+            m_job->ready.erase(it);
+            m_job->inFlight.release();
+            ++m_nextBatch;
+        }
+        readerDone = m_job->readerDone && m_nextBatch == m_job->batchCount;
+        failed = m_job->failed;
+    }
+
+    if (failed && m_added == 0) {
+        // 还没动过场景，出错时保持原样
+        finish(false);
+        return;
+    }
+
+    // 接收信号的一方可能在槽里调用 cancel()，每次发出信号后都要检查载入是否已经结束
+    if (m_added == 0 && (!m_visible.isEmpty() || !m_rest.isEmpty())) {
+        emit firstBatchReady();
+        if (!m_job) return;
+    }
+
+    // 本帧的时间预算内逐个建图元加入场景，先可见区域。
+    // 非可见图元按文档顺序加在最上面，加入前先把文档中排在它前面的可见图元移上来；
+    // 在那之前提前加入的可见图元暂时压在后加入的图元下面，只影响与可见区域以外的图元重叠的部分
+    int added = 0;
+    while (!m_visible.isEmpty() || !m_rest.isEmpty()) {
+        const bool visible = !m_visible.isEmpty();
+        const Pending p = visible ? m_visible.takeFirst() : m_rest.takeFirst();
+        if (!visible)
+            settleEarly(p.index);
+        if (QGraphicsItem *item = createItem(p.state)) {
+            m_scene->addItem(item);
+            if (visible)
+                m_early.append({p.index, item, m_restAdded});
+            else
+                ++m_restAdded;
+            ++added;
+        }
+        if (clock.elapsed() >= m_frameBudget) break;
+    }
+    if (added) {
+        m_added += added;
+        emit itemsAdded(m_added);
+        if (!m_job) return;
+    }
+
+    const qint64 read = m_job->permilleRead;
+    const qint64 pending = m_visible.size() + m_rest.size();
+    const qint64 consumed = qMax<qint64>(1, m_received);
+    emit progress(int(read * (consumed - pending) / consumed / 10));
+    if (!m_job) return;
+
+    if (failed)
+        finish(false);
+    else if (readerDone && pending == 0)
+        finish(true);
+}
+
+void DocumentLoader::settleEarly(qint64 index)
+{
+    while (!m_early.isEmpty() && m_early.first().index < index) {
+        const Early e = m_early.takeFirst();
+        // 加入后没有再加入非可见图元时位置已经正确
+        if (e.restBefore == m_restAdded || !inScene(e.item)) continue;
+        const bool selected = e.item->isSelected();
+        m_scene->removeItem(e.item);
+        m_scene->addItem(e.item);
+        e.item->setSelected(selected);
+    }
+}
+
+bool DocumentLoader::inScene(QGraphicsItem *item) const
+{
+    // 载入期间用户可以删除已加入的图元，删除命令被挤出撤销栈时图元随之释放，
+    // 画布场景按空间索引判断，不访问图元本身
+    if (auto *cs = qobject_cast<CanvasScene*>(m_scene))
+        return cs->containsItem(item);
+    return item->scene() == m_scene;
+}
+
+void DocumentLoader::finish(bool ok)
+{
+    // 出错或取消时已加入的图元留在场景中，同样按文档顺序排好
+    settleEarly(std::numeric_limits<qint64>::max());
+    m_timer.stop();
+    m_job->abort();
+    m_job.reset();
+    m_visible.clear();
+    m_rest.clear();
+    m_early.clear();
+    if (ok) emit progress(100);
+    emit finished(ok);
+}
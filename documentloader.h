@@ -0,0 +1,80 @@
+#ifndef DOCUMENTLOADER_H
+#define DOCUMENTLOADER_H
+
+#include <QObject>
+#include <QGraphicsScene>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QList>
+#include "itemstate.h"
+
+// 后台分批载入文档：
+// 读文件线程切分出图元（JSON 切出原始字节，.psb 按下标分段），交给线程池解析成 ItemState，
+// 路径、多边形等几何数据都在工作线程上构造好；GUI 线程每帧只花 frameBudget 毫秒
+// 把准备好的图元加入场景，优先加入与 priorityRect（通常是当前可见区域）相交的图元。
+// 图元的堆叠顺序按它在文档中的序号，与加入场景的先后无关：提前加入的可见图元
+// 在文档中排在它前面的图元都加入后移到最上面，载入结束时场景的堆叠顺序与文档一致。
+class DocumentLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DocumentLoader(QGraphicsScene *scene, QObject *parent = nullptr);
+    ~DocumentLoader() override;
+
+    // 开始载入，文件无法打开时返回 false
+    bool start(const QString &fileName, const QRectF &priorityRect = QRectF());
+    bool isRunning() const { return m_job != nullptr; }
+    int addedCount() const { return m_added; }
+    // 是否由 cancel() 结束（区别于读取出错）
+    bool wasCancelled() const { return m_cancelled; }
+    void setFrameBudget(int msecs) { m_frameBudget = msecs; }
+
+public slots:
+    void cancel();
+
+signals:
+    // 第一批图元即将加入场景，此前出错则不会发出
+    void firstBatchReady();
+    void itemsAdded(int total);
+    void progress(int percent);
+    // 载入完成；出错或被取消时 ok 为 false，已加入的图元（addedCount() 个）保留在场景中
+    void finished(bool ok);
+
+private slots:
+    void pump();
+
+private:
+    struct Job;
+    // 待加入场景的图元及其在文档中的序号
+    struct Pending {
+        qint64 index;
+        ItemState state;
+    };
+    // 提前加入场景的可见图元
+    struct Early {
+        qint64 index;
+        QGraphicsItem *item;
+        qint64 restBefore; // 加入时已经加入的非可见图元数
+    };
+    // 在读文件线程上运行
+    static void readJob(const QSharedPointer<Job> &job, const QString &fileName);
+    // 把文档序号小于 index 的提前加入的图元按文档顺序移到最上面
+    void settleEarly(qint64 index);
+    bool inScene(QGraphicsItem *item) const;
+    void finish(bool ok);
+
+    QGraphicsScene *m_scene;
+    QSharedPointer<Job> m_job;
+    QTimer m_timer;
+    int m_frameBudget = 8;
+    bool m_cancelled = false;
+    int m_nextBatch = 0;
+    int m_received = 0;
+    int m_added = 0;
+    qint64 m_restAdded = 0;
+    QList<Pending> m_visible; // 优先加入的图元
+    QList<Pending> m_rest;
+    QList<Early> m_early;
+};
+
+#endif // DOCUMENTLOADER_H
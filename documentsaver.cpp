@@ -0,0 +1,101 @@
+#include "documentsaver.h"
+#include "documentio.h"
+#include <QDir>
+#include <QDateTime>
+#include <QFileInfo>
+
+/* ===== 后台保存 ===== */
+DocumentSaver::DocumentSaver(QObject *parent)
+    : QObject(parent)
+{
+    // 单线程，保证对同一文件的多次保存按顺序落盘
+    m_pool.setMaxThreadCount(1);
+}
+
+DocumentSaver::~DocumentSaver()
+{
+    m_pool.waitForDone();
+}
+
+QList<ItemState> DocumentSaver::snapshot(QGraphicsScene *scene)
+{
+    QList<ItemState> states;
+    if (!scene) return states;
+    // 自下而上，重新载入时按文档顺序加入场景，堆叠顺序不变
+    const QList<QGraphicsItem*> items = scene->items(Qt::AscendingOrder);
+    states.reserve(items.size());
+    for (QGraphicsItem *it : items)
+        if (dynamic_cast<ItemCommon*>(it))
+            states.append(captureItemState(it));
+    return states;
+}
+
+void DocumentSaver::save(const QString &fileName, const QList<ItemState> &snapshot)
+{
+    ++m_pending;
+    m_pool.start([this, fileName, snapshot] {
+        const bool ok = writeDocumentStates(fileName, snapshot);
+        // 回到 GUI 线程报告结果；析构函数会等待任务结束，this 在这里总是有效的
+        QMetaObject::invokeMethod(this, [this, fileName, ok] {
+            --m_pending;
+            emit saved(fileName, ok);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/* ===== 自动保存 ===== */
+Autosaver::Autosaver(QUndoStack *undoStack, QObject *parent)
+    : QObject(parent)
+{
+    connect(undoStack, &QUndoStack::indexChanged, this, [this] { m_dirty = true; });
+    connect(&m_timer, &QTimer::timeout, this, &Autosaver::autosaveNow);
+    connect(&m_saver, &DocumentSaver::saved, this, [this](const QString &fileName, bool ok) {
+        if (ok)
+            enforceDiskBudget();
+        else
+            m_dirty = true; // 下次再试
+        emit autosaved(fileName, ok);
+    });
+}
+
+void Autosaver::setInterval(int msecs)
+{
+    m_interval = msecs;
+    if (msecs > 0)
+        m_timer.start(msecs);
+    else
+        m_timer.stop();
+}
+
+void Autosaver::autosaveNow()
+{
+    // 没有改动，或上一次自动保存还没写完时跳过
+    if (!m_dirty || !m_scene || m_dir.isEmpty() || m_saver.isBusy()) return;
+    if (!QDir().mkpath(m_dir)) return;
+
+    const QString name = "autosave-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss-zzz") + ".psbz";
+    m_dirty = false;
+    m_saver.save(QDir(m_dir).filePath(name), DocumentSaver::snapshot(m_scene));
+}
+
+QStringList Autosaver::autosaveFiles() const
+{
+    // 文件名中的时间戳按字典序即按时间排序
+    QDir dir(m_dir);
+    QStringList files;
+    for (const QString &name : dir.entryList({"autosave-*.psbz"}, QDir::Files, QDir::Name | QDir::Reversed))
+        files << dir.filePath(name);
+    return files;
+}
+
+void Autosaver::enforceDiskBudget()
+{
+    const QStringList files = autosaveFiles();
+    qint64 total = 0;
+    // 从新到旧累加，超出预算的旧文件删除，最新的一份总会保留
+    for (int i = 0; i < files.size(); ++i) {
+        total += QFileInfo(files[i]).size();
+        if (i > 0 && total > m_diskBudget)
+            QFile::remove(files[i]);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef DOCUMENTSAVER_H
+#define DOCUMENTSAVER_H
+
+#include <QObject>
+#include <QGraphicsScene>
+#include <QUndoStack>
+#include <QThreadPool>
+#include <QTimer>
+#include <QPointer>
+#include "itemstate.h"
+
+// 后台保存：GUI 线程上只拍一份场景快照（图元状态列表，几何数据隐式共享，不做深拷贝），
+// 序列化、压缩和写文件（QSaveFile 原子替换）都在工作线程上完成，期间可以继续绘图。
+class DocumentSaver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DocumentSaver(QObject *parent = nullptr);
+    ~DocumentSaver() override;
+
+    // 场景中全部图元的状态，按堆叠顺序自下而上
+    static QList<ItemState> snapshot(QGraphicsScene *scene);
+    // 按扩展名选择格式（见 writeDocumentStates），同一个 DocumentSaver 的保存按提交顺序依次执行
+    void save(const QString &fileName, const QList<ItemState> &snapshot);
+    bool isBusy() const { return m_pending > 0; }
+    void waitForDone() { m_pool.waitForDone(); }
+
+signals:
+    void saved(const QString &fileName, bool ok);
+
+private:
+    QThreadPool m_pool;
+    int m_pending = 0;
+};
+
+// 定时自动保存：场景自上次自动保存后有改动（撤销栈有变化）时，
+// 在 directory 下写一份压缩的 autosave-<时间>.psbz，并删除最旧的文件使总大小不超过 diskBudget
+class Autosaver : public QObject
+{
+    Q_OBJECT
+public:
+    // 自动保存文件默认最多占用的磁盘空间
+    static constexpr qint64 DEFAULT_DISK_BUDGET = 200 * 1024 * 1024;
+
+    explicit Autosaver(QUndoStack *undoStack, QObject *parent = nullptr);
+
+    void setScene(QGraphicsScene *scene) { m_scene = scene; }
+    void setDirectory(const QString &dir) { m_dir = dir; }
+    QString directory() const { return m_dir; }
+    // interval <= 0 时关闭自动保存
+    void setInterval(int msecs);
+    int interval() const { return m_interval; }
+    void setDiskBudget(qint64 bytes) { m_diskBudget = bytes; }
+    qint64 diskBudget() const { return m_diskBudget; }
+
+    // 目录中已有的自动保存文件，最新的在前
+    QStringList autosaveFiles() const;
+
+public slots:
+    // 有改动时立即自动保存一次
+    void autosaveNow();
+
+signals:
+    void autosaved(const QString &fileName, bool ok);
+
+private:
+    void enforceDiskBudget();
+
+    QPointer<QGraphicsScene> m_scene;
+    DocumentSaver m_saver;
+    QTimer m_timer;
+    QString m_dir;
+    int m_interval = 0;
+    qint64 m_diskBudget = DEFAULT_DISK_BUDGET;
+    bool m_dirty = false;
+};
+
+#endif // DOCUMENTSAVER_H
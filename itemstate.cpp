@@ -0,0 +1,205 @@
+#include "itemstate.h"
+#include "canvasscene.h"
+#include <QPainter>
+#include <QtMath>
+#include "transformablelineitem.h"
+#include "transformablerectitem.h"
+#include "transformableellipseitem.h"
+#include "transformablepolygonitem.h"
+#include "transformablepathitem.h"
+#include "transformablecurveitem.h"
+
+QString itemTypeName(QGraphicsItem *it)
+{
+    if (qgraphicsitem_cast<TransformablePathItem*>(it))     return "TransformablePathItem";
+    if (qgraphicsitem_cast<TransformableLineItem*>(it))     return "TransformableLineItem";
+    if (qgraphicsitem_cast<TransformableRectItem*>(it))     return "TransformableRectItem";
+    if (qgraphicsitem_cast<TransformableEllipseItem*>(it))  return "TransformableEllipseItem";
+    if (qgraphicsitem_cast<TransformablePolygonItem*>(it))  return "TransformablePolygonItem";
+    if (qgraphicsitem_cast<TransformableCurveItem*>(it))    return "TransformableCurveItem";
+    return "Unknown";
+}
+
+ItemGeometry itemGeometry(QGraphicsItem *item)
+{
+    ItemGeometry g;
+    if (auto *l = qgraphicsitem_cast<TransformableLineItem*>(item))
+        g.line = l->line();
+    else if (auto *r = qgraphicsitem_cast<TransformableRectItem*>(item))
+        g.rect = r->rect();
+    else if (auto *e = qgraphicsitem_cast<TransformableEllipseItem*>(item)) {
+        g.rect = e->rect();
+        g.circle = e->isCircle;
+    } else if (auto *p = qgraphicsitem_cast<TransformablePolygonItem*>(item))
+        g.polygon = p->polygon();
+    else if (auto *pa = qgraphicsitem_cast<TransformablePathItem*>(item))
+        g.path = pa->path();
+    else if (auto *c = qgraphicsitem_cast<TransformableCurveItem*>(item))
+        g.polygon = c->points();
+    return g;
+}
+
+void setItemGeometry(QGraphicsItem *item, const ItemGeometry &g)
+{
+    if (auto *l = qgraphicsitem_cast<TransformableLineItem*>(item))
+        l->setLine(g.line);
+    else if (auto *r = qgraphicsitem_cast<TransformableRectItem*>(item))
+        r->setRect(g.rect);
+    else if (auto *e = qgraphicsitem_cast<TransformableEllipseItem*>(item)) {
+        e->setRect(g.rect);
+        e->isCircle = g.circle;
+    } else if (auto *p = qgraphicsitem_cast<TransformablePolygonItem*>(item))
+        p->setPolygon(g.polygon);
+    else if (auto *pa = qgraphicsitem_cast<TransformablePathItem*>(item))
+        pa->setPath(g.path);
+    else if (auto *c = qgraphicsitem_cast<TransformableCurveItem*>(item))
+        c->setPoints(g.polygon);
+}
+
+ItemStyle itemStyle(QGraphicsItem *item)
+{
+    ItemStyle s;
+    if (ItemCommon *c = dynamic_cast<ItemCommon*>(item)) {
+        s.penColor   = c->penColor;
+        s.brushColor = c->brushColor;
+        s.penWidth   = c->penWidth;
+        s.penStyle   = c->penStyle;
+    }
+    return s;
+}
+
+void setItemStyle(QGraphicsItem *item, const ItemStyle &s)
+{
+    ItemCommon *c = dynamic_cast<ItemCommon*>(item);
+    if (!c) return;
+    c->penColor   = s.penColor;
+    c->brushColor = s.brushColor;
+    c->penWidth   = s.penWidth;
+    c->penStyle   = s.penStyle;
+
+    const QPen pen(s.penColor, s.penWidth, s.penStyle);
+    if (auto *l = qgraphicsitem_cast<TransformableLineItem*>(item)) {
+        l->setPen(pen);
+    } else if (auto *pa = qgraphicsitem_cast<TransformablePathItem*>(item)) {
+        pa->setPen(pen);
+    } else if (auto *shape = dynamic_cast<QAbstractGraphicsShapeItem*>(item)) {
+        shape->setPen(pen);
+        shape->setBrush(QBrush(s.brushColor));
+    }
+    // 线宽影响紧包围盒，需要同步空间索引
+    CanvasScene::itemGeometryChanged(item);
+    item->update();
+}
+
+bool itemHasBrush(QGraphicsItem *item)
+{
+    return qgraphicsitem_cast<TransformableRectItem*>(item)
+        || qgraphicsitem_cast<TransformableEllipseItem*>(item)
+        || qgraphicsitem_cast<TransformablePolygonItem*>(item);
+}
+
+ItemState captureItemState(QGraphicsItem *item)
+{
+    ItemState st;
+    st.type     = itemTypeName(item);
+    if (ItemCommon *c = dynamic_cast<ItemCommon*>(item))
+        st.id   = c->itemId;
+    st.pos      = item->pos();
+    st.rotation = item->rotation();
+    st.origin   = item->transformOriginPoint();
+    st.z        = item->zValue();
+    st.geometry = itemGeometry(item);
+    st.style    = itemStyle(item);
+    return st;
+}
+
+QTransform itemStateTransform(const ItemState &st)
+{
+    // 与 QGraphicsItem 相同：绕旋转原点旋转后再平移到 pos
+    QTransform t;
+    t.translate(st.pos.x() + st.origin.x(), st.pos.y() + st.origin.y());
+    t.rotate(st.rotation);
+    t.translate(-st.origin.x(), -st.origin.y());
+    return t;
+}
+
+QRectF itemStateBounds(const ItemState &st)
+{
+    const ItemGeometry &g = st.geometry;
+    QRectF local;
+    if (st.type == "TransformableLineItem")
+        local = QRectF(g.line.p1(), g.line.p2()).normalized();
+    else if (st.type == "TransformablePolygonItem" || st.type == "TransformableCurveItem")
+        local = g.polygon.boundingRect();
+    else if (st.type == "TransformablePathItem")
+        local = g.path.controlPointRect();
+    else
+        local = g.rect.normalized();
+
+    // 方头线帽在斜线端点处最远伸出 penWidth * sqrt(2) / 2，抗锯齿再向外约 1 个像素
+    const qreal pad = st.style.penWidth * M_SQRT1_2 + 1;
+    local.adjust(-pad, -pad, pad, pad);
+    return itemStateTransform(st).mapRect(local);
+}
+
+void paintItemState(QPainter *painter, const ItemState &st)
+{
+    const ItemGeometry &g = st.geometry;
+    painter->save();
+    painter->setTransform(itemStateTransform(st), true);
+    painter->setPen(QPen(st.style.penColor, st.style.penWidth, st.style.penStyle));
+    // 线段、任意画笔和贝塞尔曲线没有填充
+    painter->setBrush(Qt::NoBrush);
+    if (st.type == "TransformableLineItem") {
+        painter->drawLine(g.line);
+    } else if (st.type == "TransformablePathItem") {
+        painter->drawPath(g.path);
+    } else if (st.type == "TransformableCurveItem") {
+        painter->drawPath(TransformableCurveItem::curvePath(g.polygon));
+    } else {
+        painter->setBrush(st.style.brushColor);
+        if (st.type == "TransformableRectItem")
+            painter->drawRect(g.rect);
+        else if (st.type == "TransformableEllipseItem")
+            painter->drawEllipse(g.rect);
+        else if (st.type == "TransformablePolygonItem")
+            painter->drawPolygon(g.polygon);
+    }
+    painter->restore();
+}
+
+void applyItemState(QGraphicsItem *item, const ItemState &st)
+{
+    if (st.id) {
+        if (ItemCommon *c = dynamic_cast<ItemCommon*>(item))
+            c->itemId = st.id;
+        ItemCommon::reserveItemId(st.id);
+    }
+    setItemGeometry(item, st.geometry);
+    setItemStyle(item, st.style);
+    item->setPos(st.pos);
+    item->setTransformOriginPoint(st.origin);
+    item->setRotation(st.rotation);
+    item->setZValue(st.z);
+}
+
+QGraphicsItem *createItem(const ItemState &st)
+{
+    const ItemGeometry &g = st.geometry;
+    QGraphicsItem *item = nullptr;
+    if (st.type == "TransformableLineItem")
+        item = new TransformableLineItem(g.line);
+    else if (st.type == "TransformableRectItem")
+        item = new TransformableRectItem(g.rect);
+    else if (st.type == "TransformableEllipseItem")
+        item = new TransformableEllipseItem(g.rect, nullptr, g.circle);
+    else if (st.type == "TransformablePolygonItem")
+        item = new TransformablePolygonItem(g.polygon);
+    else if (st.type == "TransformablePathItem")
+        item = new TransformablePathItem(g.path);
+    else if (st.type == "TransformableCurveItem")
+        item = new TransformableCurveItem(g.polygon);
+    if (item)
+        applyItemState(item, st);
+    return item;
+}
@@ -0,0 +1,87 @@
+#ifndef ITEMSTATE_H
+#define ITEMSTATE_H
+
+#include "common.h"
+#include <QRectF>
+#include <QLineF>
+#include <QPolygonF>
+#include <QPainterPath>
+#include <QTransform>
+
+class QPainter;
+
+// 图元的形状数据，不同类型的图元只使用其中对应的字段
+// QPolygonF / QPainterPath 均为隐式共享，拷贝一份状态的开销是常数级的
+struct ItemGeometry {
+    QRectF rect;        // 矩形、椭圆
+    QLineF line;        // 线段
+    QPolygonF polygon;  // 多边形顶点；贝塞尔曲线的控制点（3n + 1 个）
+    QPainterPath path;  // 任意画笔
+    bool circle = false; // 椭圆是否为正圆
+
+    bool operator==(const ItemGeometry &o) const {
+        return rect == o.rect && line == o.line && polygon == o.polygon && path == o.path
+               && circle == o.circle;
+    }
+    bool operator!=(const ItemGeometry &o) const { return !(*this == o); }
+};
+
+// 图元的样式（对应 ItemCommon 中的图形属性）
+struct ItemStyle {
+    QColor penColor = Qt::black;
+    QColor brushColor = Qt::white;
+    int penWidth = 1;
+    Qt::PenStyle penStyle = Qt::SolidLine;
+
+    bool operator==(const ItemStyle &o) const {
+        return penColor == o.penColor && brushColor == o.brushColor
+               && penWidth == o.penWidth && penStyle == o.penStyle;
+    }
+    bool operator!=(const ItemStyle &o) const { return !(*this == o); }
+};
+
+// 图元在某一时刻的完整状态，撤销重做时用来比较操作前后的差异，
+// 恢复场景时用来比对现有图元与目标状态
+struct ItemState {
+    QString type;       // 与 JSON 中的 "type" 字段一致
+    quint64 id = 0;     // 稳定 ID，0 表示没有
+    QPointF pos;
+    qreal rotation = 0;
+    QPointF origin;     // 旋转原点
+    qreal z = 0;
+    ItemGeometry geometry;
+    ItemStyle style;
+
+    bool operator==(const ItemState &o) const {
+        return type == o.type && id == o.id && pos == o.pos && rotation == o.rotation
+               && origin == o.origin && z == o.z && geometry == o.geometry && style == o.style;
+    }
+    bool operator!=(const ItemState &o) const { return !(*this == o); }
+};
+
+QString itemTypeName(QGraphicsItem *item);
+
+ItemGeometry itemGeometry(QGraphicsItem *item);
+void setItemGeometry(QGraphicsItem *item, const ItemGeometry &geometry);
+
+ItemStyle itemStyle(QGraphicsItem *item);
+void setItemStyle(QGraphicsItem *item, const ItemStyle &style);
+// 线段、任意画笔和贝塞尔曲线没有填充
+bool itemHasBrush(QGraphicsItem *item);
+
+ItemState captureItemState(QGraphicsItem *item);
+// 按状态估算图元绘制出来的像素在场景中的范围（包括线帽和抗锯齿的边缘），不需要创建图元，可在任意线程调用
+QRectF itemStateBounds(const ItemState &state);
+QTransform itemStateTransform(const ItemState &state);
+// 按状态直接绘制图元（与图元未选中时的 paint() 结果相同），painter 为场景坐标，可在任意线程调用
+void paintItemState(QPainter *painter, const ItemState &state);
+// 将图元整体设置为给定状态，类型必须一致
+void applyItemState(QGraphicsItem *item, const ItemState &state);
+// 按状态新建图元（不加入场景），类型未知时返回 nullptr
+QGraphicsItem *createItem(const ItemState &state);
+
+// JSON 与状态互转（见 serialize.cpp），字段与 itemToJson / jsonToItem 相同
+QJsonObject itemStateToJson(const ItemState &state);
+ItemState jsonToItemState(const QJsonObject &obj);
+
+#endif // ITEMSTATE_H
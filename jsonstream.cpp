@@ -0,0 +1,140 @@
+#include "jsonstream.h"
+#include <QJsonDocument>
+#include <QJsonParseError>
+
+static constexpr qint64 ChunkSize = 64 * 1024;
+
+/* ===== 读取 ===== */
+JsonItemReader::JsonItemReader(QIODevice *device)
+    : m_device(device)
+{
+}
+
+void JsonItemReader::fail(const QString &message)
+{
+    m_error = message;
+    m_finished = true;
+}
+
+bool JsonItemReader::fill()
+{
+    // 丢掉已经处理完的部分，只保留当前未结束的对象
+    const qsizetype keep = m_objectStart >= 0 ? m_objectStart : m_pos;
+    if (keep > 0) {
+        m_buf.remove(0, keep);
+        m_pos -= keep;
+        if (m_objectStart >= 0) m_objectStart = 0;
+    }
+    const QByteArray chunk = m_device->read(ChunkSize);
+    if (chunk.isEmpty()) return false;
+    m_buf.append(chunk);
+    return true;
+}
+
+bool JsonItemReader::next(QJsonObject *obj)
+{
+    QByteArray bytes;
+    if (!nextRaw(&bytes)) return false;
+
+    QJsonParseError err;
+    const QJsonDocument doc = QJsonDocument::fromJson(bytes, &err);
+    if (err.error != QJsonParseError::NoError) {
+        fail(err.errorString());
+        return false;
+    }
+    *obj = doc.object();
+    return true;
+}
+
+bool JsonItemReader::nextRaw(QByteArray *bytes)
+{
+    while (!m_finished) {
+        if (m_pos >= m_buf.size() && !fill()) {
+            if (!m_started)
+                fail("document is not a JSON array");
+            else
+                fail("unexpected end of document");
+            return false;
+        }
+
+        if (!m_started && m_pos == 0 && m_buf.startsWith("\xEF\xBB\xBF"))
+            m_pos = 3; // 跳过 UTF-8 BOM
+        if (m_pos >= m_buf.size()) continue;
+
+        const char c = m_buf.at(m_pos++);
+
+        if (!m_started) {
+            // 第一个非空白字符必须是 '['
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') continue;
+            if (c != '[') {
+                fail("document is not a JSON array");
+                return false;
+            }
+            m_started = true;
+            m_depth = 1;
+            continue;
+        }
+
+        if (m_inString) {
+            if (m_escape)         m_escape = false;
+            else if (c == '\\')   m_escape = true;
+            else if (c == '"')    m_inString = false;
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            m_inString = true;
+            break;
+        case '{':
+        case '[':
+            if (c == '{' && m_depth == 1)
+                m_objectStart = m_pos - 1;
+            ++m_depth;
+            break;
+        case '}':
+        case ']':
+            --m_depth;
+            if (m_depth == 0) {
+                // 顶层数组结束
+                m_finished = true;
+                return false;
+            }
+            if (c == '}' && m_depth == 1 && m_objectStart >= 0) {
+                *bytes = m_buf.mid(m_objectStart, m_pos - m_objectStart);
+                m_objectStart = -1;
+                return true;
+            }
+            break;
+        default:
+            // 顶层数组中的逗号、空白以及非对象的值都跳过
+            break;
+        }
+    }
+    return false;
+}
+
+/* ===== 写入 ===== */
+JsonItemWriter::JsonItemWriter(QIODevice *device)
+    : m_device(device)
+{
+}
+
+bool JsonItemWriter::begin()
+{
+    m_first = true;
+    return m_device->write("[\n") == 2;
+}
+
+bool JsonItemWriter::write(const QJsonObject &obj)
+{
+    QByteArray bytes = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    bytes.prepend(m_first ? "    " : ",\n    ");
+    m_first = false;
+    return m_device->write(bytes) == bytes.size();
+}
+
+bool JsonItemWriter::end()
+{
+    return m_device->write("\n]\n") == 3;
+}
@@ -0,0 +1,54 @@
+#ifndef JSONSTREAM_H
+#define JSONSTREAM_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QJsonObject>
+
+// 流式读写 JSON 文档（顶层为图元对象数组）。
+// 读取时按块读入，只切出当前这一个图元对象交给 QJsonDocument 解析；
+// 写入时逐个图元写出。内存占用只与单个图元的大小有关，与文档大小无关。
+
+class JsonItemReader
+{
+public:
+    explicit JsonItemReader(QIODevice *device);
+
+    // 读出下一个图元对象，读完或出错时返回 false，用 hasError() 区分
+    bool next(QJsonObject *obj);
+    // 同 next()，但只切出对象的原始字节不解析，便于交给其他线程解析
+    bool nextRaw(QByteArray *bytes);
+    bool hasError() const { return !m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+
+private:
+    bool fill();            // 读入下一块，文件结束时返回 false
+    void fail(const QString &message);
+
+    QIODevice *m_device;
+    QByteArray m_buf;
+    qsizetype m_pos = 0;    // 下一个待扫描字节
+    qsizetype m_objectStart = -1; // 当前图元对象在 m_buf 中的起点，-1 表示不在对象内
+    int m_depth = 0;        // 括号嵌套深度，顶层数组内部为 1
+    bool m_inString = false;
+    bool m_escape = false;
+    bool m_started = false; // 已读到顶层 '['
+    bool m_finished = false;
+    QString m_error;
+};
+
+class JsonItemWriter
+{
+public:
+    explicit JsonItemWriter(QIODevice *device);
+
+    bool begin();
+    bool write(const QJsonObject &obj);
+    bool end();
+
+private:
+    QIODevice *m_device;
+    bool m_first = true;
+};
+
+#endif // JSONSTREAM_H
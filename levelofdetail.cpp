@@ -0,0 +1,58 @@
+#include "levelofdetail.h"
+#include "strokefitting.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+int LodPyramid::levelFor(qreal lod)
+{
+    if (lod >= 1 || lod <= 0) return -1;
+    return qMin(LEVELS - 1, int(std::floor(std::log2(1 / lod))));
+}
+
+const QList<QPolygonF> &LodPyramid::level(int level)
+{
+    for (int k = m_built + 1; k <= level; ++k) {
+        const QList<QPolygonF> &prev = k == 0 ? m_source : m_levels[k - 1];
+        // 每层的容差只取半个像素对应值的一半，各层偏差累加后仍不超过半个像素
+        const qreal tolerance = 0.25 * (1 << k);
+        QList<QPolygonF> &out = m_levels[k];
+        out.clear();
+        out.reserve(prev.size());
+        for (const QPolygonF &poly : prev)
+            out.append(simplifyPolyline(poly, tolerance));
+    }
+    m_built = qMax(m_built, level);
+    return m_levels[level];
+}
+
+const QList<QPolygonF> &LodPyramid::pathLevel(const QPainterPath &source, int lvl)
+{
+    if (m_built < 0 && m_source.isEmpty())
+        m_source = source.toSubpathPolygons();
+    return level(lvl);
+}
+
+const QPolygonF &LodPyramid::polygonLevel(const QPolygonF &source, int lvl)
+{
+    if (m_built < 0 && m_source.isEmpty())
+        m_source.append(source);
+    return level(lvl).first();
+}
+
+bool paintCollapsed(QPainter *painter, const QRectF &bounds, qreal lod, const QColor &color)
+{
+    if (bounds.width() * lod >= 1 || bounds.height() * lod >= 1)
+        return false;
+    painter->fillRect(bounds, color);
+    return true;
+}
+
+void paintSelectionOutline(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                           const QRectF &bounds)
+{
+    if (!(option->state & QStyle::State_Selected)) return;
+    painter->setPen(QPen(option->palette.windowText(), 0, Qt::DashLine));
+    painter->setBrush(Qt::NoBrush);
+    painter->drawRect(bounds);
+}
@@ -0,0 +1,45 @@
+#ifndef LEVELOFDETAIL_H
+#define LEVELOFDETAIL_H
+
+#include <QPolygonF>
+#include <QPainterPath>
+#include <QList>
+#include <array>
+
+class QPainter;
+class QStyleOptionGraphicsItem;
+
+// 层次细节（LOD）金字塔：缩小显示时用抽稀后的折线代替完整几何绘制。
+// 第 k 层在第 k - 1 层的基础上按 0.25 * 2^k 个场景单位的容差继续抽稀，
+// 逐层累积的偏差为 0.25 * (2^(k+1) - 1) < 0.5 * 2^k，在对应的缩放比例下不超过半个像素。
+// 各层在第一次用到时才生成，几何变化后整体丢弃
+class LodPyramid
+{
+public:
+    static constexpr int LEVELS = 8;
+    // 顶点 / 路径元素少于这个数的图形直接按原几何绘制
+    static constexpr int MIN_POINTS = 64;
+
+    // lod 为 QStyleOptionGraphicsItem::levelOfDetailFromTransform() 的值，返回 -1 表示按原几何绘制
+    static int levelFor(qreal lod);
+
+    // 路径按子路径拆成折线（曲线先展平）后逐层抽稀
+    const QList<QPolygonF> &pathLevel(const QPainterPath &source, int level);
+    // 多边形逐层抽稀
+    const QPolygonF &polygonLevel(const QPolygonF &source, int level);
+
+private:
+    const QList<QPolygonF> &level(int level);
+
+    QList<QPolygonF> m_source;                      // 第 0 层之前的原始折线
+    std::array<QList<QPolygonF>, LEVELS> m_levels;
+    int m_built = -1;                               // 已生成到第几层
+};
+
+// 图形在屏幕上不足一个像素时画成一个点（item 坐标下 bounds 的大小填充 color），返回是否已经画过
+bool paintCollapsed(QPainter *painter, const QRectF &bounds, qreal lod, const QColor &color);
+// 自己绘制几何时补上与 QGraphicsItem 默认一致的选中虚线框
+void paintSelectionOutline(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                           const QRectF &bounds);
+
+#endif // LEVELOFDETAIL_H
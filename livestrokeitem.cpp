@@ -0,0 +1,156 @@
+#include "livestrokeitem.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+LiveStrokeItem::LiveStrokeItem(const QPointF &start, const QPen &pen, qreal scale, QGraphicsItem *parent)
+    : QGraphicsItem(parent), m_pen(pen), m_scale(scale > 0 ? scale : 1)
+{
+    setFlag(ItemUsesExtendedStyleOption); // 只绘制 exposedRect 对应的那部分缓存
+    m_points.reserve(1024);
+    m_points.append(start);
+    const qreal half = strokePad();
+    m_strokeBounds = QRectF(start, start).adjusted(-half, -half, half, half);
+}
+
+void LiveStrokeItem::appendPoint(const QPointF &point)
+{
+    const QPointF last = m_points.constLast();
+    if (point == last) return;
+
+    const qreal half = strokePad();
+    const QRectF segment = QRectF(last, point).normalized().adjusted(-half, -half, half, half);
+    m_strokeBounds |= segment;
+
+    // 缓存需要重画时只画到上一个点为止，新线段在下面画
+    ensureRaster(segment);
+    m_points.append(point);
+    if (!m_raster.isNull()) {
+        QPainter p(&m_raster);
+        drawSegment(&p, last, point);
+    }
+    m_length += QLineF(last, point).length();
+    update(segment);
+}
+
+qreal LiveStrokeItem::strokePad() const
+{
+    // 半个线宽再加一个像素的抗锯齿边缘；线宽为 0（cosmetic）时按一个像素算
+    const qreal pixel = 1 / m_scale;
+    return qMax(m_pen.widthF(), pixel) / 2 + pixel;
+}
+
+QPainterPath LiveStrokeItem::toPath() const
+{
+    QPainterPath path;
+    path.reserve(m_points.size());
+    path.moveTo(m_points.constFirst());
+    for (qsizetype i = 1; i < m_points.size(); ++i)
+        path.lineTo(m_points.at(i));
+    return path;
+}
+
+QRectF LiveStrokeItem::boundingRect() const
+{
+    return m_coverRect;
+}
+
+void LiveStrokeItem::setRasterScale(qreal scale)
+{
+    if (scale <= 0 || qFuzzyCompare(scale, m_scale)) return;
+    m_scale = scale;
+    rebuildRaster();
+    update();
+}
+
+void LiveStrokeItem::ensureRaster(const QRectF &rect)
+{
+    if (m_coverRect.contains(rect)) return;
+
+    // 向需要的方向多扩出当前尺寸的一半（至少 256 像素）
+    const QRectF needed = m_coverRect.isNull() ? rect : m_coverRect.united(rect);
+    const qreal pad = qMax(256 / m_scale, qMax(m_coverRect.width(), m_coverRect.height()) / 2);
+    QRectF grown = needed;
+    if (needed.left() < m_coverRect.left() || m_coverRect.isNull())     grown.setLeft(needed.left() - pad);
+    if (needed.top() < m_coverRect.top() || m_coverRect.isNull())       grown.setTop(needed.top() - pad);
+    if (needed.right() > m_coverRect.right() || m_coverRect.isNull())   grown.setRight(needed.right() + pad);
+    if (needed.bottom() > m_coverRect.bottom() || m_coverRect.isNull()) grown.setBottom(needed.bottom() + pad);
+
+    prepareGeometryChange();
+    const QRectF old = m_coverRect;
+    m_coverRect = grown;
+
+    const QSize size = rasterSize();
+    if (m_raster.isNull() || size.isEmpty()) {
+        rebuildRaster();
+        return;
+    }
+    // 旧缓存原样搬到新缓存中
+    QImage raster(size, QImage::Format_ARGB32_Premultiplied);
+    raster.fill(Qt::transparent);
+    QPainter p(&raster);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    p.drawImage((old.topLeft() - grown.topLeft()) * m_scale, m_raster);
+    p.end();
+    m_raster = raster;
+}
+
+QSize LiveStrokeItem::rasterSize() const
+{
+    const QSize size = (m_coverRect.size() * m_scale).toSize() + QSize(1, 1);
+    if (m_coverRect.isNull() || size.width() > MAX_RASTER_SIDE || size.height() > MAX_RASTER_SIDE)
+        return QSize();
+    return size;
+}
+
+void LiveStrokeItem::rebuildRaster()
+{
+    // 放大很多倍时笔画的像素尺寸可能非常大，不再缓存，直接绘制折线
+    const QSize size = rasterSize();
+    if (size.isEmpty()) {
+        m_raster = QImage();
+        return;
+    }
+
+    m_raster = QImage(size, QImage::Format_ARGB32_Premultiplied);
+    m_raster.fill(Qt::transparent);
+    QPainter p(&m_raster);
+    m_length = 0;
+    for (qsizetype i = 1; i < m_points.size(); ++i) {
+        drawSegment(&p, m_points.at(i - 1), m_points.at(i));
+        m_length += QLineF(m_points.at(i - 1), m_points.at(i)).length();
+    }
+}
+
+void LiveStrokeItem::drawSegment(QPainter *p, const QPointF &from, const QPointF &to)
+{
+    p->setRenderHint(QPainter::Antialiasing);
+    p->resetTransform();
+    p->scale(m_scale, m_scale);
+    p->translate(-m_coverRect.topLeft());
+
+    // 虚线的图案以线宽为单位，逐段绘制时要从上一段结束处的相位继续
+    QPen pen = m_pen;
+    const qreal unit = qMax<qreal>(pen.widthF(), 1);
+    pen.setDashOffset(m_length / unit);
+    p->setPen(pen);
+    p->drawLine(from, to);
+}
+
+void LiveStrokeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+                           QWidget *widget)
+{
+    Q_UNUSED(widget)
+    if (m_raster.isNull()) {
+        // 没有光栅缓存时直接绘制折线
+        painter->setRenderHint(QPainter::Antialiasing);
+        painter->setPen(m_pen);
+        painter->drawPolyline(m_points.constData(), int(m_points.size()));
+        return;
+    }
+
+    const QRectF target = option->exposedRect & m_coverRect;
+    if (target.isEmpty()) return;
+    const QRectF source((target.topLeft() - m_coverRect.topLeft()) * m_scale, target.size() * m_scale);
+    painter->drawImage(target, m_raster, source);
+}
@@ -0,0 +1,56 @@
+#ifndef LIVESTROKEITEM_H
+#define LIVESTROKEITEM_H
+
+#include <QGraphicsItem>
+#include <QPainterPath>
+#include <QImage>
+#include <QPen>
+#include <QVector>
+
+// 画笔工具正在绘制中的笔画
+// 采样点只追加不重建，包围盒增量更新，已画出的部分按视图的缩放比例缓存在一张光栅图里
+// （1 个设备像素对应 1 个光栅像素），每次追加只把新线段画进缓存并刷新这一小块区域。
+// 缩放比例变化时按新比例重画缓存；缓存大到超过 MAX_RASTER_SIDE 时改为直接绘制折线。
+// 松开鼠标后由 CustomView 转换成 TransformablePathItem
+class LiveStrokeItem : public QGraphicsItem
+{
+public:
+    // 光栅缓存的边长上限（像素）
+    static constexpr int MAX_RASTER_SIDE = 4096;
+
+    // scale 为视图的缩放比例（每个场景单位对应的设备像素数）
+    LiveStrokeItem(const QPointF &start, const QPen &pen, qreal scale = 1,
+                   QGraphicsItem *parent = nullptr);
+
+    void appendPoint(const QPointF &point);
+    const QVector<QPointF> &points() const { return m_points; }
+    QRectF strokeBounds() const { return m_strokeBounds; }
+    QPainterPath toPath() const;
+    // 视图缩放后调用，按新比例重画光栅缓存
+    void setRasterScale(qreal scale);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
+private:
+    // 保证光栅缓存覆盖 rect，不够时成倍扩大，避免每次追加都重新分配
+    void ensureRaster(const QRectF &rect);
+    // 线段四周需要刷新的宽度（item 单位）
+    qreal strokePad() const;
+    // 按 m_coverRect 和 m_scale 重新分配光栅缓存并画入已有的全部线段
+    void rebuildRaster();
+    // m_coverRect 按 m_scale 对应的缓存大小，超过 MAX_RASTER_SIDE 时为空
+    QSize rasterSize() const;
+    void drawSegment(QPainter *p, const QPointF &from, const QPointF &to);
+
+    QPen m_pen;
+    QVector<QPointF> m_points;
+    QRectF m_strokeBounds;  // 所有线段外扩半个线宽后的范围
+    qreal m_length = 0;     // 已画笔画的总长，用来接续虚线的相位
+    qreal m_scale = 1;      // 光栅缓存每个 item 单位对应的像素数
+    QImage m_raster;        // 已画部分的光栅缓存，为空时直接绘制折线
+    QRectF m_coverRect;     // 光栅缓存覆盖的范围（item 坐标），即 boundingRect()
+};
+
+#endif // LIVESTROKEITEM_H
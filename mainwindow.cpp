@@ -1,6 +1,17 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "common.h"
+#include "canvasscene.h"
+#include "documentsaver.h"
+#include <QSettings>
+#include <QStandardPaths>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QSpinBox>
+#include <QFileDialog>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -17,6 +28,7 @@ MainWindow::MainWindow(QWidget *parent)
     sideBarButtonGroup->addButton(ui->selectButton, 0);
     sideBarButtonGroup->addButton(ui->penButton, 1);
     sideBarButtonGroup->addButton(ui->lineButton, 2);
+    sideBarButtonGroup->addButton(ui->curveButton, 3);
     sideBarButtonGroup->addButton(ui->rectButton, 4);
     sideBarButtonGroup->addButton(ui->polygonButton, 5);
     sideBarButtonGroup->addButton(ui->circleButton, 6);
@@ -43,6 +55,7 @@ MainWindow::MainWindow(QWidget *parent)
     painterActionGroup->addAction(ui->rectSelectAction);
     painterActionGroup->addAction(ui->penAction);
     painterActionGroup->addAction(ui->lineAction);
+    painterActionGroup->addAction(ui->curveAction);
     painterActionGroup->addAction(ui->rectAction);
     painterActionGroup->addAction(ui->polygonAction);
     painterActionGroup->addAction(ui->circleAction);
@@ -65,12 +78,29 @@ MainWindow::MainWindow(QWidget *parent)
     ui->solidAction->setChecked(true);
 
     // 创建场景
-    m_scene = new QGraphicsScene(ui->graphicsView);
-    m_scene->setSceneRect(ui->graphicsView->sceneRect());
+    m_scene = new CanvasScene(ui->graphicsView);
     ui->graphicsView->setScene(m_scene);
 
+    // 自动保存
+    Autosaver *autosaver = ui->graphicsView->autosaver();
+    QSettings settings("Protoshop", "Protoshop");
+    autosaver->setScene(m_scene);
+    autosaver->setDirectory(settings.value("autosave/dir",
+        QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/autosave").toString());
+    autosaver->setDiskBudget(settings.value("autosave/budgetMB",
+        Autosaver::DEFAULT_DISK_BUDGET / (1024 * 1024)).toLongLong() * 1024 * 1024);
+    autosaver->setInterval(settings.value("autosave/intervalSec", 120).toInt() * 1000);
+
+    // 任意画笔的简化容差
+    ui->graphicsView->strokeTolerance = settings.value("pen/strokeTolerance", 1.0).toDouble();
+
+    // 图元绘制缓存的预算
+    m_scene->renderCache()->setBudget(settings.value("render/cacheMB",
+        RenderCache::DEFAULT_BUDGET / (1024 * 1024)).toLongLong() * 1024 * 1024);
+
     // 连接信号与槽
     connect(ui->graphicsView, &CustomView::sendMousePos, this, &MainWindow::receiveMousePos);
+    connect(m_scene, &QGraphicsScene::sceneRectChanged, ui->graphicsView, &CustomView::growSceneRect);
     connect(ui->palatteButton, &QPushButton::clicked, ui->graphicsView, &CustomView::palatteButtonClicked);
     connect(ui->delete_action, &QAction::triggered, ui->graphicsView, &CustomView::onDeleteActionClicked);
     connect(ui->saveAction, &QAction::triggered, ui->graphicsView, &CustomView::onSaveAs);
@@ -81,6 +111,7 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->rectSelectAction, &QAction::triggered, ui->selectButton, &QPushButton::click);
     connect(ui->penAction, &QAction::triggered, ui->penButton, &QPushButton::click);
     connect(ui->lineAction, &QAction::triggered, ui->lineButton, &QPushButton::click);
+    connect(ui->curveAction, &QAction::triggered, ui->curveButton, &QPushButton::click);
     connect(ui->rectAction, &QAction::triggered, ui->rectButton, &QPushButton::click);
     connect(ui->polygonAction, &QAction::triggered, ui->polygonButton, &QPushButton::click);
     connect(ui->circleAction, &QAction::triggered, ui->circleButton, &QPushButton::click);
@@ -96,6 +127,9 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->hotkeysHelp, &QAction::triggered, this, &MainWindow::onHelpTriggered);
     connect(ui->about, &QAction::triggered, this, &MainWindow::onAboutTriggered);
     connect(ui->widthAction, &QAction::triggered, this, &MainWindow::onWidthAction);
+    connect(ui->strokeToleranceAction, &QAction::triggered, this, &MainWindow::onStrokeToleranceAction);
+    connect(ui->autosaveAction, &QAction::triggered, this, &MainWindow::onAutosaveAction);
+    connect(ui->exportAction, &QAction::triggered, this, &MainWindow::onExportAction);
 }
 
 MainWindow::~MainWindow()
@@ -123,6 +157,16 @@ void MainWindow::on_lineButton_clicked()
 }
 
 
+void MainWindow::on_curveButton_clicked()
+{
+    if (ui->curveButton->isChecked())
+    {
+        ui->graphicsView->setPainterStatus(PainterStatus::CURVE);
+        ui->curveAction->setChecked(true);
+    }
+}
+
+
 void MainWindow::on_rectButton_clicked()
 {
     if (ui->rectButton->isChecked())
@@ -256,7 +300,11 @@ void MainWindow::onHelpTriggered()
            "<b>Ctrl+Y</b> – 重做<br/>"
            "<b>Ctrl+S</b> – 保存为 PNG 或 Json<br/>"
            "<b>鼠标左键</b> – 绘制/选中/缩放/旋转/调节节点<br/>"
-           "<b>鼠标右键</b> – 结束多边形</p>"
+           "<b>鼠标右键</b> – 结束多边形 / 贝塞尔曲线<br/>"
+           "<b>贝塞尔曲线</b> – 点击添加锚点，按住拖动拉出控制柄；编辑时按住 Alt 拖动锚点拉出控制柄<br/>"
+           "<b>鼠标滚轮</b> – 以光标为中心缩放（按住 Shift 时滚动）<br/>"
+           "<b>Ctrl+= / Ctrl+- / Ctrl+0</b> – 放大 / 缩小 / 恢复原始大小<br/>"
+           "<b>鼠标中键拖动</b> – 平移画布</p>"
            "<p>暂不支持自定义快捷键。</p>"));
     box.setStandardButtons(QMessageBox::Ok);
     box.setDefaultButton(QMessageBox::Ok);
@@ -382,6 +430,90 @@ void MainWindow::onWidthAction()
     }
 }
 
+void MainWindow::onStrokeToleranceAction()
+{
+    bool ok = false;
+    const double tolerance = QInputDialog::getDouble(this, tr("画笔简化容差设置"),
+        tr("任意画笔的简化容差（像素，0 表示保留全部采样点）:"), ui->graphicsView->strokeTolerance, 0, 10, 2, &ok);
+    if (!ok) return;
+
+    ui->graphicsView->strokeTolerance = tolerance;
+    QSettings settings("Protoshop", "Protoshop");
+    settings.setValue("pen/strokeTolerance", tolerance);
+}
+
+void MainWindow::onAutosaveAction()
+{
+    Autosaver *autosaver = ui->graphicsView->autosaver();
+    bool ok = false;
+    const int interval = QInputDialog::getInt(this, tr("自动保存设置"),
+        tr("自动保存间隔（秒，0 表示关闭）:"), autosaver->interval() / 1000, 0, 3600, 10, &ok);
+    if (!ok) return;
+    const int budget = QInputDialog::getInt(this, tr("自动保存设置"),
+        tr("自动保存占用的磁盘空间上限（MB）:"), int(autosaver->diskBudget() / (1024 * 1024)), 1, 100000, 10, &ok);
+    if (!ok) return;
+
+    autosaver->setInterval(interval * 1000);
+    autosaver->setDiskBudget(qint64(budget) * 1024 * 1024);
+    QSettings settings("Protoshop", "Protoshop");
+    settings.setValue("autosave/intervalSec", interval);
+    settings.setValue("autosave/budgetMB", budget);
+}
+
+void MainWindow::onExportAction()
+{
+    QDialog dlg(this);
+    dlg.setWindowTitle(tr("导出图片"));
+    auto *form = new QFormLayout(&dlg);
+
+    auto *regionBox = new QComboBox(&dlg);
+    regionBox->addItem(tr("所有图元"), int(CustomView::ExportRegion::Drawing));
+    regionBox->addItem(tr("整个画布（从原点开始）"), int(CustomView::ExportRegion::Canvas));
+    regionBox->addItem(tr("仅选中的图元"), int(CustomView::ExportRegion::Selection));
+    form->addRow(tr("导出区域:"), regionBox);
+
+    auto *scaleSpin = new QDoubleSpinBox(&dlg);
+    scaleSpin->setRange(0.05, 16);
+    scaleSpin->setSingleStep(0.5);
+    scaleSpin->setValue(1);
+    scaleSpin->setSuffix("x");
+    form->addRow(tr("缩放倍数:"), scaleSpin);
+
+    // 指定 DPI 时缩放倍数由 DPI 换算（画布 1 单位 = 96 DPI 下的 1 像素）
+    auto *dpiSpin = new QSpinBox(&dlg);
+    dpiSpin->setRange(0, 2400);
+    dpiSpin->setSingleStep(72);
+    dpiSpin->setSpecialValueText(tr("不指定"));
+    form->addRow(tr("目标 DPI:"), dpiSpin);
+    connect(dpiSpin, &QSpinBox::valueChanged, scaleSpin, [scaleSpin](int dpi) {
+        scaleSpin->setEnabled(dpi == 0);
+        if (dpi > 0) scaleSpin->setValue(scaleForDpi(dpi));
+    });
+
+    auto *supersampleBox = new QComboBox(&dlg);
+    supersampleBox->addItem(tr("关闭"), 1);
+    supersampleBox->addItem("2x2", 2);
+    supersampleBox->addItem("3x3", 3);
+    supersampleBox->addItem("4x4", 4);
+    form->addRow(tr("超采样:"), supersampleBox);
+
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+    connect(buttons, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    form->addRow(buttons);
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("导出图片"), "", "PNG 图片 (*.png)");
+    if (fileName.isEmpty()) return;
+
+    ExportOptions options;
+    options.dpi = dpiSpin->value();
+    options.scale = options.dpi > 0 ? scaleForDpi(options.dpi) : scaleSpin->value();
+    options.supersample = supersampleBox->currentData().toInt();
+    ui->graphicsView->exportPng(fileName, options,
+                                CustomView::ExportRegion(regionBox->currentData().toInt()));
+}
+
 void MainWindow::on_fillSelectButton_clicked()
 {
     if(ui->fillSelectButton->isChecked()){
@@ -16,6 +16,8 @@
 #include <QKeyEvent>
 #include <QInputDialog>
 
+class CanvasScene;
+
 QT_BEGIN_NAMESPACE
 namespace Ui {
 class MainWindow;
@@ -35,6 +37,8 @@ private slots:
 
     void on_lineButton_clicked();
 
+    void on_curveButton_clicked();
+
     void on_rectButton_clicked();
 
     void on_polygonButton_clicked();
@@ -72,6 +76,10 @@ private slots:
     void keyPressEvent(QKeyEvent *ev) override;
 
     void onWidthAction();
+    void onStrokeToleranceAction();
+
+    void onAutosaveAction();
+    void onExportAction();
 
     void on_fillSelectButton_clicked();
 
@@ -82,7 +90,7 @@ private:
     QActionGroup* painterActionGroup = nullptr;
     QActionGroup* colorTypeActionGroup = nullptr;
     QActionGroup* lineTypeActionGroup = nullptr;
-    QGraphicsScene* m_scene = nullptr;
+    CanvasScene* m_scene = nullptr;
 
 public:
     Ui::MainWindow *ui;
@@ -0,0 +1,94 @@
+#include "pathchunks.h"
+#include <QPainter>
+
+void PathChunks::build(const QPainterPath &path)
+{
+    m_chunks.clear();
+    const int n = path.elementCount();
+    Chunk chunk{0, 0, QPointF(), QRectF()};
+    int elements = 0; // 本段的元素数
+    QPointF last;
+    // 本段控制点的范围
+    qreal left = 0, top = 0, right = 0, bottom = 0;
+    auto extend = [&](const QPointF &p) {
+        left = qMin(left, p.x());   right = qMax(right, p.x());
+        top = qMin(top, p.y());     bottom = qMax(bottom, p.y());
+    };
+    auto startChunk = [&](int begin, const QPointF &start) {
+        chunk = Chunk{begin, begin, start, QRectF()};
+        elements = 0;
+        left = right = start.x();
+        top = bottom = start.y();
+    };
+    auto flush = [&](int end) {
+        chunk.end = end;
+        if (elements > 0) {
+            chunk.bounds = QRectF(QPointF(left, top), QPointF(right, bottom));
+            m_chunks.append(chunk);
+        }
+    };
+
+    for (int i = 0; i < n; ++i) {
+        const QPainterPath::Element e = path.elementAt(i);
+        if (e.type == QPainterPath::MoveToElement) {
+            // 子路径的开头另起一段
+            flush(i);
+            startChunk(i + 1, e);
+            last = e;
+            continue;
+        }
+        if (elements >= CHUNK_ELEMENTS) {
+            // 新的一段从上一段的终点开始，保证段与段之间连续
+            flush(i);
+            startChunk(i, last);
+        }
+        if (e.type == QPainterPath::CurveToElement && i + 2 < n) {
+            extend(e);
+            extend(path.elementAt(i + 1));
+            last = path.elementAt(i + 2);
+            extend(last);
+            elements += 3;
+            i += 2;
+        } else if (e.type == QPainterPath::LineToElement) {
+            last = e;
+            extend(last);
+            ++elements;
+        }
+    }
+    flush(n);
+}
+
+bool PathChunks::canDraw(const QPen &pen)
+{
+    return pen.style() == Qt::SolidLine;
+}
+
+int PathChunks::draw(QPainter *painter, const QPainterPath &path, const QRectF &rect, qreal margin) const
+{
+    int drawn = 0;
+    const QRectF target = rect.adjusted(-margin, -margin, margin, margin);
+    QPainterPath visible;
+    int runEnd = -1; // 上一个可见段的结束下标，紧接着它的段接在同一条子路径上
+    for (const Chunk &chunk : m_chunks) {
+        // 水平或竖直的段包围盒宽或高为 0，不能用 QRectF::intersects
+        if (chunk.bounds.right() < target.left() || chunk.bounds.left() > target.right()
+            || chunk.bounds.bottom() < target.top() || chunk.bounds.top() > target.bottom())
+            continue;
+        if (chunk.begin != runEnd)
+            visible.moveTo(chunk.start);
+        for (int i = chunk.begin; i < chunk.end; ++i) {
+            const QPainterPath::Element e = path.elementAt(i);
+            if (e.type == QPainterPath::CurveToElement && i + 2 < chunk.end) {
+                visible.cubicTo(e, path.elementAt(i + 1), path.elementAt(i + 2));
+                i += 2;
+            } else if (e.type == QPainterPath::LineToElement) {
+                visible.lineTo(e);
+            }
+        }
+        runEnd = chunk.end;
+        ++drawn;
+    }
+    if (drawn)
+        painter->drawPath(visible);
+    return drawn;
+}
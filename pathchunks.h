@@ -0,0 +1,43 @@
+#ifndef PATHCHUNKS_H
+#define PATHCHUNKS_H
+
+#include <QPainterPath>
+#include <QList>
+
+class QPainter;
+class QPen;
+
+// 长笔画按元素数切成若干段，各段只记下在原路径中的元素范围和包围盒（item 坐标），不复制路径。
+// 局部重绘时只描边与重绘区域相交的段，避免每次都描边整条路径。
+// 相邻两段共享连接处的端点，曲线段不会被拆开。
+// 连续的可见段拼成同一条子路径，段与段之间仍是原来的连接样式；各条子路径合成一个路径一次描边，
+// 自身交叠的部分和整条描边一样只画一次，所以半透明和任意线宽的实线画笔都可以分段绘制。
+// 断开处的线头落在重绘区域外扩 margin 之外，看不到
+class PathChunks
+{
+public:
+    // 每段最多的路径元素数（三次曲线计 3 个）
+    static constexpr int CHUNK_ELEMENTS = 256;
+
+    // pen 能否分段描边：虚线的花纹需要整条连续绘制，分段后会在子路径开头重新开始
+    static bool canDraw(const QPen &pen);
+
+    void build(const QPainterPath &path);
+    bool isEmpty() const { return m_chunks.isEmpty(); }
+    int size() const { return int(m_chunks.size()); }
+
+    // 用 painter 当前的画笔描边 path（build() 时的路径）中与 rect 相交的段，
+    // margin 为包围盒需要外扩的距离（线宽、抗锯齿等），返回画了几段
+    int draw(QPainter *painter, const QPainterPath &path, const QRectF &rect, qreal margin) const;
+
+private:
+    struct Chunk {
+        int begin;     // 第一个元素在原路径中的下标
+        int end;       // 最后一个元素之后的下标
+        QPointF start; // 段的起点（上一段的终点，或本段开头的 MoveTo）
+        QRectF bounds; // 控制点包围盒，不含线宽
+    };
+    QList<Chunk> m_chunks;
+};
+
+#endif // PATHCHUNKS_H
@@ -0,0 +1,446 @@
+#include "psbformat.h"
+#include <QSaveFile>
+#include <QHash>
+#include <QSysInfo>
+#include <cstring>
+
+static_assert(sizeof(QPointF) == 2 * sizeof(double), "QPointF must be two doubles");
+
+static quint8 psbType(const QString &type)
+{
+    if (type == "TransformableRectItem")    return Psb::Rect;
+    if (type == "TransformableEllipseItem") return Psb::Ellipse;
+    if (type == "TransformableLineItem")    return Psb::Line;
+    if (type == "TransformablePolygonItem") return Psb::Polygon;
+    if (type == "TransformablePathItem")    return Psb::Path;
+    if (type == "TransformableCurveItem")   return Psb::Curve;
+    return 0;
+}
+
+static QString psbTypeName(quint8 type)
+{
+    switch (type) {
+    case Psb::Rect:    return "TransformableRectItem";
+    case Psb::Ellipse: return "TransformableEllipseItem";
+    case Psb::Line:    return "TransformableLineItem";
+    case Psb::Polygon: return "TransformablePolygonItem";
+    case Psb::Path:    return "TransformablePathItem";
+    case Psb::Curve:   return "TransformableCurveItem";
+    default:           return QString();
+    }
+}
+
+static quint64 align8(quint64 n)
+{
+    return (n + 7) & ~quint64(7);
+}
+
+bool isCompressedPsb(const QString &fileName)
+{
+    return fileName.endsWith(".psbz", Qt::CaseInsensitive);
+}
+
+/* ===== 写入 ===== */
+namespace {
+
+// 写入分两遍：先生成文件头、样式表和图元记录（每个图元一条定长记录），
+// 再按同样的顺序逐个图元生成坐标和路径元素，坐标不需要整段留在内存中
+struct PsbLayout {
+    Psb::Header header = {};
+    QList<Psb::Style> styles;
+    QList<Psb::Item> items;
+    QList<qsizetype> sources; // items[i] 对应的 states 下标
+    quint64 size = 0;         // 文件总长度
+};
+
+} // namespace
+
+static quint32 psbCoordCount(const ItemState &st, quint8 type)
+{
+    switch (type) {
+    case Psb::Polygon:
+    case Psb::Curve:
+        return quint32(2 * st.geometry.polygon.size());
+    case Psb::Path:
+        return quint32(2 * st.geometry.path.elementCount());
+    default:
+        return 4;
+    }
+}
+
+static PsbLayout psbLayout(const QList<ItemState> &states)
+{
+    PsbLayout layout;
+    QHash<QByteArray, quint32> styleIndex;
+    layout.items.reserve(states.size());
+    quint64 coordCount = 0;
+    quint64 elementCount = 0;
+
+    for (qsizetype i = 0; i < states.size(); ++i) {
+        const ItemState &st = states.at(i);
+        const quint8 type = psbType(st.type);
+        if (!type) continue;
+
+        Psb::Style style;
+        style.penColor   = st.style.penColor.rgba();
+        style.brushColor = st.style.brushColor.rgba();
+        style.penWidth   = st.style.penWidth;
+        style.penStyle   = st.style.penStyle;
+        const QByteArray key(reinterpret_cast<const char*>(&style), sizeof(style));
+        auto found = styleIndex.constFind(key);
+        if (found == styleIndex.cend()) {
+            found = styleIndex.insert(key, quint32(layout.styles.size()));
+            layout.styles.append(style);
+        }
+
+        Psb::Item item = {};
+        item.id        = st.id;
+        item.type      = type;
+        item.flags     = st.geometry.circle ? Psb::Circle : 0;
+        item.style     = found.value();
+        item.z         = st.z;
+        item.rotation  = st.rotation;
+        item.pos[0]    = st.pos.x();
+        item.pos[1]    = st.pos.y();
+        item.origin[0] = st.origin.x();
+        item.origin[1] = st.origin.y();
+        item.coordIndex   = coordCount;
+        item.coordCount   = psbCoordCount(st, type);
+        item.elementIndex = elementCount;
+        if (type == Psb::Path)
+            item.elementCount = quint32(st.geometry.path.elementCount());
+        coordCount += item.coordCount;
+        elementCount += item.elementCount;
+        layout.items.append(item);
+        layout.sources.append(i);
+    }
+
+    Psb::Header &header = layout.header;
+    std::memcpy(header.magic, Psb::Magic, sizeof(header.magic));
+    header.version       = Psb::Version;
+    header.headerSize    = sizeof(Psb::Header);
+    header.styleCount    = quint32(layout.styles.size());
+    header.itemCount     = quint32(layout.items.size());
+    header.styleOffset   = align8(sizeof(Psb::Header));
+    header.itemOffset    = align8(header.styleOffset + layout.styles.size() * sizeof(Psb::Style));
+    header.coordOffset   = align8(header.itemOffset + layout.items.size() * sizeof(Psb::Item));
+    header.coordCount    = coordCount;
+    header.elementOffset = align8(header.coordOffset + coordCount * sizeof(double));
+    header.elementCount  = elementCount;
+    layout.size          = header.elementOffset + elementCount;
+    return layout;
+}
+
+// 把一个图元的坐标追加到 coords，任意画笔的路径元素类型追加到 elements（为空时不追加）
+static void appendPsbGeometry(const ItemState &st, QList<double> *coords, QByteArray *elements)
+{
+    const ItemGeometry &g = st.geometry;
+    switch (psbType(st.type)) {
+    case Psb::Line:
+        *coords << g.line.x1() << g.line.y1() << g.line.x2() << g.line.y2();
+        break;
+    case Psb::Rect:
+    case Psb::Ellipse:
+        *coords << g.rect.x() << g.rect.y() << g.rect.width() << g.rect.height();
+        break;
+    case Psb::Polygon:
+    case Psb::Curve:
+        for (const QPointF &p : g.polygon)
+            *coords << p.x() << p.y();
+        break;
+    case Psb::Path:
+        for (int i = 0; i < g.path.elementCount(); ++i) {
+            const QPainterPath::Element &e = g.path.elementAt(i);
+            *coords << e.x << e.y;
+            if (elements)
+                elements->append(char(e.type));
+        }
+        break;
+    }
+}
+
+QByteArray psbData(const QList<ItemState> &states)
+{
+    // 小端序主机上内存布局即文件布局
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) return QByteArray();
+    const PsbLayout layout = psbLayout(states);
+    const Psb::Header &header = layout.header;
+
+    QByteArray buffer(qsizetype(layout.size), '\0');
+    char *out = buffer.data();
+    std::memcpy(out, &header, sizeof(header));
+    if (!layout.styles.isEmpty())
+        std::memcpy(out + header.styleOffset, layout.styles.constData(),
+                    layout.styles.size() * sizeof(Psb::Style));
+    if (!layout.items.isEmpty())
+        std::memcpy(out + header.itemOffset, layout.items.constData(),
+                    layout.items.size() * sizeof(Psb::Item));
+
+    QList<double> coords;
+    QByteArray elements;
+    for (qsizetype i = 0; i < layout.items.size(); ++i) {
+        const Psb::Item &item = layout.items.at(i);
+        coords.clear();
+        elements.clear();
+        appendPsbGeometry(states.at(layout.sources.at(i)), &coords, &elements);
+        if (!coords.isEmpty())
+            std::memcpy(out + header.coordOffset + item.coordIndex * sizeof(double),
+                        coords.constData(), coords.size() * sizeof(double));
+        if (!elements.isEmpty())
+            std::memcpy(out + header.elementOffset + item.elementIndex, elements.constData(), elements.size());
+    }
+    return buffer;
+}
+
+// 补零到 offset 处
+static bool padTo(QIODevice *dev, quint64 offset)
+{
+    static const char zeros[8] = {};
+    const qint64 gap = qint64(offset) - dev->pos();
+    return gap >= 0 && gap <= 8 && dev->write(zeros, gap) == gap;
+}
+
+template <typename T>
+static bool writeArray(QIODevice *dev, const QList<T> &array)
+{
+    const qint64 bytes = qint64(array.size() * sizeof(T));
+    return bytes == 0 || dev->write(reinterpret_cast<const char*>(array.constData()), bytes) == bytes;
+}
+
+// 按 PsbLayout 顺序写出未压缩的 .psb，坐标和路径元素每攒够一块就写出
+static bool writePsbStream(QIODevice *dev, const QList<ItemState> &states)
+{
+    static constexpr qsizetype CHUNK_COORDS = 8192;
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) return false;
+    const PsbLayout layout = psbLayout(states);
+    const Psb::Header &header = layout.header;
+
+    bool ok = dev->write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header))
+           && padTo(dev, header.styleOffset) && writeArray(dev, layout.styles)
+           && padTo(dev, header.itemOffset) && writeArray(dev, layout.items)
+           && padTo(dev, header.coordOffset);
+
+    QList<double> coords;
+    coords.reserve(CHUNK_COORDS);
+    for (qsizetype i = 0; ok && i < layout.items.size(); ++i) {
+        appendPsbGeometry(states.at(layout.sources.at(i)), &coords, nullptr);
+        if (coords.size() >= CHUNK_COORDS) {
+            ok = writeArray(dev, coords);
+            coords.clear();
+        }
+    }
+    ok = ok && writeArray(dev, coords) && padTo(dev, header.elementOffset);
+
+    QByteArray elements;
+    for (qsizetype i = 0; ok && i < layout.items.size(); ++i) {
+        if (layout.items.at(i).type != Psb::Path) continue;
+        const QPainterPath &path = states.at(layout.sources.at(i)).geometry.path;
+        for (int e = 0; e < path.elementCount(); ++e)
+            elements.append(char(path.elementAt(e).type));
+        if (elements.size() >= CHUNK_COORDS) {
+            ok = dev->write(elements) == elements.size();
+            elements.clear();
+        }
+    }
+    ok = ok && dev->write(elements) == elements.size();
+    return ok && quint64(dev->pos()) == layout.size;
+}
+
+bool writePsb(const QString &fileName, const QList<ItemState> &states)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    bool ok = false;
+    if (isCompressedPsb(fileName)) {
+        // qCompress 需要完整的输入，压缩文档仍在内存中生成整个文件
+        const QByteArray buffer = psbData(states);
+        if (!buffer.isEmpty()) {
+            const QByteArray compressed = qCompress(buffer);
+            ok = file.write(compressed) == compressed.size();
+        }
+    } else {
+        ok = writePsbStream(&file, states);
+    }
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/* ===== 读取 ===== */
+PsbReader::~PsbReader()
+{
+    close();
+}
+
+bool PsbReader::open(const QString &fileName)
+{
+    close();
+    // 文件按小端序直接映射使用
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) return false;
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly)) return false;
+
+    qint64 size = 0;
+    if (isCompressedPsb(fileName)) {
+        // 压缩文档无法直接映射，解压到内存后按同样的方式读取
+        m_buffer = qUncompress(m_file.readAll());
+        m_file.close();
+        size = m_buffer.size();
+        m_data = reinterpret_cast<const uchar*>(m_buffer.constData());
+    } else {
+        size = m_file.size();
+        if (size >= qint64(sizeof(Psb::Header)))
+            m_data = m_file.map(0, size);
+    }
+    if (size < qint64(sizeof(Psb::Header)) || !m_data || !validate(size)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void PsbReader::close()
+{
+    if (m_data && m_buffer.isEmpty())
+        m_file.unmap(const_cast<uchar*>(m_data));
+    m_file.close();
+    m_buffer.clear();
+    m_data = nullptr;
+    m_header = nullptr;
+    m_styles = nullptr;
+    m_items = nullptr;
+    m_coords = nullptr;
+    m_elements = nullptr;
+}
+
+// 段 [offset, offset + count * elemSize) 是否落在文件内且按 8 字节对齐
+static bool sectionFits(quint64 offset, quint64 count, quint64 elemSize, quint64 size)
+{
+    if (offset % 8 != 0 || offset > size) return false;
+    return count <= (size - offset) / elemSize;
+}
+
+bool PsbReader::validate(qint64 fileSize)
+{
+    const quint64 size = quint64(fileSize);
+    const auto *h = reinterpret_cast<const Psb::Header*>(m_data);
+    if (std::memcmp(h->magic, Psb::Magic, sizeof(h->magic)) != 0) return false;
+    if (h->version != Psb::Version || h->headerSize < sizeof(Psb::Header)) return false;
+    if (!sectionFits(h->styleOffset, h->styleCount, sizeof(Psb::Style), size)
+        || !sectionFits(h->itemOffset, h->itemCount, sizeof(Psb::Item), size)
+        || !sectionFits(h->coordOffset, h->coordCount, sizeof(double), size)
+        || !sectionFits(h->elementOffset, h->elementCount, 1, size))
+        return false;
+
+    const auto *items = reinterpret_cast<const Psb::Item*>(m_data + h->itemOffset);
+    for (quint32 i = 0; i < h->itemCount; ++i) {
+        const Psb::Item &it = items[i];
+        if (it.style >= h->styleCount) return false;
+        if (it.coordIndex > h->coordCount || it.coordCount > h->coordCount - it.coordIndex) return false;
+        switch (it.type) {
+        case Psb::Rect:
+        case Psb::Ellipse:
+        case Psb::Line:
+            if (it.coordCount != 4) return false;
+            break;
+        case Psb::Polygon:
+        case Psb::Curve:
+            if (it.coordCount % 2 != 0) return false;
+            break;
+        case Psb::Path:
+            if (quint64(it.coordCount) != 2 * quint64(it.elementCount)) return false;
+            if (it.elementIndex > h->elementCount
+                || it.elementCount > h->elementCount - it.elementIndex) return false;
+            break;
+        default:
+            return false;
+        }
+    }
+
+    m_header   = h;
+    m_styles   = reinterpret_cast<const Psb::Style*>(m_data + h->styleOffset);
+    m_items    = items;
+    m_coords   = reinterpret_cast<const double*>(m_data + h->coordOffset);
+    m_elements = m_data + h->elementOffset;
+    return true;
+}
+
+ItemState PsbReader::itemState(int index) const
+{
+    ItemState st;
+    if (!m_header || index < 0 || quint32(index) >= m_header->itemCount) return st;
+
+    const Psb::Item &it = m_items[index];
+    const Psb::Style &style = m_styles[it.style];
+    st.type     = psbTypeName(it.type);
+    st.id       = it.id;
+    st.z        = it.z;
+    st.rotation = it.rotation;
+    st.pos      = QPointF(it.pos[0], it.pos[1]);
+    st.origin   = QPointF(it.origin[0], it.origin[1]);
+    st.style.penColor   = QColor::fromRgba(style.penColor);
+    st.style.brushColor = QColor::fromRgba(style.brushColor);
+    st.style.penWidth   = style.penWidth;
+    st.style.penStyle   = static_cast<Qt::PenStyle>(style.penStyle);
+
+    // 几何数据直接从映射的坐标数组构造
+    const double *c = m_coords + it.coordIndex;
+    ItemGeometry &g = st.geometry;
+    switch (it.type) {
+    case Psb::Line:
+        g.line = QLineF(c[0], c[1], c[2], c[3]);
+        break;
+    case Psb::Rect:
+    case Psb::Ellipse:
+        g.rect = QRectF(c[0], c[1], c[2], c[3]);
+        g.circle = it.flags & Psb::Circle;
+        break;
+    case Psb::Polygon:
+    case Psb::Curve:
+        g.polygon.resize(it.coordCount / 2);
+        if (it.coordCount)
+            std::memcpy(static_cast<void*>(g.polygon.data()), c, it.coordCount * sizeof(double));
+        break;
+    case Psb::Path: {
+        const quint8 *types = m_elements + it.elementIndex;
+        const quint32 n = it.elementCount;
+        g.path.reserve(int(n));
+        for (quint32 i = 0; i < n; ++i) {
+            const QPointF p(c[2 * i], c[2 * i + 1]);
+            switch (types[i]) {
+            case QPainterPath::MoveToElement: g.path.moveTo(p); break;
+            case QPainterPath::LineToElement: g.path.lineTo(p); break;
+            case QPainterPath::CurveToElement:
+                /* 与 JSON 相同：CurveTo 后紧跟两个 CurveToData */
+                if (i + 2 < n) {
+                    g.path.cubicTo(p, QPointF(c[2 * i + 2], c[2 * i + 3]),
+                                   QPointF(c[2 * i + 4], c[2 * i + 5]));
+                    i += 2;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        break;
+    }
+    }
+    return st;
+}
+
+bool readPsb(const QString &fileName, QList<ItemState> *states)
+{
+    PsbReader reader;
+    if (!reader.open(fileName)) return false;
+
+    const int n = reader.itemCount();
+    states->clear();
+    states->reserve(n);
+    for (int i = 0; i < n; ++i)
+        states->append(reader.itemState(i));
+    return true;
+}
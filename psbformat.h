@@ -0,0 +1,119 @@
+#ifndef PSBFORMAT_H
+#define PSBFORMAT_H
+
+#include <QFile>
+#include <QList>
+#include "itemstate.h"
+
+// .psb 二进制文档格式（小端序，所有段按 8 字节对齐）：
+//
+//   PsbHeader                 文件头：魔数、版本、各段偏移与长度
+//   PsbStyle[styleCount]      样式表，图元按下标引用，相同样式只存一份
+//   PsbItem[itemCount]        定长图元记录
+//   double[coordCount]        所有图元几何坐标首尾相接的一整段数组
+//   quint8[elementCount]      任意画笔的路径元素类型（QPainterPath::ElementType）
+//
+// 各类型的坐标：线段 x1 y1 x2 y2；矩形、椭圆 x y w h；多边形、贝塞尔曲线与任意画笔为顶点 / 控制点 x y 依次排列。
+// 文件整体映射进内存后直接按偏移读取记录和坐标，不需要先解析成中间结构。
+// 坐标用 double 存储，与 JSON 之间互转不损失精度。
+// .psbz 为整个 .psb 文件经 qCompress 压缩后的结果，用于自动保存。
+
+namespace Psb {
+
+constexpr char Magic[4] = {'P', 'S', 'B', '\0'};
+constexpr quint16 Version = 1;
+
+enum ItemType : quint8 {
+    Rect = 1,
+    Ellipse = 2,
+    Line = 3,
+    Polygon = 4,
+    Path = 5,
+    Curve = 6
+};
+
+enum ItemFlag : quint8 {
+    Circle = 0x01 // 椭圆为正圆
+};
+
+struct Header {
+    char magic[4];
+    quint16 version;
+    quint16 headerSize;     // sizeof(Header)，便于以后在末尾追加字段
+    quint32 styleCount;
+    quint32 itemCount;
+    quint64 styleOffset;
+    quint64 itemOffset;
+    quint64 coordOffset;
+    quint64 coordCount;
+    quint64 elementOffset;
+    quint64 elementCount;
+};
+static_assert(sizeof(Header) == 64, "Psb::Header layout");
+
+struct Style {
+    quint32 penColor;       // QRgb (ARGB)
+    quint32 brushColor;
+    qint32 penWidth;
+    qint32 penStyle;
+};
+static_assert(sizeof(Style) == 16, "Psb::Style layout");
+
+struct Item {
+    quint64 id;
+    quint8 type;            // ItemType
+    quint8 flags;           // ItemFlag
+    quint16 reserved;
+    quint32 style;          // 样式表下标
+    double z;
+    double rotation;
+    double pos[2];
+    double origin[2];
+    quint64 coordIndex;     // 在坐标数组中的起始下标（以 double 计）
+    quint32 coordCount;
+    quint32 elementCount;   // 只有任意画笔使用，等于 coordCount / 2
+    quint64 elementIndex;
+};
+static_assert(sizeof(Item) == 88, "Psb::Item layout");
+
+} // namespace Psb
+
+// 只读打开 .psb 文件。文件被整体映射进内存，open() 时校验所有偏移，
+// 之后可以按下标随机读取任意图元（可从多个线程同时读取）
+class PsbReader
+{
+public:
+    PsbReader() = default;
+    ~PsbReader();
+    PsbReader(const PsbReader &) = delete;
+    PsbReader &operator=(const PsbReader &) = delete;
+
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    int itemCount() const { return m_header ? int(m_header->itemCount) : 0; }
+    ItemState itemState(int index) const;
+
+private:
+    bool validate(qint64 size);
+
+    QFile m_file;
+    QByteArray m_buffer; // 压缩文档解压后的数据，非压缩文档为空（直接映射文件）
+    const uchar *m_data = nullptr;
+    const Psb::Header *m_header = nullptr;
+    const Psb::Style *m_styles = nullptr;
+    const Psb::Item *m_items = nullptr;
+    const double *m_coords = nullptr;
+    const quint8 *m_elements = nullptr;
+};
+
+bool readPsb(const QString &fileName, QList<ItemState> *states);
+// 未压缩的 .psb 逐个图元写出坐标，内存占用只有样式表和定长图元记录；
+// 扩展名为 .psbz 时先在内存中生成整个文件再压缩写出
+bool writePsb(const QString &fileName, const QList<ItemState> &states);
+// 在内存中生成整个 .psb 文件的内容
+QByteArray psbData(const QList<ItemState> &states);
+bool isCompressedPsb(const QString &fileName);
+
+#endif // PSBFORMAT_H
@@ -0,0 +1,162 @@
+#include "rendercache.h"
+#include "common.h"
+#include "transformablepathitem.h"
+#include "transformablepolygonitem.h"
+#include <QPixmapCache>
+#include <algorithm>
+
+// QPixmapCache 中除图元缓存外还要放背景图块等，预留一部分
+static const qint64 PIXMAP_CACHE_RESERVE = 16 * 1024 * 1024;
+
+RenderCache::RenderCache()
+    : m_budget(DEFAULT_BUDGET)
+{
+}
+
+void RenderCache::setBudget(qint64 bytes)
+{
+    m_budget = qMax<qint64>(0, bytes);
+    // 图元的设备坐标缓存也存放在 QPixmapCache 中，容量不够时会被 Qt 提前丢弃
+    const int limitKb = int(qMin<qint64>(INT_MAX, (m_budget + PIXMAP_CACHE_RESERVE) / 1024));
+    if (QPixmapCache::cacheLimit() < limitKb)
+        QPixmapCache::setCacheLimit(limitKb);
+    rebalance();
+}
+
+void RenderCache::setViewScale(qreal scale, const QSizeF &viewportSize)
+{
+    if (scale == m_scale && viewportSize == m_viewportSize) return;
+    m_scale = scale;
+    m_viewportSize = viewportSize;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        const qint64 bytes = estimateBytes(it.key());
+        if (it->cached) m_used += bytes - it->bytes;
+        it->bytes = bytes;
+    }
+    rebalance();
+}
+
+bool RenderCache::isExpensive(QGraphicsItem *item)
+{
+    ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+    if (!common) return false;
+    if (common->penStyle != Qt::SolidLine && common->penWidth >= MIN_DASHED_PEN_WIDTH)
+        return true;
+    if (auto *path = qgraphicsitem_cast<TransformablePathItem*>(item))
+        return path->path().elementCount() >= MIN_PATH_ELEMENTS;
+    if (auto *polygon = qgraphicsitem_cast<TransformablePolygonItem*>(item))
+        return polygon->polygon().size() >= MIN_POLYGON_VERTICES;
+    return false;
+}
+
+qint64 RenderCache::estimateBytes(QGraphicsItem *item) const
+{
+    // 设备坐标缓存最多只保存视口大小的区域。按场景包围盒估算，旋转后包围盒变大，
+    // CanvasScene 在旋转、变换原点等变化时都会调用 itemChanged() 重新估算
+    const QRectF r = item->sceneBoundingRect();
+    qreal w = r.width() * m_scale + 2;
+    qreal h = r.height() * m_scale + 2;
+    if (!m_viewportSize.isEmpty()) {
+        w = qMin(w, m_viewportSize.width());
+        h = qMin(h, m_viewportSize.height());
+    }
+    return qint64(w) * qint64(h) * 4;
+}
+
+void RenderCache::setCached(QGraphicsItem *item, Entry &entry, bool cached)
+{
+    if (entry.cached == cached) return;
+    entry.cached = cached;
+    m_used += cached ? entry.bytes : -entry.bytes;
+    m_cached += cached ? 1 : -1;
+    item->setCacheMode(cached ? QGraphicsItem::DeviceCoordinateCache : QGraphicsItem::NoCache);
+}
+
+void RenderCache::itemChanged(QGraphicsItem *item)
+{
+    if (!isExpensive(item)) {
+        auto it = m_entries.find(item);
+        if (it != m_entries.end()) {
+            setCached(item, *it, false);
+            m_entries.erase(it);
+        }
+        return;
+    }
+
+    auto it = m_entries.find(item);
+    if (it == m_entries.end()) {
+        it = m_entries.insert(item, Entry());
+        it->lastUsed = ++m_clock; // 新加入或刚变得值得缓存的图元视为刚用过
+    }
+    const qint64 bytes = estimateBytes(item);
+    if (it->cached) {
+        m_used += bytes - it->bytes;
+        it->bytes = bytes;
+        if (m_used > m_budget) rebalance();
+    } else {
+        it->bytes = bytes;
+        if (m_used + bytes <= m_budget) setCached(item, *it, true);
+    }
+}
+
+void RenderCache::itemRemoved(QGraphicsItem *item, bool destroyed)
+{
+    auto it = m_entries.find(item);
+    if (it == m_entries.end()) return;
+    if (destroyed) {
+        // 像素图随图元一起释放，只更新统计
+        if (it->cached) {
+            m_used -= it->bytes;
+            --m_cached;
+        }
+    } else {
+        // 离开场景（例如被删除、留在撤销栈中）时立即释放像素图
+        setCached(item, *it, false);
+    }
+    m_entries.erase(it);
+}
+
+bool RenderCache::touch(const QList<QGraphicsItem*> &items)
+{
+    if (m_entries.isEmpty()) return false;
+    ++m_clock;
+    qint64 kept = 0;     // 这次画到、已经缓存的图元，重新分配时会留下
+    qint64 smallest = -1; // 这次画到、没有缓存的图元中最小的一个
+    for (QGraphicsItem *item : items) {
+        auto it = m_entries.find(item);
+        if (it == m_entries.end() || it->lastUsed == m_clock) continue;
+        it->lastUsed = m_clock;
+        if (it->cached)
+            kept += it->bytes;
+        else if (smallest < 0 || it->bytes < smallest)
+            smallest = it->bytes;
+    }
+    // 这次画到的图元本身就超出预算时不再反复重新分配
+    return smallest >= 0 && kept + smallest <= m_budget;
+}
+
+void RenderCache::rebalance()
+{
+    // 按最近使用从新到旧在预算内依次分配，放不下的切回直接绘制
+    QList<QGraphicsItem*> order = m_entries.keys();
+    // 同一次绘制的图元已缓存的排在前面，避免预算不够时每次重新分配都换一批
+    std::sort(order.begin(), order.end(), [this](QGraphicsItem *a, QGraphicsItem *b) {
+        const Entry &ea = m_entries[a], &eb = m_entries[b];
+        if (ea.lastUsed != eb.lastUsed) return ea.lastUsed > eb.lastUsed;
+        return ea.cached && !eb.cached;
+    });
+    qint64 used = 0;
+    QList<QGraphicsItem*> wanted;
+    for (QGraphicsItem *item : std::as_const(order)) {
+        Entry &entry = m_entries[item];
+        if (used + entry.bytes <= m_budget) {
+            used += entry.bytes;
+            wanted.append(item);
+        } else {
+            setCached(item, entry, false);
+        }
+    }
+    // 先释放再启用，保证任何时刻都不超出预算
+    for (QGraphicsItem *item : std::as_const(wanted))
+        setCached(item, m_entries[item], true);
+}
@@ -0,0 +1,68 @@
+#ifndef RENDERCACHE_H
+#define RENDERCACHE_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include <QSizeF>
+
+// 图元绘制缓存管理：把绘制开销大的图元（长笔画、顶点多的多边形、宽的虚线画笔）
+// 切换为 QGraphicsItem::DeviceCoordinateCache，平移视图和重绘附近区域时直接贴图。
+// 缓存的像素图放在 QPixmapCache 中，这里按视图缩放估算每个缓存的大小，
+// 总量超出预算时按最近绘制时间淘汰最久未用的缓存（切回 NoCache）；
+// 刚绘制过却没有缓存的图元在腾得出空间时由 touch() 要求重新分配，换下最久未绘制的缓存。
+// 几何和样式变化时 Qt 会随 update() 重新生成缓存，这里只需重新评估是否值得缓存和缓存大小；
+// 平移不会让设备坐标缓存失效，旋转、缩放时由 Qt 重新生成。由 CanvasScene 持有并维护
+class RenderCache
+{
+public:
+    // 路径元素、多边形顶点达到这些数目，或者虚线画笔达到这个宽度时才缓存
+    static constexpr int MIN_PATH_ELEMENTS = 256;
+    static constexpr int MIN_POLYGON_VERTICES = 64;
+    static constexpr int MIN_DASHED_PEN_WIDTH = 3;
+
+    static constexpr qint64 DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    RenderCache();
+
+    // 缓存总大小的上限（字节），同时保证 QPixmapCache 的容量容得下
+    void setBudget(qint64 bytes);
+    qint64 budget() const { return m_budget; }
+    qint64 usedBytes() const { return m_used; }
+    int cachedCount() const { return m_cached; }
+
+    // 视图的缩放（含设备像素比）与视口大小（设备像素），决定每个缓存的大小
+    void setViewScale(qreal scale, const QSizeF &viewportSize);
+
+    // 由 CanvasScene 在图元加入场景、几何 / 样式 / 变换变化和离开场景时调用
+    void itemChanged(QGraphicsItem *item);
+    // destroyed 为 true 时图元正在析构，只清除记录
+    void itemRemoved(QGraphicsItem *item, bool destroyed = false);
+    // 视图刚重绘过的图元记为最近使用。其中有未缓存的图元、且淘汰这次没画到的缓存后放得下时
+    // 返回 true，调用方应在绘制结束后调用 rebalance()（绘制过程中不宜切换缓存模式）
+    bool touch(const QList<QGraphicsItem*> &items);
+    // 在预算内按最近使用的先后重新分配缓存
+    void rebalance();
+    bool isEmpty() const { return m_entries.isEmpty(); }
+
+    static bool isExpensive(QGraphicsItem *item);
+
+private:
+    struct Entry {
+        qint64 bytes = 0;      // 当前缩放下缓存的估算大小
+        quint64 lastUsed = 0;  // 最近一次绘制的序号
+        bool cached = false;
+    };
+
+    qint64 estimateBytes(QGraphicsItem *item) const;
+    void setCached(QGraphicsItem *item, Entry &entry, bool cached);
+
+    QHash<QGraphicsItem*, Entry> m_entries; // 开销大、值得缓存的图元
+    qint64 m_budget;
+    qint64 m_used = 0;
+    int m_cached = 0;
+    quint64 m_clock = 0;
+    qreal m_scale = 1;
+    QSizeF m_viewportSize;
+};
+
+#endif // RENDERCACHE_H
@@ -0,0 +1,420 @@
+#ifndef RTREE_H
+#define RTREE_H
+
+#include <QRectF>
+#include <QList>
+#include <QHash>
+#include <QPair>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+// 二维 R 树：以矩形为键索引值 T（T 需可作 QHash 的键，例如指针或整数）
+// 支持增量插入、删除、更新，也支持用 STR 算法一次性批量构建。
+// 矩形相交判断包含边界，所以宽或高为 0 的矩形（例如水平线段）也能被查到
+template <typename T>
+class RTree
+{
+public:
+    RTree() = default;
+    ~RTree() { clear(); }
+    RTree(const RTree &) = delete;
+    RTree &operator=(const RTree &) = delete;
+
+    void clear()
+    {
+        destroy(m_root);
+        m_root = nullptr;
+        m_leafOf.clear();
+    }
+    bool isEmpty() const { return m_leafOf.isEmpty(); }
+    qsizetype size() const { return m_leafOf.size(); }
+    bool contains(const T &value) const { return m_leafOf.contains(value); }
+    // 所有值（不排序）
+    QList<T> values() const { return m_leafOf.keys(); }
+    // 所有值的外包矩形，即根结点的矩形
+    QRectF bounds() const { return isEmpty() ? QRectF() : m_root->rect; }
+
+    void insert(const T &value, const QRectF &rect)
+    {
+        if (!m_root) m_root = new Node;
+        Node *leaf = chooseLeaf(rect);
+        leaf->rects.append(rect);
+        leaf->values.append(value);
+        m_leafOf.insert(value, leaf);
+        adjustUpwards(leaf);
+    }
+
+    bool remove(const T &value)
+    {
+        Node *leaf = m_leafOf.take(value);
+        if (!leaf) return false;
+        const qsizetype i = leaf->values.indexOf(value);
+        leaf->values.remove(i);
+        leaf->rects.remove(i);
+        condense(leaf);
+        return true;
+    }
+
+    // 值不存在时插入；新矩形仍在原叶子范围内时原地更新
+    void update(const T &value, const QRectF &rect)
+    {
+        Node *leaf = m_leafOf.value(value, nullptr);
+        if (!leaf) {
+            insert(value, rect);
+            return;
+        }
+        if (containsRect(leaf->rect, rect)) {
+            leaf->rects[leaf->values.indexOf(value)] = rect;
+            return;
+        }
+        remove(value);
+        insert(value, rect);
+    }
+
+    // 清空后按 Sort-Tile-Recursive 算法整体构建，比逐个插入快且结点更紧凑
+    void bulkLoad(QList<QPair<T, QRectF>> entries)
+    {
+        clear();
+        if (entries.isEmpty()) return;
+
+        strOrder(entries, [](const QPair<T, QRectF> &e) { return e.second; });
+        QList<Node*> level;
+        for (qsizetype i = 0; i < entries.size(); i += MaxEntries) {
+            Node *leaf = new Node;
+            const qsizetype end = qMin(i + MaxEntries, entries.size());
+            for (qsizetype j = i; j < end; ++j) {
+                leaf->values.append(entries[j].first);
+                leaf->rects.append(entries[j].second);
+                m_leafOf.insert(entries[j].first, leaf);
+            }
+            leaf->rect = unionOf(leaf->rects);
+            level.append(leaf);
+        }
+
+        while (level.size() > 1) {
+            strOrder(level, [](Node *n) { return n->rect; });
+            QList<Node*> upper;
+            for (qsizetype i = 0; i < level.size(); i += MaxEntries) {
+                Node *node = new Node;
+                node->leaf = false;
+                const qsizetype end = qMin(i + MaxEntries, level.size());
+                for (qsizetype j = i; j < end; ++j)
+                    addChild(node, level[j]);
+                node->rect = unionOf(node->rects);
+                upper.append(node);
+            }
+            level = upper;
+        }
+        m_root = level.first();
+    }
+
+    // 遍历与 rect 相交的所有值，f(value, rect) 返回 false 时提前结束
+    template <typename F>
+    void visit(const QRectF &rect, F &&f) const
+    {
+        if (!m_root) return;
+        std::vector<const Node*> stack{m_root};
+        while (!stack.empty()) {
+            const Node *node = stack.back();
+            stack.pop_back();
+            for (qsizetype i = 0; i < node->rects.size(); ++i) {
+                if (!overlaps(node->rects[i], rect)) continue;
+                if (node->leaf) {
+                    if (!f(node->values[i], node->rects[i])) return;
+                } else {
+                    stack.push_back(node->children[i]);
+                }
+            }
+        }
+    }
+
+    QList<T> intersecting(const QRectF &rect) const
+    {
+        QList<T> result;
+        visit(rect, [&result](const T &value, const QRectF &) { result.append(value); return true; });
+        return result;
+    }
+
+    QList<T> containing(const QPointF &point) const
+    {
+        return intersecting(QRectF(point, point));
+    }
+
+    // 按矩形到 point 的距离由近到远返回至多 k 个值，超过 maxDistance 的不返回
+    QList<T> nearest(const QPointF &point, int k = 1,
+                     qreal maxDistance = std::numeric_limits<qreal>::infinity()) const
+    {
+        QList<T> result;
+        if (!m_root || k <= 0) return result;
+
+        struct Candidate {
+            qreal dist2;
+            const Node *node;
+            qsizetype index; // >= 0 表示 node 叶子中的第 index 个值
+            bool operator>(const Candidate &o) const { return dist2 > o.dist2; }
+        };
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+        const qreal max2 = maxDistance * maxDistance;
+        queue.push({distance2(m_root->rect, point), m_root, -1});
+        while (!queue.empty()) {
+            const Candidate c = queue.top();
+            queue.pop();
+            if (c.dist2 > max2) break;
+            if (c.index >= 0) {
+                result.append(c.node->values[c.index]);
+                if (result.size() >= k) break;
+                continue;
+            }
+            for (qsizetype i = 0; i < c.node->rects.size(); ++i) {
+                const qreal d = distance2(c.node->rects[i], point);
+                if (c.node->leaf) queue.push({d, c.node, i});
+                else              queue.push({d, c.node->children[i], -1});
+            }
+        }
+        return result;
+    }
+
+private:
+    static constexpr int MaxEntries = 16;
+    static constexpr int MinEntries = 6;
+
+    struct Node {
+        bool leaf = true;
+        Node *parent = nullptr;
+        QRectF rect;
+        QList<QRectF> rects;    // 每个子结点或值的矩形
+        QList<Node*> children;  // 内部结点使用
+        QList<T> values;        // 叶子结点使用
+    };
+
+    static bool overlaps(const QRectF &a, const QRectF &b)
+    {
+        return a.left() <= b.right() && b.left() <= a.right()
+            && a.top() <= b.bottom() && b.top() <= a.bottom();
+    }
+    static bool containsRect(const QRectF &outer, const QRectF &inner)
+    {
+        return outer.left() <= inner.left() && inner.right() <= outer.right()
+            && outer.top() <= inner.top() && inner.bottom() <= outer.bottom();
+    }
+    static QRectF united(const QRectF &a, const QRectF &b)
+    {
+        const qreal l = qMin(a.left(), b.left()), t = qMin(a.top(), b.top());
+        const qreal r = qMax(a.right(), b.right()), btm = qMax(a.bottom(), b.bottom());
+        return QRectF(QPointF(l, t), QPointF(r, btm));
+    }
+    static QRectF unionOf(const QList<QRectF> &rects)
+    {
+        if (rects.isEmpty()) return QRectF();
+        QRectF r = rects.first();
+        for (qsizetype i = 1; i < rects.size(); ++i)
+            r = united(r, rects[i]);
+        return r;
+    }
+    static qreal area(const QRectF &r) { return r.width() * r.height(); }
+    static qreal distance2(const QRectF &r, const QPointF &p)
+    {
+        const qreal dx = qMax<qreal>(0, qMax(r.left() - p.x(), p.x() - r.right()));
+        const qreal dy = qMax<qreal>(0, qMax(r.top() - p.y(), p.y() - r.bottom()));
+        return dx * dx + dy * dy;
+    }
+    static qsizetype entryCount(const Node *n) { return n->rects.size(); }
+
+    static void addChild(Node *parent, Node *child)
+    {
+        parent->children.append(child);
+        parent->rects.append(child->rect);
+        child->parent = parent;
+    }
+
+    static void destroy(Node *node)
+    {
+        if (!node) return;
+        for (Node *child : std::as_const(node->children))
+            destroy(child);
+        delete node;
+    }
+
+    // STR 排序：先按中心 x 切成若干竖条，每条内再按中心 y 排序，
+    // 之后按顺序每 MaxEntries 个打包成一个结点
+    template <typename E, typename RectOf>
+    static void strOrder(QList<E> &items, RectOf rectOf)
+    {
+        const qsizetype n = items.size();
+        const qsizetype leafCount = (n + MaxEntries - 1) / MaxEntries;
+        const qsizetype slices = qMax<qsizetype>(1, qsizetype(std::ceil(std::sqrt(double(leafCount)))));
+        const qsizetype sliceSize = slices * MaxEntries;
+        std::sort(items.begin(), items.end(), [&](const E &a, const E &b) {
+            return rectOf(a).center().x() < rectOf(b).center().x();
+        });
+        for (qsizetype i = 0; i < n; i += sliceSize) {
+            auto first = items.begin() + i;
+            auto last = items.begin() + qMin(i + sliceSize, n);
+            std::sort(first, last, [&](const E &a, const E &b) {
+                return rectOf(a).center().y() < rectOf(b).center().y();
+            });
+        }
+    }
+
+    // 选择扩大面积最小的子结点，直到叶子
+    Node *chooseLeaf(const QRectF &rect) const
+    {
+        Node *node = m_root;
+        while (!node->leaf) {
+            qsizetype best = 0;
+            qreal bestGrowth = std::numeric_limits<qreal>::max();
+            qreal bestArea = std::numeric_limits<qreal>::max();
+            for (qsizetype i = 0; i < node->rects.size(); ++i) {
+                const qreal a = area(node->rects[i]);
+                const qreal growth = area(united(node->rects[i], rect)) - a;
+                if (growth < bestGrowth || (growth == bestGrowth && a < bestArea)) {
+                    best = i;
+                    bestGrowth = growth;
+                    bestArea = a;
+                }
+            }
+            node = node->children[best];
+        }
+        return node;
+    }
+
+    // 超出容量的结点沿中心分布较广的轴排序后对半拆分，返回新的兄弟结点
+    Node *split(Node *node)
+    {
+        const qsizetype n = entryCount(node);
+        QList<qsizetype> order(n);
+        for (qsizetype i = 0; i < n; ++i) order[i] = i;
+
+        qreal minX = std::numeric_limits<qreal>::max(), maxX = -minX;
+        qreal minY = minX, maxY = -minX;
+        for (const QRectF &r : std::as_const(node->rects)) {
+            const QPointF c = r.center();
+            minX = qMin(minX, c.x()); maxX = qMax(maxX, c.x());
+            minY = qMin(minY, c.y()); maxY = qMax(maxY, c.y());
+        }
+        const bool byX = (maxX - minX) >= (maxY - minY);
+        std::sort(order.begin(), order.end(), [&](qsizetype a, qsizetype b) {
+            const QPointF ca = node->rects[a].center(), cb = node->rects[b].center();
+            return byX ? ca.x() < cb.x() : ca.y() < cb.y();
+        });
+
+        Node *sibling = new Node;
+        sibling->leaf = node->leaf;
+        QList<QRectF> keptRects;
+        QList<Node*> keptChildren;
+        QList<T> keptValues;
+        for (qsizetype k = 0; k < n; ++k) {
+            const qsizetype i = order[k];
+            const bool keep = k < n / 2;
+            if (node->leaf) {
+                if (keep) {
+                    keptRects.append(node->rects[i]);
+                    keptValues.append(node->values[i]);
+                } else {
+                    sibling->rects.append(node->rects[i]);
+                    sibling->values.append(node->values[i]);
+                    m_leafOf.insert(node->values[i], sibling);
+                }
+            } else {
+                if (keep) {
+                    keptRects.append(node->rects[i]);
+                    keptChildren.append(node->children[i]);
+                } else {
+                    addChild(sibling, node->children[i]);
+                }
+            }
+        }
+        node->rects = keptRects;
+        node->children = keptChildren;
+        node->values = keptValues;
+        sibling->rect = unionOf(sibling->rects);
+        return sibling;
+    }
+
+    static qsizetype indexInParent(const Node *node)
+    {
+        return node->parent->children.indexOf(const_cast<Node*>(node));
+    }
+
+    // 插入后自下而上更新包围矩形，必要时拆分结点
+    void adjustUpwards(Node *node)
+    {
+        while (node) {
+            Node *sibling = entryCount(node) > MaxEntries ? split(node) : nullptr;
+            node->rect = unionOf(node->rects);
+            Node *parent = node->parent;
+            if (!parent) {
+                if (sibling) {
+                    Node *root = new Node;
+                    root->leaf = false;
+                    addChild(root, node);
+                    addChild(root, sibling);
+                    root->rect = unionOf(root->rects);
+                    m_root = root;
+                }
+                return;
+            }
+            parent->rects[indexInParent(node)] = node->rect;
+            if (sibling) addChild(parent, sibling);
+            node = parent;
+        }
+    }
+
+    static void collectEntries(Node *node, QList<QPair<T, QRectF>> &out)
+    {
+        if (node->leaf) {
+            for (qsizetype i = 0; i < node->values.size(); ++i)
+                out.append({node->values[i], node->rects[i]});
+        } else {
+            for (Node *child : std::as_const(node->children))
+                collectEntries(child, out);
+        }
+    }
+
+    // 删除后自下而上收缩，条目过少的结点拆掉并把其中的值重新插入
+    void condense(Node *node)
+    {
+        QList<Node*> orphans;
+        while (node != m_root) {
+            Node *parent = node->parent;
+            const qsizetype i = indexInParent(node);
+            if (entryCount(node) < MinEntries) {
+                parent->children.remove(i);
+                parent->rects.remove(i);
+                orphans.append(node);
+            } else {
+                node->rect = unionOf(node->rects);
+                parent->rects[i] = node->rect;
+            }
+            node = parent;
+        }
+        m_root->rect = unionOf(m_root->rects);
+
+        if (!m_root->leaf && m_root->children.isEmpty()) {
+            delete m_root;
+            m_root = new Node;
+        }
+        while (!m_root->leaf && m_root->children.size() == 1) {
+            Node *child = m_root->children.first();
+            child->parent = nullptr;
+            delete m_root;
+            m_root = child;
+        }
+
+        QList<QPair<T, QRectF>> entries;
+        for (Node *orphan : std::as_const(orphans)) {
+            collectEntries(orphan, entries);
+            destroy(orphan);
+        }
+        for (const auto &e : std::as_const(entries))
+            insert(e.first, e.second);
+    }
+
+    Node *m_root = nullptr;
+    QHash<T, Node*> m_leafOf; // 每个值所在的叶子，用于 O(1) 定位删除
+};
+
+#endif // RTREE_H
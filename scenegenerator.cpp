@@ -0,0 +1,167 @@
+#include "scenegenerator.h"
+#include "strokefitting.h"
+#include <QRandomGenerator>
+#include <QtMath>
+#include <algorithm>
+
+void SceneGeneratorOptions::setUniformMix(int count)
+{
+    rectCount    = count / 5 + (count % 5 > 0);
+    ellipseCount = count / 5 + (count % 5 > 1);
+    lineCount    = count / 5 + (count % 5 > 2);
+    polygonCount = count / 5 + (count % 5 > 3);
+    pathCount    = count / 5;
+}
+
+namespace {
+
+class Generator
+{
+public:
+    explicit Generator(const SceneGeneratorOptions &o) : m_opt(o), m_rng(o.seed) {}
+
+    QList<ItemState> run();
+
+private:
+    qreal uniform(qreal lo, qreal hi) { return lo + m_rng.bounded(1.0) * (hi - lo); }
+    int uniformInt(int lo, int hi) { return hi <= lo ? lo : lo + int(m_rng.bounded(hi - lo + 1)); }
+    // 三个均匀分布之和，近似正态，范围 [-1, 1]
+    qreal bell() { return (m_rng.bounded(2.0) + m_rng.bounded(2.0) + m_rng.bounded(2.0)) / 3 - 1; }
+
+    void makeStyles();
+    QPointF position();
+    ItemGeometry geometry(const QString &type, qreal w, qreal h);
+
+    const SceneGeneratorOptions &m_opt;
+    QRandomGenerator m_rng;
+    qreal m_extent = 0;
+    QList<ItemStyle> m_styles;
+    QList<QPointF> m_clusters;
+};
+
+QList<ItemState> Generator::run()
+{
+    const int total = m_opt.totalCount();
+    m_extent = m_opt.extent > 0 ? m_opt.extent : 100 * qSqrt(qreal(qMax(total, 1)));
+    makeStyles();
+    for (int i = 0; i < qMax(m_opt.clusterCount, 1); ++i)
+        m_clusters << QPointF(uniform(0, m_extent), uniform(0, m_extent));
+
+    QList<QString> types;
+    types.reserve(total);
+    types.insert(types.size(), m_opt.rectCount, "TransformableRectItem");
+    types.insert(types.size(), m_opt.ellipseCount, "TransformableEllipseItem");
+    types.insert(types.size(), m_opt.lineCount, "TransformableLineItem");
+    types.insert(types.size(), m_opt.polygonCount, "TransformablePolygonItem");
+    types.insert(types.size(), m_opt.pathCount, "TransformablePathItem");
+    // Fisher–Yates，用自己的随机数保证可复现
+    for (qsizetype i = types.size() - 1; i > 0; --i)
+        std::swap(types[i], types[qsizetype(m_rng.bounded(quint64(i + 1)))]);
+
+    QList<ItemState> states;
+    states.reserve(total);
+    for (int i = 0; i < total; ++i) {
+        ItemState st;
+        st.type = types[i];
+        st.id = quint64(i) + 1;
+        st.z = i;
+        st.pos = position();
+        const qreal w = uniform(m_opt.sizeMin, m_opt.sizeMax);
+        const qreal h = uniform(m_opt.sizeMin, m_opt.sizeMax);
+        st.geometry = geometry(st.type, w, h);
+        st.origin = QPointF(w / 2, h / 2);
+        if (m_opt.maxRotation > 0)
+            st.rotation = uniform(-m_opt.maxRotation, m_opt.maxRotation);
+        st.style = m_styles[m_rng.bounded(int(m_styles.size()))];
+        states.append(st);
+    }
+    return states;
+}
+
+void Generator::makeStyles()
+{
+    static const Qt::PenStyle penStyles[] = {Qt::SolidLine, Qt::DashLine, Qt::DotLine, Qt::DashDotLine};
+    const int n = qMax(m_opt.styleVariety, 1);
+    for (int i = 0; i < n; ++i) {
+        ItemStyle s;
+        if (n > 1) {
+            s.penColor = QColor::fromRgb(m_rng.generate() | 0xff000000);
+            s.brushColor = QColor::fromRgba(m_rng.generate());
+            s.penWidth = uniformInt(1, 8);
+            s.penStyle = penStyles[m_rng.bounded(4)];
+        }
+        m_styles << s;
+    }
+}
+
+QPointF Generator::position()
+{
+    switch (m_opt.distribution) {
+    case SceneGeneratorOptions::Clustered: {
+        const QPointF c = m_clusters[m_rng.bounded(int(m_clusters.size()))];
+        return c + QPointF(bell(), bell()) * m_opt.clusterSpread;
+    }
+    case SceneGeneratorOptions::Overlapping: {
+        const qreal half = m_opt.sizeMax;
+        const QPointF c(m_extent / 2, m_extent / 2);
+        return c + QPointF(uniform(-half, half), uniform(-half, half));
+    }
+    case SceneGeneratorOptions::Uniform:
+    default:
+        return QPointF(uniform(0, m_extent), uniform(0, m_extent));
+    }
+}
+
+ItemGeometry Generator::geometry(const QString &type, qreal w, qreal h)
+{
+    ItemGeometry g;
+    if (type == "TransformableLineItem") {
+        g.line = QLineF(0, uniform(0, h), w, uniform(0, h));
+    } else if (type == "TransformableEllipseItem") {
+        // 四分之一是正圆
+        g.circle = m_rng.bounded(4) == 0;
+        g.rect = QRectF(0, 0, w, g.circle ? w : h);
+    } else if (type == "TransformablePolygonItem") {
+        // 按角度排序的星形多边形，保证不自交
+        const int n = uniformInt(m_opt.polygonVerticesMin, m_opt.polygonVerticesMax);
+        QList<qreal> angles;
+        for (int k = 0; k < n; ++k)
+            angles << uniform(0, 2 * M_PI);
+        std::sort(angles.begin(), angles.end());
+        g.polygon.reserve(n);
+        for (qreal a : angles) {
+            const qreal r = uniform(0.3, 1.0);
+            g.polygon << QPointF(w / 2 * (1 + r * qCos(a)), h / 2 * (1 + r * qSin(a)));
+        }
+    } else if (type == "TransformablePathItem") {
+        // 随机游走模拟手绘笔画，总体从左向右
+        const int n = qMax(2, uniformInt(m_opt.strokePointsMin, m_opt.strokePointsMax));
+        QPolygonF pts;
+        pts.reserve(n);
+        qreal y = uniform(0, h);
+        for (int k = 0; k < n; ++k) {
+            y = qBound<qreal>(0, y + uniform(-h, h) / 8, h);
+            pts << QPointF(w * k / (n - 1), y);
+        }
+        if (m_opt.fitStrokes) {
+            g.path = smoothStroke(pts, 1.0);
+        } else {
+            g.path.moveTo(pts.first());
+            for (int k = 1; k < n; ++k)
+                g.path.lineTo(pts[k]);
+        }
+    } else {
+        g.rect = QRectF(0, 0, w, h);
+    }
+    return g;
+}
+
+} // namespace
+
+QList<ItemState> generateScene(const SceneGeneratorOptions &options)
+{
+    QList<ItemState> states = Generator(options).run();
+    if (!states.isEmpty())
+        ItemCommon::reserveItemId(states.last().id);
+    return states;
+}
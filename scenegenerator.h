@@ -0,0 +1,55 @@
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <QList>
+#include "itemstate.h"
+
+// 合成测试文档的生成器：相同的参数与种子总是得到相同的图元序列，
+// 用于复现大文档下的性能问题以及压力测试、基准测试
+
+struct SceneGeneratorOptions {
+    enum Distribution {
+        Uniform,     // 在整个画布内均匀分布
+        Clustered,   // 聚集在若干个簇中心附近
+        Overlapping  // 全部堆叠在画布中央的一小块区域
+    };
+
+    quint32 seed = 1;
+
+    // 各类型图元数量，生成后按种子打乱堆叠顺序
+    int rectCount = 0;
+    int ellipseCount = 0;
+    int lineCount = 0;
+    int polygonCount = 0;
+    int pathCount = 0;
+
+    // 多边形顶点数、任意画笔采样点数的范围（含两端）
+    int polygonVerticesMin = 3;
+    int polygonVerticesMax = 8;
+    int strokePointsMin = 16;
+    int strokePointsMax = 64;
+    bool fitStrokes = false; // 按画笔工具松开鼠标后的方式拟合成曲线
+
+    // 图元尺寸范围（场景单位）
+    qreal sizeMin = 10;
+    qreal sizeMax = 100;
+
+    // 样式种类数：从这么多套随机样式（颜色、线宽、线型）中取用，1 表示全部相同
+    int styleVariety = 16;
+    // 旋转角在 [-maxRotation, maxRotation] 内均匀取值（度）
+    qreal maxRotation = 0;
+
+    Distribution distribution = Uniform;
+    // 画布边长，<= 0 时按图元总数自动取值，使平均密度大致不变
+    qreal extent = 0;
+    int clusterCount = 8;
+    qreal clusterSpread = 200; // 簇内偏离中心的大致距离
+
+    int totalCount() const { return rectCount + ellipseCount + lineCount + polygonCount + pathCount; }
+    // 把 count 平均分给五种图元
+    void setUniformMix(int count);
+};
+
+QList<ItemState> generateScene(const SceneGeneratorOptions &options);
+
+#endif // SCENEGENERATOR_H
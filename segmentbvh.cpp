@@ -0,0 +1,153 @@
+#include "segmentbvh.h"
+#include <QVarLengthArray>
+#include <QtMath>
+
+static QRectF segmentRect(const QLineF &l)
+{
+    return QRectF(QPointF(qMin(l.x1(), l.x2()), qMin(l.y1(), l.y2())),
+                  QPointF(qMax(l.x1(), l.x2()), qMax(l.y1(), l.y2())));
+}
+
+// 与 QRectF::united 不同，宽或高为 0 的矩形（水平、竖直线段）也参与合并
+static QRectF unite(const QRectF &a, const QRectF &b)
+{
+    return QRectF(QPointF(qMin(a.left(), b.left()), qMin(a.top(), b.top())),
+                  QPointF(qMax(a.right(), b.right()), qMax(a.bottom(), b.bottom())));
+}
+
+// 矩形相交判断包含边界
+static bool touches(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right()
+        && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+qreal pointSegmentDistance(const QPointF &p, const QLineF &segment)
+{
+    const QPointF d = segment.p2() - segment.p1();
+    const qreal len2 = QPointF::dotProduct(d, d);
+    qreal t = 0;
+    if (len2 > 0)
+        t = qBound<qreal>(0, QPointF::dotProduct(p - segment.p1(), d) / len2, 1);
+    const QPointF diff = p - (segment.p1() + t * d);
+    return qSqrt(QPointF::dotProduct(diff, diff));
+}
+
+qreal segmentDistance(const QLineF &a, const QLineF &b)
+{
+    if (a.intersects(b, nullptr) == QLineF::BoundedIntersection)
+        return 0;
+    return qMin(qMin(pointSegmentDistance(a.p1(), b), pointSegmentDistance(a.p2(), b)),
+                qMin(pointSegmentDistance(b.p1(), a), pointSegmentDistance(b.p2(), a)));
+}
+
+bool segmentNearPolygon(const QLineF &segment, const QPolygonF &area, qreal radius)
+{
+    if (area.isEmpty()) return false;
+    if (area.containsPoint(segment.p1(), Qt::OddEvenFill))
+        return true;
+    for (int i = 0; i < area.size(); ++i) {
+        const QLineF edge(area.at(i), area.at((i + 1) % area.size()));
+        if (segmentDistance(segment, edge) <= radius)
+            return true;
+    }
+    return false;
+}
+
+void SegmentBvh::build(const QList<QPolygonF> &polylines, bool closed)
+{
+    m_segments.clear();
+    m_nodes.clear();
+    for (const QPolygonF &poly : polylines) {
+        for (int i = 1; i < poly.size(); ++i)
+            m_segments.append(QLineF(poly.at(i - 1), poly.at(i)));
+        if (closed && poly.size() > 2 && poly.first() != poly.last())
+            m_segments.append(QLineF(poly.last(), poly.first()));
+    }
+    if (m_segments.isEmpty()) return;
+
+    // 叶结点
+    for (int i = 0; i < m_segments.size(); i += FANOUT) {
+        Node leaf;
+        leaf.first = i;
+        leaf.count = qMin(FANOUT, int(m_segments.size()) - i);
+        leaf.rect = segmentRect(m_segments.at(i));
+        for (int j = i + 1; j < i + leaf.count; ++j)
+            leaf.rect = unite(leaf.rect, segmentRect(m_segments.at(j)));
+        m_nodes.append(leaf);
+    }
+    // 逐层向上合并，直到只剩根结点
+    int levelBegin = 0;
+    int levelEnd = int(m_nodes.size());
+    while (levelEnd - levelBegin > 1) {
+        for (int i = levelBegin; i < levelEnd; i += FANOUT) {
+            Node node;
+            node.leaf = false;
+            node.first = i;
+            node.count = qMin(FANOUT, levelEnd - i);
+            node.rect = m_nodes.at(i).rect;
+            for (int j = i + 1; j < i + node.count; ++j)
+                node.rect = unite(node.rect, m_nodes.at(j).rect);
+            m_nodes.append(node);
+        }
+        levelBegin = levelEnd;
+        levelEnd = int(m_nodes.size());
+    }
+}
+
+template <typename Hits, typename F>
+bool SegmentBvh::visit(Hits &&hits, F &&f) const
+{
+    if (m_nodes.isEmpty()) return false;
+    QVarLengthArray<int, 64> stack;
+    stack.append(int(m_nodes.size()) - 1);
+    while (!stack.isEmpty()) {
+        const Node &node = m_nodes.at(stack.last());
+        stack.removeLast();
+        if (!hits(node.rect)) continue;
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            if (!node.leaf)
+                stack.append(i);
+            else if (f(m_segments.at(i)))
+                return true;
+        }
+    }
+    return false;
+}
+
+bool SegmentBvh::nearPoint(const QPointF &pos, qreal radius) const
+{
+    const QRectF query(pos.x() - radius, pos.y() - radius, 2 * radius, 2 * radius);
+    return visit([&](const QRectF &r) { return touches(r, query); },
+                 [&](const QLineF &l) { return pointSegmentDistance(pos, l) <= radius; });
+}
+
+bool SegmentBvh::nearPolygon(const QPolygonF &area, qreal radius) const
+{
+    if (area.isEmpty()) return false;
+    const QRectF query = area.boundingRect().adjusted(-radius, -radius, radius, radius);
+    return visit([&](const QRectF &r) { return touches(r, query); },
+                 [&](const QLineF &l) { return segmentNearPolygon(l, area, radius); });
+}
+
+bool SegmentBvh::containsPoint(const QPointF &pos, Qt::FillRule rule) const
+{
+    // 从 pos 向 +x 方向发出射线，只访问与射线所在水平线相交、且在 pos 右侧有范围的结点
+    int winding = 0;
+    int crossings = 0;
+    visit([&](const QRectF &r) {
+              return r.top() <= pos.y() && pos.y() <= r.bottom() && r.right() >= pos.x();
+          },
+          [&](const QLineF &l) {
+              const bool up = l.y1() <= pos.y() && l.y2() > pos.y();
+              const bool down = l.y2() <= pos.y() && l.y1() > pos.y();
+              if (!up && !down) return false;
+              const qreal t = (pos.y() - l.y1()) / (l.y2() - l.y1());
+              if (l.x1() + t * (l.x2() - l.x1()) > pos.x()) {
+                  ++crossings;
+                  winding += up ? 1 : -1;
+              }
+              return false;
+          });
+    return rule == Qt::OddEvenFill ? (crossings & 1) : winding != 0;
+}
@@ -0,0 +1,50 @@
+#ifndef SEGMENTBVH_H
+#define SEGMENTBVH_H
+
+#include <QPolygonF>
+#include <QLineF>
+#include <QList>
+
+// 线段层次包围盒（图元坐标），用于长笔画、多边形的精确命中测试。
+// 笔画和多边形相邻的线段在空间上也相邻，所以直接按顺序每 FANOUT 条线段 / 结点合成一个上层结点，
+// 建树是线性的，点查询和小范围查询只访问 O(log n) 个结点
+class SegmentBvh
+{
+public:
+    static constexpr int FANOUT = 8;
+
+    // polylines 中每条折线的相邻顶点构成线段，closed 为 true 时再连接首尾
+    void build(const QList<QPolygonF> &polylines, bool closed);
+    bool isEmpty() const { return m_segments.isEmpty(); }
+
+    // 是否有线段与 pos 的距离不超过 radius
+    bool nearPoint(const QPointF &pos, qreal radius) const;
+    // 是否有线段与闭合多边形 area 相交或距离不超过 radius（线段完全在 area 内也算）
+    bool nearPolygon(const QPolygonF &area, qreal radius) const;
+    // 把所有线段看作闭合轮廓时 pos 是否在内部
+    bool containsPoint(const QPointF &pos, Qt::FillRule rule) const;
+
+private:
+    struct Node {
+        QRectF rect;
+        int first = 0;   // 叶结点为第一条线段的下标，内部结点为第一个子结点的下标
+        int count = 0;
+        bool leaf = true;
+    };
+
+    // 对包围盒满足 hits(rect) 的结点中的每条线段调用 f(line)，f 返回 true 时提前结束并返回 true
+    template <typename Hits, typename F>
+    bool visit(Hits &&hits, F &&f) const;
+
+    QList<QLineF> m_segments;
+    QList<Node> m_nodes; // 自下而上逐层存放，最后一个是根结点
+};
+
+// 点到线段的距离
+qreal pointSegmentDistance(const QPointF &p, const QLineF &segment);
+// 两条线段之间的最短距离（相交时为 0）
+qreal segmentDistance(const QLineF &a, const QLineF &b);
+// 线段与闭合多边形 area 相交或距离不超过 radius
+bool segmentNearPolygon(const QLineF &segment, const QPolygonF &area, qreal radius);
+
+#endif // SEGMENTBVH_H
@@ -0,0 +1,181 @@
+#include "selectionoverlay.h"
+#include "canvasscene.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QGraphicsSceneMouseEvent>
+#include <limits>
+
+// 选中图元不多时直接遍历，多时借助画布的空间索引
+static const int DIRECT_SCAN_LIMIT = 256;
+
+SelectionOverlay::SelectionOverlay()
+{
+    setZValue(std::numeric_limits<qreal>::max());
+    setAcceptedMouseButtons(Qt::LeftButton);
+    setFlag(ItemUsesExtendedStyleOption); // paint() 中用 exposedRect 裁剪
+}
+
+QRectF SelectionOverlay::handlesSceneRect(QGraphicsItem *item, ItemCommon *common) const
+{
+    return item->sceneTransform().mapRect(common->handlesBoundingRect());
+}
+
+QRectF SelectionOverlay::boundingRect() const
+{
+    if (m_boundsDirty) {
+        m_bounds = QRectF();
+        for (auto it = m_items.cbegin(); it != m_items.cend(); ++it)
+            m_bounds |= handlesSceneRect(it.key(), it.value());
+        m_boundsDirty = false;
+    }
+    return m_bounds;
+}
+
+void SelectionOverlay::invalidate()
+{
+    // 同一帧内多次变化只通知一次，包围盒在下次用到时再重新计算
+    if (m_boundsDirty) return;
+    prepareGeometryChange();
+    m_boundsDirty = true;
+}
+
+void SelectionOverlay::itemSelectionChanged(QGraphicsItem *item)
+{
+    ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+    if (!common) return;
+    if (item->isSelected() && item->scene() == scene()) {
+        // 未选中时缩放过视图的话控制点还是旧的大小
+        common->updateHandleGeometry();
+        m_items.insert(item, common);
+    } else if (!m_items.remove(item))
+        return;
+    invalidate();
+}
+
+void SelectionOverlay::itemRemoved(QGraphicsItem *item)
+{
+    if (item == m_dragItem) m_dragItem = nullptr;
+    if (m_items.remove(item))
+        invalidate();
+}
+
+void SelectionOverlay::itemGeometryChanged(QGraphicsItem *item)
+{
+    if (m_items.contains(item))
+        invalidate();
+}
+
+void SelectionOverlay::itemRegionChanged(QGraphicsItem *item, const QRectF &localRect)
+{
+    if (m_boundsDirty || !m_items.contains(item)) return;
+    const qreal half = ItemCommon::handleSize() / 2;
+    update(item->sceneTransform().mapRect(localRect.adjusted(-half, -half, half, half)));
+}
+
+void SelectionOverlay::handleScaleChanged()
+{
+    if (m_items.isEmpty()) return;
+    for (auto it = m_items.cbegin(); it != m_items.cend(); ++it)
+        it.value()->updateHandleGeometry();
+    invalidate();
+    update();
+}
+
+QList<QGraphicsItem*> SelectionOverlay::itemsNear(const QRectF &sceneRect) const
+{
+    QList<QGraphicsItem*> result;
+    if (m_items.size() <= DIRECT_SCAN_LIMIT) {
+        for (auto it = m_items.cbegin(); it != m_items.cend(); ++it)
+            if (handlesSceneRect(it.key(), it.value()).intersects(sceneRect))
+                result.append(it.key());
+        return result;
+    }
+
+    auto *cs = qobject_cast<CanvasScene*>(scene());
+    if (!cs) return result;
+    // 索引中是紧凑包围盒，旋转后的控制点区域最多再向外伸出 extra * sqrt(2)
+    const qreal margin = 1.5 * (ItemCommon::handleSize() + ItemCommon::rotateHandleOffset());
+    const QRectF query = sceneRect.adjusted(-margin, -margin, margin, margin);
+    for (QGraphicsItem *item : cs->indexedItems(query, Qt::IntersectsItemBoundingRect)) {
+        ItemCommon *common = m_items.value(item);
+        if (common && handlesSceneRect(item, common).intersects(sceneRect))
+            result.append(item);
+    }
+    return result;
+}
+
+QGraphicsItem *SelectionOverlay::handleItemAt(const QPointF &scenePos, int *handle) const
+{
+    QGraphicsItem *best = nullptr;
+    int bestHandle = 0;
+    for (QGraphicsItem *item : itemsNear(QRectF(scenePos, QSizeF(1e-6, 1e-6)))) {
+        ItemCommon *common = m_items.value(item);
+        const int h = common->handleAt(item->mapFromScene(scenePos));
+        if (!h) continue;
+        // 重叠时取堆叠在最上面的，与 Qt 点选图元的顺序一致
+        if (best && !CanvasScene::stackedAbove(item, best)) continue;
+        best = item;
+        bestHandle = h;
+    }
+    if (handle) *handle = bestHandle;
+    return best;
+}
+
+bool SelectionOverlay::contains(const QPointF &point) const
+{
+    // 只有控制点本身可以点中，其余区域的事件交给下面的图元
+    return handleItemAt(point) != nullptr;
+}
+
+void SelectionOverlay::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget)
+    painter->setRenderHint(QPainter::Antialiasing);
+    // 裁剪到重绘区域，控制点很多的图元据此只画区域内的控制点
+    painter->setClipRect(option->exposedRect, Qt::IntersectClip);
+    for (QGraphicsItem *item : itemsNear(option->exposedRect)) {
+        painter->save();
+        painter->setTransform(item->sceneTransform(), true);
+        m_items.value(item)->paintHandles(painter);
+        painter->restore();
+    }
+}
+
+Qt::CursorShape SelectionOverlay::cursorAt(const QPointF &scenePos) const
+{
+    if (m_items.isEmpty()) return Qt::ArrowCursor;
+    int handle = 0;
+    QGraphicsItem *item = handleItemAt(scenePos, &handle);
+    return item ? m_items.value(item)->handleCursor(handle) : Qt::ArrowCursor;
+}
+
+void SelectionOverlay::mousePressEvent(QGraphicsSceneMouseEvent *event)
+{
+    int handle = 0;
+    QGraphicsItem *item = handleItemAt(event->scenePos(), &handle);
+    if (!item) {
+        event->ignore();
+        return;
+    }
+    // 旋转由鼠标坐标广播驱动（CustomView 已先广播了这次按下），这里只接住事件，
+    // 避免场景清空选择或视图开始框选
+    ItemCommon *common = m_items.value(item);
+    if (!common->isRotateHandling) {
+        common->beginHandleDrag(handle, item->mapFromScene(event->scenePos()));
+        m_dragItem = item;
+    }
+}
+
+void SelectionOverlay::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
+{
+    if (auto *common = dynamic_cast<ItemCommon*>(m_dragItem))
+        common->dragHandle(m_dragItem->mapFromScene(event->scenePos()));
+}
+
+void SelectionOverlay::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
+{
+    Q_UNUSED(event)
+    if (auto *common = dynamic_cast<ItemCommon*>(m_dragItem))
+        common->endHandleDrag();
+    m_dragItem = nullptr;
+}
@@ -0,0 +1,54 @@
+#ifndef SELECTIONOVERLAY_H
+#define SELECTIONOVERLAY_H
+
+#include <QGraphicsItem>
+#include <QHash>
+#include "common.h"
+
+// 选中图元的控制点层：所有选中图元的控制点都由这一个图元绘制和命中测试，
+// 画布上的图元自身只按紧凑包围盒重绘、参与点选。由 CanvasScene 创建并维护，始终位于最上层。
+// 场景中没有图元接收悬停事件（一旦有图元接收，QGraphicsScene 此后每次鼠标移动都要做一次全场景命中测试），
+// 控制点上的光标由 CustomView 在鼠标移动时通过 cursorAt() 查询
+class SelectionOverlay : public QGraphicsItem
+{
+public:
+    SelectionOverlay();
+
+    QRectF boundingRect() const override;
+    bool contains(const QPointF &point) const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
+    // 由 CanvasScene 在图元选中状态变化、几何变化以及离开场景时调用
+    void itemSelectionChanged(QGraphicsItem *item);
+    void itemRemoved(QGraphicsItem *item);
+    void itemGeometryChanged(QGraphicsItem *item);
+    // 图元包围盒不变、只有 localRect 内的控制点可能移动时只重绘这一块
+    void itemRegionChanged(QGraphicsItem *item, const QRectF &localRect);
+    // 视图缩放改变了 ItemCommon::handleScale() 后由 CustomView 调用，重新计算选中图元的控制点
+    void handleScaleChanged();
+
+    // scenePos 处的控制点所属的选中图元（重叠时取堆叠在最上面的），handle 返回控制点编号
+    QGraphicsItem *handleItemAt(const QPointF &scenePos, int *handle = nullptr) const;
+    // scenePos 处应显示的光标，不在任何控制点上时为箭头
+    Qt::CursorShape cursorAt(const QPointF &scenePos) const;
+    bool isEmpty() const { return m_items.isEmpty(); }
+
+protected:
+    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
+
+private:
+    // 控制点区域与 sceneRect 相交的选中图元
+    QList<QGraphicsItem*> itemsNear(const QRectF &sceneRect) const;
+    QRectF handlesSceneRect(QGraphicsItem *item, ItemCommon *common) const;
+    void invalidate();
+
+    QHash<QGraphicsItem*, ItemCommon*> m_items; // 当前选中的图元
+    mutable QRectF m_bounds;
+    mutable bool m_boundsDirty = false;
+    QGraphicsItem *m_dragItem = nullptr;        // 正在拖动控制点的图元
+};
+
+#endif // SELECTIONOVERLAY_H
@@ -1,9 +1,7 @@
 #include "common.h"
-#include "transformablelineitem.h"
-#include "transformablerectitem.h"
-#include "transformableellipseitem.h"
-#include "transformablepolygonitem.h"
-#include "transformablepathitem.h"
+#include "itemstate.h"
+#include <QGraphicsScene>
+#include <atomic>
 
 static QJsonArray pathToArray(const QPainterPath &p)
 {
@@ -19,137 +17,136 @@ static QJsonArray pathToArray(const QPainterPath &p)
 static QPainterPath arrayToPath(const QJsonArray &arr)
 {
     QPainterPath p;
-    for (const QJsonValue &v : arr) {
-        QJsonArray e = v.toArray();
-        int type = e[0].toInt();
-        qreal x  = e[1].toDouble();
-        qreal y  = e[2].toDouble();
+    p.reserve(arr.size());
+    auto pointAt = [&arr](qsizetype i) {
+        QJsonArray e = arr[i].toArray();
+        return QPointF(e[1].toDouble(), e[2].toDouble());
+    };
+    for (qsizetype i = 0; i < arr.size(); ++i) {
+        int type = arr[i].toArray()[0].toInt();
         switch (type) {
-        case QPainterPath::MoveToElement:  p.moveTo(x, y);  break;
-        case QPainterPath::LineToElement:  p.lineTo(x, y);  break;
+        case QPainterPath::MoveToElement:  p.moveTo(pointAt(i));  break;
+        case QPainterPath::LineToElement:  p.lineTo(pointAt(i));  break;
         case QPainterPath::CurveToElement:
-            /* 需再读两个控制点 */
-            break; // 若用到 cubic 需继续展开
+            /* CurveTo 为第一个控制点，其后紧跟两个 CurveToData：第二个控制点和终点 */
+            if (i + 2 < arr.size()) {
+                p.cubicTo(pointAt(i), pointAt(i + 1), pointAt(i + 2));
+                i += 2;
+            }
+            break;
+        default: // 孤立的 CurveToData 忽略
+            break;
         }
     }
     return p;
 }
 
-inline QString itemType(QGraphicsItem *it)
+static std::atomic<quint64> s_nextItemId{1};
+
+quint64 ItemCommon::nextItemId()
 {
-    if (qgraphicsitem_cast<TransformablePathItem*>(it))     return "TransformablePathItem";
-    if (qgraphicsitem_cast<TransformableLineItem*>(it))     return "TransformableLineItem";
-    if (qgraphicsitem_cast<TransformableRectItem*>(it))     return "TransformableRectItem";
-    if (qgraphicsitem_cast<TransformableEllipseItem*>(it))  return "TransformableEllipseItem";
-    if (qgraphicsitem_cast<TransformablePolygonItem*>(it))  return "TransformablePolygonItem";
-    return "Unknown";
+    return s_nextItemId.fetch_add(1);
 }
 
-QJsonObject itemToJson(QGraphicsItem *item)
+void ItemCommon::reserveItemId(quint64 id)
+{
+    quint64 next = s_nextItemId.load();
+    while (next <= id && !s_nextItemId.compare_exchange_weak(next, id + 1)) {}
+}
+
+QJsonObject itemStateToJson(const ItemState &st)
 {
     QJsonObject obj;
-    if (!item) return obj;
 
     /* 公共属性 */
-    obj["type"] = itemType(item);
-    obj["z"]    = item->zValue();
-    obj["rot"]  = item->rotation();
-    QJsonArray pos = {item->pos().x(), item->pos().y()};
+    obj["type"] = st.type;
+    if (st.id)
+        obj["id"] = qint64(st.id);
+    obj["z"]    = st.z;
+    obj["rot"]  = st.rotation;
+    QJsonArray pos = {st.pos.x(), st.pos.y()};
     obj["pos"]  = pos;
+    QJsonArray origin = {st.origin.x(), st.origin.y()};
+    obj["origin"] = origin;
 
-    ItemCommon *c = dynamic_cast<ItemCommon*>(item);
-    if (c) {
-        obj["penColor"]   = c->penColor.name(QColor::HexArgb);
-        obj["brushColor"] = c->brushColor.name(QColor::HexArgb);
-        obj["penWidth"]   = c->penWidth;
-        obj["penStyle"]   = c->penStyle;
-    }
+    obj["penColor"]   = st.style.penColor.name(QColor::HexArgb);
+    obj["brushColor"] = st.style.brushColor.name(QColor::HexArgb);
+    obj["penWidth"]   = st.style.penWidth;
+    obj["penStyle"]   = st.style.penStyle;
 
     /* 各类型私有数据 */
-    if (auto *l = qgraphicsitem_cast<TransformableLineItem*>(item)) {
-        QLineF ln = l->line();
-        obj["x1"] = ln.x1(); obj["y1"] = ln.y1();
-        obj["x2"] = ln.x2(); obj["y2"] = ln.y2();
-    } else if (auto *r = qgraphicsitem_cast<TransformableRectItem*>(item)) {
-        QRectF rc = r->rect();
-        obj["x"] = rc.x(); obj["y"] = rc.y();
-        obj["w"] = rc.width(); obj["h"] = rc.height();
-    } else if (auto *e = qgraphicsitem_cast<TransformableEllipseItem*>(item)) {
-        QRectF rc = e->rect();
-        obj["x"] = rc.x(); obj["y"] = rc.y();
-        obj["w"] = rc.width(); obj["h"] = rc.height();
-        obj["circle"] = e->isCircle;
-    } else if (auto *p = qgraphicsitem_cast<TransformablePolygonItem*>(item)) {
+    const ItemGeometry &g = st.geometry;
+    if (st.type == "TransformableLineItem") {
+        obj["x1"] = g.line.x1(); obj["y1"] = g.line.y1();
+        obj["x2"] = g.line.x2(); obj["y2"] = g.line.y2();
+    } else if (st.type == "TransformableRectItem") {
+        obj["x"] = g.rect.x(); obj["y"] = g.rect.y();
+        obj["w"] = g.rect.width(); obj["h"] = g.rect.height();
+    } else if (st.type == "TransformableEllipseItem") {
+        obj["x"] = g.rect.x(); obj["y"] = g.rect.y();
+        obj["w"] = g.rect.width(); obj["h"] = g.rect.height();
+        obj["circle"] = g.circle;
+    } else if (st.type == "TransformablePolygonItem" || st.type == "TransformableCurveItem") {
         QJsonArray pts;
-        for (const QPointF &pt : p->polygon())
+        for (const QPointF &pt : g.polygon)
             pts.append(QJsonArray{pt.x(), pt.y()});
         obj["points"] = pts;
-    } else if (auto *pa = qgraphicsitem_cast<TransformablePathItem*>(item)) {
-        obj["path"] = pathToArray(pa->path());   // QPainterPath 自带字符串序列化
+    } else if (st.type == "TransformablePathItem") {
+        obj["path"] = pathToArray(g.path);   // QPainterPath 自带字符串序列化
     }
     return obj;
 }
 
-void jsonToItem(const QJsonObject &o, QGraphicsScene *scene)
+ItemState jsonToItemState(const QJsonObject &o)
 {
-    QString type = o["type"].toString();
-    qreal z  = o["z"].toDouble();
-    qreal rot= o["rot"].toDouble();
+    ItemState st;
+    st.type     = o["type"].toString();
+    st.id       = quint64(o["id"].toInteger());
+    st.z        = o["z"].toDouble();
+    st.rotation = o["rot"].toDouble();
     QJsonArray posArr = o["pos"].toArray();
-    QPointF pos(posArr[0].toDouble(), posArr[1].toDouble());
+    st.pos = QPointF(posArr[0].toDouble(), posArr[1].toDouble());
+    // 旧文档没有 "origin"，保持 (0, 0)
+    QJsonArray originArr = o["origin"].toArray();
+    if (originArr.size() == 2)
+        st.origin = QPointF(originArr[0].toDouble(), originArr[1].toDouble());
 
-    auto applyCommon = [&](QGraphicsItem *it){
-        it->setPos(pos);
-        it->setRotation(rot);
-        it->setZValue(z);
-        if (ItemCommon *c = dynamic_cast<ItemCommon*>(it)) {
-            c->penColor   = QColor(o["penColor"].toString());
-            c->brushColor = QColor(o["brushColor"].toString());
-            c->penWidth   = o["penWidth"].toInt();
-            c->penStyle   = static_cast<Qt::PenStyle>(o["penStyle"].toInt());
-        }
-    };
+    st.style.penColor   = QColor(o["penColor"].toString());
+    st.style.brushColor = QColor(o["brushColor"].toString());
+    st.style.penWidth   = o["penWidth"].toInt();
+    st.style.penStyle   = static_cast<Qt::PenStyle>(o["penStyle"].toInt());
 
-    if (type == "TransformableLineItem") {
-        auto *l = new TransformableLineItem(QLineF(
-            o["x1"].toDouble(), o["y1"].toDouble(),
-            o["x2"].toDouble(), o["y2"].toDouble()));
-        applyCommon(l);
-        l->setPen(QPen(l->penColor, l->penWidth, l->penStyle));
-        scene->addItem(l);
-    } else if (type == "TransformableRectItem") {
-        auto *r = new TransformableRectItem(QRectF(
-            o["x"].toDouble(), o["y"].toDouble(),
-            o["w"].toDouble(), o["h"].toDouble()));
-        applyCommon(r);
-        r->setPen(QPen(r->penColor, r->penWidth, r->penStyle));
-        r->setBrush(QBrush(r->brushColor));
-        scene->addItem(r);
-    } else if (type == "TransformableEllipseItem") {
-        auto *e = new TransformableEllipseItem(QRectF(
-                                                   o["x"].toDouble(), o["y"].toDouble(),
-                                                   o["w"].toDouble(), o["h"].toDouble()), nullptr, o["circle"].toBool());
-        applyCommon(e);
-        e->setPen(QPen(e->penColor, e->penWidth, e->penStyle));
-        e->setBrush(QBrush(e->brushColor));
-        scene->addItem(e);
-    } else if (type == "TransformablePolygonItem") {
+    ItemGeometry &g = st.geometry;
+    if (st.type == "TransformableLineItem") {
+        g.line = QLineF(o["x1"].toDouble(), o["y1"].toDouble(),
+                        o["x2"].toDouble(), o["y2"].toDouble());
+    } else if (st.type == "TransformableRectItem" || st.type == "TransformableEllipseItem") {
+        g.rect = QRectF(o["x"].toDouble(), o["y"].toDouble(),
+                        o["w"].toDouble(), o["h"].toDouble());
+        g.circle = o["circle"].toBool();
+    } else if (st.type == "TransformablePolygonItem" || st.type == "TransformableCurveItem") {
         QJsonArray pts = o["points"].toArray();
-        QPolygonF poly;
+        g.polygon.reserve(pts.size());
         for (int i = 0; i < pts.size(); ++i) {
             QJsonArray p = pts[i].toArray();
-            poly << QPointF(p[0].toDouble(), p[1].toDouble());
+            g.polygon << QPointF(p[0].toDouble(), p[1].toDouble());
         }
-        auto *p = new TransformablePolygonItem(poly);
-        applyCommon(p);
-        p->setPen(QPen(p->penColor, p->penWidth, p->penStyle));
-        p->setBrush(QBrush(p->brushColor));
-        scene->addItem(p);
-    } else if (type == "TransformablePathItem") {
-        QPainterPath path = arrayToPath(o["path"].toArray());
-        auto *pa = new TransformablePathItem(path);
-        applyCommon(pa);
-        pa->setPen(QPen(pa->penColor, pa->penWidth, pa->penStyle));
-        scene->addItem(pa);
+    } else if (st.type == "TransformablePathItem") {
+        g.path = arrayToPath(o["path"].toArray());
     }
+    return st;
+}
+
+QJsonObject itemToJson(QGraphicsItem *item)
+{
+    if (!item) return QJsonObject();
+    return itemStateToJson(captureItemState(item));
+}
+
+QGraphicsItem *jsonToItem(const QJsonObject &o, QGraphicsScene *scene)
+{
+    QGraphicsItem *item = createItem(jsonToItemState(o));
+    if (item && scene)
+        scene->addItem(item);
+    return item;
 }
@@ -0,0 +1,329 @@
+#include "strokefitting.h"
+#include <QVector>
+#include <QVarLengthArray>
+#include <QPair>
+#include <QtMath>
+#include <algorithm>
+
+namespace {
+
+inline qreal dot(const QPointF &a, const QPointF &b) { return QPointF::dotProduct(a, b); }
+
+inline QPointF normalized(const QPointF &v)
+{
+    const qreal len = qSqrt(dot(v, v));
+    return len > 0 ? v / len : v;
+}
+
+// 点到线段的距离平方
+qreal segmentDistance2(const QPointF &p, const QPointF &a, const QPointF &b)
+{
+    const QPointF ab = b - a;
+    const qreal len2 = dot(ab, ab);
+    qreal t = len2 > 0 ? dot(p - a, ab) / len2 : 0;
+    t = qBound<qreal>(0, t, 1);
+    const QPointF d = p - (a + ab * t);
+    return dot(d, d);
+}
+
+/* ===== Schneider 曲线拟合 ===== */
+struct Bezier { QPointF p[4]; };
+
+QPointF bezierAt(const QPointF *q, int degree, qreal t)
+{
+    QPointF tmp[4];
+    for (int i = 0; i <= degree; ++i) tmp[i] = q[i];
+    for (int i = 1; i <= degree; ++i)
+        for (int j = 0; j <= degree - i; ++j)
+            tmp[j] = (1 - t) * tmp[j] + t * tmp[j + 1];
+    return tmp[0];
+}
+
+inline qreal B0(qreal u) { const qreal t = 1 - u; return t * t * t; }
+inline qreal B1(qreal u) { const qreal t = 1 - u; return 3 * u * t * t; }
+inline qreal B2(qreal u) { const qreal t = 1 - u; return 3 * u * u * t; }
+inline qreal B3(qreal u) { return u * u * u; }
+
+class CurveFitter
+{
+public:
+    // d 为参与拟合的点；raw 不为空时 d[i] 是 raw[rawIndex[i]]，误差还要对 raw 中夹在其间的原始采样点检查
+    CurveFitter(const QPolygonF &d, qreal error, QPainterPath &out,
+                const QPolygonF *raw = nullptr, const QVector<qsizetype> *rawIndex = nullptr)
+        : d(d), raw(raw), rawIndex(rawIndex), error(error), error2(error * error), out(out) {}
+
+    void fit(int first, int last, const QPointF &tHat1, const QPointF &tHat2)
+    {
+        // 用显式栈代替递归，长笔画也不会栈溢出；先处理左半段，输出按笔画顺序排列
+        struct Span { int first, last; QPointF tHat1, tHat2; };
+        QVector<Span> stack;
+        stack.append({first, last, tHat1, tHat2});
+        while (!stack.isEmpty()) {
+            const Span s = stack.takeLast();
+            int split = 0;
+            if (fitSpan(s.first, s.last, s.tHat1, s.tHat2, split))
+                continue;
+            // 在误差最大的点处拆成两段分别拟合
+            const QPointF tHatCenter = normalized((d[split - 1] - d[split]) + (d[split] - d[split + 1]));
+            stack.append({split, s.last, -tHatCenter, s.tHat2});
+            stack.append({s.first, split, s.tHat1, tHatCenter});
+        }
+    }
+
+private:
+    // 能用一段曲线拟合时输出并返回 true，否则返回 false 并给出拆分点
+    bool fitSpan(int first, int last, const QPointF &tHat1, const QPointF &tHat2, int &split)
+    {
+        const int nPts = last - first + 1;
+        if (nPts == 2) {
+            const qreal dist = QLineF(d[first], d[last]).length() / 3;
+            const Bezier bez{{d[first], d[first] + tHat1 * dist, d[last] + tHat2 * dist, d[last]}};
+            int unused = 0;
+            if (rawError(first, last, bez, unused) < error2) {
+                appendCurve(bez);
+            } else {
+                // 简化时保证了两点之间的原始采样点离弦不超过 tolerance，退回直线
+                const QPointF step = (d[last] - d[first]) / 3;
+                appendCurve({{d[first], d[first] + step, d[last] - step, d[last]}});
+            }
+            return true;
+        }
+
+        QVector<qreal> u = chordLengthParameterize(first, last);
+        Bezier bez = generate(first, last, u, tHat1, tHat2);
+        qreal maxError = computeMaxError(first, last, bez, u, split);
+        if (maxError < error2 && rawError(first, last, bez, split) < error2) {
+            appendCurve(bez);
+            return true;
+        }
+
+        // 误差不太大时先尝试用牛顿迭代修正参数
+        if (maxError < error2 * 4) {
+            for (int i = 0; i < 4; ++i) {
+                u = reparameterize(first, last, u, bez);
+                bez = generate(first, last, u, tHat1, tHat2);
+                maxError = computeMaxError(first, last, bez, u, split);
+                if (maxError < error2 && rawError(first, last, bez, split) < error2) {
+                    appendCurve(bez);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void appendCurve(const Bezier &b) { out.cubicTo(b.p[1], b.p[2], b.p[3]); }
+
+    // d[first]..d[last] 之间的原始采样点到曲线的最大距离平方，超出误差时把 split 改为离最远采样点最近的拟合点。
+    // 曲线按 error / 10 的精度展平后计算点到折线的距离
+    qreal rawError(int first, int last, const Bezier &bez, int &split) const
+    {
+        if (!raw) return 0;
+        const qsizetype rawFirst = rawIndex->at(first);
+        const qsizetype rawLast = rawIndex->at(last);
+        if (rawLast - rawFirst < 2) return 0;
+
+        const QPointF dd1 = bez.p[0] - 2 * bez.p[1] + bez.p[2];
+        const QPointF dd2 = bez.p[1] - 2 * bez.p[2] + bez.p[3];
+        const qreal m = qSqrt(qMax(dot(dd1, dd1), dot(dd2, dd2)));
+        const int steps = qBound(8, qCeil(qSqrt(0.75 * m / (error * 0.1))), 256);
+        QVarLengthArray<QPointF, 257> flat;
+        for (int i = 0; i <= steps; ++i)
+            flat.append(bezierAt(bez.p, 3, qreal(i) / steps));
+
+        qreal maxDist = 0;
+        qsizetype worst = -1;
+        for (qsizetype i = rawFirst + 1; i < rawLast; ++i) {
+            const QPointF &p = raw->at(i);
+            qreal dist = segmentDistance2(p, flat[0], flat[1]);
+            for (int j = 2; j <= steps && dist > 0; ++j)
+                dist = qMin(dist, segmentDistance2(p, flat[j - 1], flat[j]));
+            if (dist >= maxDist) {
+                maxDist = dist;
+                worst = i;
+            }
+        }
+        if (maxDist >= error2 && last - first > 1) {
+            const auto it = std::lower_bound(rawIndex->begin() + first, rawIndex->begin() + last, worst);
+            split = qBound(first + 1, int(it - rawIndex->begin()), last - 1);
+        }
+        return maxDist;
+    }
+
+    QVector<qreal> chordLengthParameterize(int first, int last) const
+    {
+        QVector<qreal> u(last - first + 1);
+        u[0] = 0;
+        for (int i = first + 1; i <= last; ++i)
+            u[i - first] = u[i - first - 1] + QLineF(d[i], d[i - 1]).length();
+        const qreal total = u[last - first];
+        for (int i = first + 1; i <= last; ++i)
+            u[i - first] = total > 0 ? u[i - first] / total : 0;
+        return u;
+    }
+
+    // 固定两端点与切线方向，用最小二乘求两个控制点到端点的距离
+    Bezier generate(int first, int last, const QVector<qreal> &u,
+                    const QPointF &tHat1, const QPointF &tHat2) const
+    {
+        qreal c00 = 0, c01 = 0, c11 = 0, x0 = 0, x1 = 0;
+        for (int i = 0; i <= last - first; ++i) {
+            const QPointF a0 = tHat1 * B1(u[i]);
+            const QPointF a1 = tHat2 * B2(u[i]);
+            c00 += dot(a0, a0);
+            c01 += dot(a0, a1);
+            c11 += dot(a1, a1);
+            const QPointF tmp = d[first + i]
+                                - (d[first] * (B0(u[i]) + B1(u[i])) + d[last] * (B2(u[i]) + B3(u[i])));
+            x0 += dot(a0, tmp);
+            x1 += dot(a1, tmp);
+        }
+
+        const qreal detC = c00 * c11 - c01 * c01;
+        const qreal alphaL = qFuzzyIsNull(detC) ? 0 : (x0 * c11 - x1 * c01) / detC;
+        const qreal alphaR = qFuzzyIsNull(detC) ? 0 : (c00 * x1 - c01 * x0) / detC;
+
+        const qreal segLength = QLineF(d[first], d[last]).length();
+        const qreal epsilon = 1e-6 * segLength;
+        if (alphaL < epsilon || alphaR < epsilon) {
+            // 最小二乘结果不可用时退回到按弦长三等分的估计
+            const qreal dist = segLength / 3;
+            return {{d[first], d[first] + tHat1 * dist, d[last] + tHat2 * dist, d[last]}};
+        }
+        return {{d[first], d[first] + tHat1 * alphaL, d[last] + tHat2 * alphaR, d[last]}};
+    }
+
+    qreal computeMaxError(int first, int last, const Bezier &bez,
+                          const QVector<qreal> &u, int &split) const
+    {
+        split = (last - first + 1) / 2 + first;
+        qreal maxDist = 0;
+        for (int i = first + 1; i < last; ++i) {
+            const QPointF v = bezierAt(bez.p, 3, u[i - first]) - d[i];
+            const qreal dist = dot(v, v);
+            if (dist >= maxDist) {
+                maxDist = dist;
+                split = i;
+            }
+        }
+        return maxDist;
+    }
+
+    QVector<qreal> reparameterize(int first, int last, const QVector<qreal> &u,
+                                  const Bezier &bez) const
+    {
+        QPointF q1[3], q2[2];
+        for (int i = 0; i < 3; ++i) q1[i] = (bez.p[i + 1] - bez.p[i]) * 3;
+        for (int i = 0; i < 2; ++i) q2[i] = (q1[i + 1] - q1[i]) * 2;
+
+        QVector<qreal> uPrime(u.size());
+        for (int i = first; i <= last; ++i) {
+            const qreal t = u[i - first];
+            const QPointF qu = bezierAt(bez.p, 3, t) - d[i];
+            const QPointF q1u = bezierAt(q1, 2, t);
+            const QPointF q2u = bezierAt(q2, 1, t);
+            const qreal denominator = dot(q1u, q1u) + dot(qu, q2u);
+            uPrime[i - first] = qFuzzyIsNull(denominator) ? t : t - dot(qu, q1u) / denominator;
+        }
+        return uPrime;
+    }
+
+    const QPolygonF &d;
+    const QPolygonF *raw;
+    const QVector<qsizetype> *rawIndex;
+    const qreal error;
+    const qreal error2;
+    QPainterPath &out;
+};
+
+} // namespace
+
+// RDP 简化，返回保留下来的点的下标（升序）
+static QVector<qsizetype> simplifyIndices(const QPolygonF &points, qreal tolerance)
+{
+    const qsizetype n = points.size();
+    QVector<qsizetype> result;
+    if (n < 3 || tolerance <= 0) {
+        for (qsizetype i = 0; i < n; ++i)
+            result << i;
+        return result;
+    }
+
+    const qreal tol2 = tolerance * tolerance;
+    QVector<bool> keep(n, false);
+    keep[0] = keep[n - 1] = true;
+
+    // 用显式栈代替递归，长笔画也不会栈溢出
+    QVector<QPair<qsizetype, qsizetype>> stack;
+    stack.append({0, n - 1});
+    while (!stack.isEmpty()) {
+        const auto [a, b] = stack.takeLast();
+        qreal maxDist = -1;
+        qsizetype index = -1;
+        for (qsizetype i = a + 1; i < b; ++i) {
+            const qreal dist = segmentDistance2(points[i], points[a], points[b]);
+            if (dist > maxDist) {
+                maxDist = dist;
+                index = i;
+            }
+        }
+        if (index >= 0 && maxDist > tol2) {
+            keep[index] = true;
+            stack.append({a, index});
+            stack.append({index, b});
+        }
+    }
+
+    for (qsizetype i = 0; i < n; ++i)
+        if (keep[i])
+            result << i;
+    return result;
+}
+
+QPolygonF simplifyPolyline(const QPolygonF &points, qreal tolerance)
+{
+    if (points.size() < 3 || tolerance <= 0) return points;
+    QPolygonF result;
+    for (qsizetype i : simplifyIndices(points, tolerance))
+        result << points[i];
+    return result;
+}
+
+QPainterPath fitCubicPath(const QPolygonF &points, qreal tolerance)
+{
+    QPainterPath path;
+    if (points.isEmpty()) return path;
+    path.moveTo(points.first());
+    if (points.size() < 2) return path;
+
+    const int last = int(points.size()) - 1;
+    const QPointF tHat1 = normalized(points[1] - points[0]);
+    const QPointF tHat2 = normalized(points[last - 1] - points[last]);
+    CurveFitter(points, tolerance, path).fit(0, last, tHat1, tHat2);
+    return path;
+}
+
+QPainterPath smoothStroke(const QPolygonF &points, qreal tolerance)
+{
+    QPainterPath path;
+    if (points.isEmpty()) return path;
+    if (tolerance <= 0) {
+        path.addPolygon(points);
+        return path;
+    }
+
+    // 在简化后的点上拟合，但误差对全部原始采样点检查，曲线与原始笔画的偏差不超过 tolerance
+    const QVector<qsizetype> index = simplifyIndices(points, tolerance);
+    QPolygonF simplified;
+    simplified.reserve(index.size());
+    for (qsizetype i : index)
+        simplified << points[i];
+
+    path.moveTo(simplified.first());
+    if (simplified.size() < 2) return path;
+    const int last = int(simplified.size()) - 1;
+    const QPointF tHat1 = normalized(simplified[1] - simplified[0]);
+    const QPointF tHat2 = normalized(simplified[last - 1] - simplified[last]);
+    CurveFitter(simplified, tolerance, path, &points, &index).fit(0, last, tHat1, tHat2);
+    return path;
+}
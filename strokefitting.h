@@ -0,0 +1,18 @@
+#ifndef STROKEFITTING_H
+#define STROKEFITTING_H
+
+#include <QPolygonF>
+#include <QPainterPath>
+
+// 任意画笔松开鼠标后的笔画处理：先用 Ramer–Douglas–Peucker 算法减少采样点，
+// 再用三次贝塞尔曲线拟合（Schneider 算法），tolerance 为允许的最大偏差（场景单位）
+
+// 删去偏离折线不超过 tolerance 的点，首尾点总会保留
+QPolygonF simplifyPolyline(const QPolygonF &points, qreal tolerance);
+// 用若干段三次贝塞尔曲线逼近 points，每段与原始点的偏差不超过 tolerance
+QPainterPath fitCubicPath(const QPolygonF &points, qreal tolerance);
+// 先简化再拟合，拟合误差对全部原始采样点检查，结果与 points 的偏差不超过 tolerance；
+// tolerance <= 0 时按原始折线返回
+QPainterPath smoothStroke(const QPolygonF &points, qreal tolerance);
+
+#endif // STROKEFITTING_H
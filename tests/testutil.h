@@ -0,0 +1,53 @@
+#ifndef TESTUTIL_H
+#define TESTUTIL_H
+
+// 各正确性测试共用的辅助函数
+#include <QtTest>
+#include <QApplication>
+#include "itemstate.h"
+#include "scenegenerator.h"
+
+// 无显示环境下默认使用 offscreen 平台，由 ctest 运行
+#define PROTOSHOP_TEST_MAIN(TestClass) \
+    int main(int argc, char *argv[]) \
+    { \
+        if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) \
+            qputenv("QT_QPA_PLATFORM", "offscreen"); \
+        QApplication app(argc, argv); \
+        TestClass tests; \
+        return QTest::qExec(&tests, argc, argv); \
+    }
+
+// 三段贝塞尔曲线，坐标带小数以检查精度
+inline ItemState makeCurveState()
+{
+    ItemState st;
+    st.type = "TransformableCurveItem";
+    st.id = 4242;
+    st.pos = QPointF(12.5, -7.25);
+    st.rotation = 33.3;
+    st.origin = QPointF(50.125, 40.0625);
+    st.z = 3;
+    st.geometry.polygon = QPolygonF{{0, 0}, {10.1, 30.7}, {40.3, 30.9}, {50, 0},
+                                    {60, -30}, {90.55, -29.5}, {100, 0.001},
+                                    {110, 10}, {120, 20.5}, {130.25, 0}};
+    st.style.penColor = QColor::fromRgb(0xff123456);
+    st.style.brushColor = QColor::fromRgba(0x80abcdef);
+    st.style.penWidth = 3;
+    st.style.penStyle = Qt::DashLine;
+    return st;
+}
+
+// 各类图元混合的文档，包括旋转、带 CurveTo 的任意画笔和贝塞尔曲线
+inline QList<ItemState> makeDocumentStates()
+{
+    SceneGeneratorOptions opt;
+    opt.setUniformMix(200);
+    opt.fitStrokes = true; // 任意画笔中带 CurveTo 元素
+    opt.maxRotation = 90;
+    QList<ItemState> states = generateScene(opt);
+    states.append(makeCurveState());
+    return states;
+}
+
+#endif // TESTUTIL_H
@@ -0,0 +1,172 @@
+// 贝塞尔曲线图元：命中测试的展平折线与曲线的偏差不超过容差，移动控制点后局部重新展平的结果
+// 与整条重新展平一致；每个控制点都能单独命中和拖动
+#include "testutil.h"
+#include <QRandomGenerator>
+#include <limits>
+#include "segmentbvh.h"
+#include "transformablecurveitem.h"
+
+// 命中测试折线与曲线的最大偏差（与 TransformableCurveItem::HIT_FLATTEN_TOLERANCE 相同），
+// 再加上这里密集采样曲线本身的误差
+static const qreal FLATTEN_MARGIN = 0.25 + 0.05;
+
+static QPointF cubicAt(const QPolygonF &points, int segment, qreal t)
+{
+    const QPointF &p0 = points[3 * segment], &p1 = points[3 * segment + 1];
+    const QPointF &p2 = points[3 * segment + 2], &p3 = points[3 * segment + 3];
+    const qreal mt = 1 - t;
+    return mt * mt * mt * p0 + 3 * mt * mt * t * p1 + 3 * mt * t * t * p2 + t * t * t * p3;
+}
+
+// 点到曲线的距离，曲线按很细的步长采样
+static qreal curveDistance(const QPolygonF &points, const QPointF &p)
+{
+    qreal best = std::numeric_limits<qreal>::infinity();
+    const int segments = int(points.size() - 1) / 3;
+    for (int s = 0; s < segments; ++s) {
+        QPointF prev = points[3 * s];
+        for (int k = 1; k <= 2000; ++k) {
+            const QPointF q = cubicAt(points, s, k / 2000.0);
+            best = qMin(best, pointSegmentDistance(p, QLineF(prev, q)));
+            prev = q;
+        }
+    }
+    return best;
+}
+
+// 三段曲线，控制点相距都大于控制点的大小
+static QPolygonF makePoints()
+{
+    return QPolygonF{{0, 0}, {40, -120}, {160, 120}, {200, 0},
+                     {240, -90}, {300, -60}, {330, 10},
+                     {360, 80}, {420, 150}, {480, 40}};
+}
+
+class CurveItemTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void curvePath();
+    void hitFlattening_data();
+    void hitFlattening();
+    void incrementalMatchesRebuild();
+    void pointHandles();
+};
+
+void CurveItemTests::curvePath()
+{
+    const QPolygonF points = makePoints();
+    TransformableCurveItem item(points);
+    QCOMPARE(item.segmentCount(), 3);
+    const QPainterPath path = TransformableCurveItem::curvePath(points);
+    QCOMPARE(path.elementCount(), int(points.size()));
+    for (int i = 0; i < points.size(); ++i)
+        QCOMPARE(QPointF(path.elementAt(i)), points[i]);
+    // 不足一段时没有可画的曲线
+    const TransformableCurveItem single(QPolygonF{{0, 0}, {1, 1}});
+    QCOMPARE(single.segmentCount(), 0);
+}
+
+void CurveItemTests::hitFlattening_data()
+{
+    QTest::addColumn<qreal>("penWidth");
+    QTest::addColumn<qreal>("handleScale");
+    QTest::newRow("thin") << qreal(1) << qreal(1);
+    QTest::newRow("wide") << qreal(12) << qreal(1);
+    QTest::newRow("thin zoomed in") << qreal(1) << qreal(0.125);
+}
+
+void CurveItemTests::hitFlattening()
+{
+    QFETCH(qreal, penWidth);
+    QFETCH(qreal, handleScale);
+    ItemCommon::setHandleScale(handleScale);
+    const QPolygonF points = makePoints();
+    TransformableCurveItem item(points);
+    item.setPen(QPen(Qt::black, penWidth, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    const qreal radius = ItemCommon::hitRadius(penWidth);
+
+    // 曲线上的点总能点中
+    QRandomGenerator rng(quint32(penWidth * 100 + handleScale * 10));
+    for (int q = 0; q < 300; ++q)
+        QVERIFY(item.contains(cubicAt(points, q % 3, rng.generateDouble())));
+
+    // 离曲线的距离与半宽相差超过展平容差的点，结果是确定的
+    const QRectF range = item.boundingRect();
+    int decided = 0;
+    for (int q = 0; q < 1500; ++q) {
+        const QPointF pos(rng.bounded(range.left(), range.right()), rng.bounded(range.top(), range.bottom()));
+        const qreal dist = curveDistance(points, pos);
+        if (qAbs(dist - radius) <= FLATTEN_MARGIN) continue;
+        QCOMPARE(item.contains(pos), dist < radius);
+        ++decided;
+    }
+    QVERIFY(decided > 1000);
+    ItemCommon::setHandleScale(1);
+}
+
+void CurveItemTests::incrementalMatchesRebuild()
+{
+    // 拖动控制点时只重新展平相邻的段，结果应与按最终控制点新建的图元完全相同
+    TransformableCurveItem item(makePoints());
+    item.setPen(QPen(Qt::black, 3));
+    QRandomGenerator rng(41);
+    const QRectF range = item.boundingRect().adjusted(-50, -50, 50, 50);
+    auto probe = [&](const TransformableCurveItem &a, const TransformableCurveItem &b) {
+        for (int q = 0; q < 500; ++q) {
+            const QPointF pos(rng.bounded(range.left(), range.right()), rng.bounded(range.top(), range.bottom()));
+            QCOMPARE(a.contains(pos), b.contains(pos));
+        }
+        QCOMPARE(a.shape(), b.shape());
+    };
+    // 先建立命中测试缓存，再移动
+    QVERIFY(item.contains(item.points().first()));
+    item.shape();
+    for (int index : {4, 6, 0, 9, 3}) {
+        item.movePoint(index, item.points()[index] + QPointF(17, -23));
+        item.settlePoints();
+        TransformableCurveItem rebuilt(item.points());
+        rebuilt.setPen(item.pen());
+        probe(item, rebuilt);
+        if (QTest::currentTestFailed()) return;
+        QCOMPARE(item.boundingRect(), rebuilt.boundingRect());
+    }
+}
+
+void CurveItemTests::pointHandles()
+{
+    const QPolygonF points = makePoints();
+    TransformableCurveItem item(points);
+    const int first = item.handleAt(points[0]);
+    QCOMPARE(item.handleCursor(first), Qt::CrossCursor);
+    for (int i = 0; i < points.size(); ++i)
+        QCOMPARE(item.handleAt(points[i] + QPointF(2, 2)), first + i);
+
+    // 拖动锚点时两侧的控制点一起平移
+    const QPointF delta(25, 35);
+    item.beginHandleDrag(first + 3, points[3]);
+    item.dragHandle(points[3] + delta);
+    item.endHandleDrag();
+    QPolygonF expected = points;
+    for (int i : {2, 3, 4})
+        expected[i] += delta;
+    QCOMPARE(item.points(), expected);
+
+    // 拖动控制点只移动它自己
+    item.beginHandleDrag(first + 8, expected[8]);
+    item.dragHandle(QPointF(400, 200));
+    item.endHandleDrag();
+    expected[8] = QPointF(400, 200);
+    QCOMPARE(item.points(), expected);
+    QVERIFY(item.boundingRect().contains(QPointF(400, 200)));
+
+    // 控制点索引随之更新
+    QCOMPARE(item.handleAt(QPointF(400, 200)), first + 8);
+    QCOMPARE(item.handleAt(expected[3]), first + 3);
+    QVERIFY(item.handleAt(points[3]) != first + 3);
+}
+
+PROTOSHOP_TEST_MAIN(CurveItemTests)
+
+#include "tst_curveitem.moc"
@@ -0,0 +1,113 @@
+// 后台分批载入：可见区域优先加入，载入结束后堆叠顺序与文档一致；读取出错时的结果
+#include "testutil.h"
+#include <QEventLoop>
+#include <QTemporaryDir>
+#include "canvasscene.h"
+#include "documentio.h"
+#include "documentloader.h"
+#include "scenegenerator.h"
+
+// 应用中画出的图元 z 值都为 0，堆叠顺序只由加入场景的先后决定
+static QList<ItemState> makeFlatStates(int count)
+{
+    SceneGeneratorOptions opt;
+    opt.setUniformMix(count);
+    opt.extent = 1500;
+    opt.seed = 11;
+    QList<ItemState> states = generateScene(opt);
+    for (ItemState &st : states)
+        st.z = 0;
+    return states;
+}
+
+// 载入到结束，返回 finished() 的结果
+static bool runLoader(DocumentLoader *loader, const QString &fileName, const QRectF &priorityRect)
+{
+    QEventLoop loop;
+    bool result = false;
+    QObject::connect(loader, &DocumentLoader::finished, &loop, [&](bool ok) {
+        result = ok;
+        loop.quit();
+    });
+    if (!loader->start(fileName, priorityRect)) return false;
+    loop.exec();
+    return result;
+}
+
+class DocumentLoaderTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void stackingFollowsDocument_data();
+    void stackingFollowsDocument();
+    void truncatedDocument();
+};
+
+void DocumentLoaderTests::stackingFollowsDocument_data()
+{
+    QTest::addColumn<QString>("suffix");
+    QTest::addColumn<int>("frameBudget");
+    QTest::newRow("json") << QString(".json") << 8;
+    QTest::newRow("json-1ms") << QString(".json") << 1;
+    QTest::newRow("psb-1ms") << QString(".psb") << 1;
+}
+
+void DocumentLoaderTests::stackingFollowsDocument()
+{
+    QFETCH(QString, suffix);
+    QFETCH(int, frameBudget);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("doc" + suffix);
+    // 超过一批（1024 个），可见区域内的图元分散在各批中
+    const QList<ItemState> states = makeFlatStates(5000);
+    QVERIFY(writeDocumentStates(fileName, states));
+
+    CanvasScene scene;
+    DocumentLoader loader(&scene);
+    loader.setFrameBudget(frameBudget);
+    QVERIFY(runLoader(&loader, fileName, QRectF(500, 500, 400, 300)));
+    QCOMPARE(loader.addedCount(), int(states.size()));
+
+    // 自下而上的绘制顺序与文档顺序一致，点选用的堆叠序号也一致
+    QList<quint64> ids;
+    quint64 lastOrder = 0;
+    for (QGraphicsItem *item : scene.items(Qt::AscendingOrder)) {
+        ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+        if (!common) continue;
+        ids.append(common->itemId);
+        QVERIFY(common->stackOrder > lastOrder);
+        lastOrder = common->stackOrder;
+    }
+    QList<quint64> expected;
+    for (const ItemState &st : states)
+        expected.append(st.id);
+    QCOMPARE(ids, expected);
+}
+
+void DocumentLoaderTests::truncatedDocument()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("doc.json");
+    QVERIFY(writeDocumentStates(fileName, makeFlatStates(3000)));
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() * 2 / 3));
+    file.close();
+
+    // 出错前已解析的图元留在场景中，数量少于文档
+    CanvasScene scene;
+    DocumentLoader loader(&scene);
+    QVERIFY(!runLoader(&loader, fileName, QRectF()));
+    QVERIFY(!loader.wasCancelled());
+    QVERIFY(loader.addedCount() < 3000);
+
+    DocumentLoader missing(&scene);
+    QVERIFY(!missing.start(dir.filePath("missing.json")));
+}
+
+PROTOSHOP_TEST_MAIN(DocumentLoaderTests)
+
+#include "tst_documentloader.moc"
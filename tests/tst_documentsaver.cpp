@@ -0,0 +1,160 @@
+// 保存与自动保存：保存再载入后堆叠顺序不变；自动保存文件超出磁盘预算时删除旧的
+#include "testutil.h"
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QUndoStack>
+#include "canvasscene.h"
+#include "documentio.h"
+#include "documentsaver.h"
+#include "transformablerectitem.h"
+#include "undocommands.h"
+
+// 叠在同一处、z 值相同的矩形，自下而上
+static QList<QGraphicsItem*> addStack(CanvasScene *scene, int count)
+{
+    QList<QGraphicsItem*> items;
+    for (int i = 0; i < count; ++i) {
+        auto *item = new TransformableRectItem(QRectF(i, i, 100, 100));
+        ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+        common->itemId = i + 1;
+        scene->addItem(item);
+        items.append(item);
+    }
+    return items;
+}
+
+// 场景自下而上的图元编号
+static QList<quint64> paintOrder(QGraphicsScene *scene)
+{
+    QList<quint64> ids;
+    for (QGraphicsItem *item : scene->items(Qt::AscendingOrder))
+        if (ItemCommon *common = dynamic_cast<ItemCommon*>(item))
+            ids.append(common->itemId);
+    return ids;
+}
+
+// 按文档顺序重新建立场景，与打开文档相同
+static bool reload(const QString &fileName, QGraphicsScene *scene)
+{
+    QList<ItemState> states;
+    if (!readDocumentStates(fileName, &states)) return false;
+    for (const ItemState &st : std::as_const(states))
+        if (QGraphicsItem *item = createItem(st))
+            scene->addItem(item);
+    return true;
+}
+
+class DocumentSaverTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void reloadKeepsStacking_data();
+    void reloadKeepsStacking();
+    void backgroundSaveKeepsStacking();
+    void autosaveDiskBudget();
+};
+
+void DocumentSaverTests::reloadKeepsStacking_data()
+{
+    QTest::addColumn<QString>("suffix");
+    QTest::newRow("json") << QString(".json");
+    QTest::newRow("psb") << QString(".psb");
+    QTest::newRow("psbz") << QString(".psbz");
+}
+
+void DocumentSaverTests::reloadKeepsStacking()
+{
+    QFETCH(QString, suffix);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("doc" + suffix);
+
+    CanvasScene scene;
+    addStack(&scene, 6);
+    const QList<quint64> expected = paintOrder(&scene);
+    QCOMPARE(expected, (QList<quint64>{1, 2, 3, 4, 5, 6}));
+
+    // 连续两次保存再载入，堆叠顺序都不变（顺序写反时第二次才会恢复原样）
+    QVERIFY(writeDocument(fileName, &scene));
+    CanvasScene first;
+    QVERIFY(reload(fileName, &first));
+    QCOMPARE(paintOrder(&first), expected);
+
+    QVERIFY(writeDocument(fileName, &first));
+    CanvasScene second;
+    QVERIFY(reload(fileName, &second));
+    QCOMPARE(paintOrder(&second), expected);
+}
+
+void DocumentSaverTests::backgroundSaveKeepsStacking()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("doc.psbz");
+
+    CanvasScene scene;
+    addStack(&scene, 5);
+    const QList<ItemState> states = DocumentSaver::snapshot(&scene);
+    QCOMPARE(states.size(), 5);
+    for (int i = 0; i < states.size(); ++i)
+        QCOMPARE(states[i].id, quint64(i + 1));
+
+    DocumentSaver saver;
+    QSignalSpy saved(&saver, &DocumentSaver::saved);
+    saver.save(fileName, states);
+    QVERIFY(saved.wait());
+    QCOMPARE(saved.first().at(1).toBool(), true);
+    QVERIFY(!saver.isBusy());
+
+    CanvasScene reloaded;
+    QVERIFY(reload(fileName, &reloaded));
+    QCOMPARE(paintOrder(&reloaded), paintOrder(&scene));
+}
+
+void DocumentSaverTests::autosaveDiskBudget()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    CanvasScene scene;
+    addStack(&scene, 50);
+    QUndoStack undoStack;
+    Autosaver autosaver(&undoStack);
+    autosaver.setScene(&scene);
+    autosaver.setDirectory(dir.path());
+    // 预算小于一份文件：每次自动保存后只留下最新的一份
+    autosaver.setDiskBudget(1);
+    QSignalSpy autosaved(&autosaver, &Autosaver::autosaved);
+
+    // 没有改动时不保存
+    autosaver.autosaveNow();
+    QVERIFY(!autosaved.wait(200));
+    QVERIFY(autosaver.autosaveFiles().isEmpty());
+
+    QString last;
+    for (int i = 0; i < 3; ++i) {
+        QGraphicsItem *item = scene.items(Qt::AscendingOrder).first();
+        undoStack.push(new MoveItemsCommand({{item, item->pos(), item->pos() + QPointF(1, 0)}}));
+        autosaver.autosaveNow();
+        QVERIFY(autosaved.wait());
+        QCOMPARE(autosaved.last().at(1).toBool(), true);
+        last = autosaved.last().at(0).toString();
+        // 文件名精确到毫秒，保证下一份的时间戳更新
+        QTest::qWait(5);
+    }
+    QCOMPARE(autosaver.autosaveFiles(), QStringList{last});
+
+    // 预算足够时保留全部
+    autosaver.setDiskBudget(Autosaver::DEFAULT_DISK_BUDGET);
+    QGraphicsItem *item = scene.items(Qt::AscendingOrder).first();
+    undoStack.push(new MoveItemsCommand({{item, item->pos(), item->pos() + QPointF(1, 0)}}));
+    autosaver.autosaveNow();
+    QVERIFY(autosaved.wait());
+    const QStringList files = autosaver.autosaveFiles();
+    QCOMPARE(files.size(), 2);
+    QCOMPARE(files.last(), last);
+}
+
+PROTOSHOP_TEST_MAIN(DocumentSaverTests)
+
+#include "tst_documentsaver.moc"
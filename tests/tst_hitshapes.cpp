@@ -0,0 +1,267 @@
+// 命中测试：线段 BVH 的查询与逐条线段比较的结果一致；线段、多边形、任意画笔的点选和框选
+// 与描边轮廓 shape() 一致（离轮廓边界很近的点受展平误差影响，不比较）
+#include "testutil.h"
+#include <QRandomGenerator>
+#include <QtMath>
+#include <limits>
+#include "segmentbvh.h"
+#include "transformablelineitem.h"
+#include "transformablepathitem.h"
+#include "transformablepolygonitem.h"
+
+// 离 shape() 边界这么近的点不比较
+static const qreal BOUNDARY_BAND = 0.5;
+
+static QList<QLineF> segmentsOf(const QList<QPolygonF> &polylines, bool closed)
+{
+    QList<QLineF> segments;
+    for (const QPolygonF &poly : polylines) {
+        for (int i = 1; i < poly.size(); ++i)
+            segments.append(QLineF(poly[i - 1], poly[i]));
+        if (closed && poly.size() > 2 && poly.first() != poly.last())
+            segments.append(QLineF(poly.last(), poly.first()));
+    }
+    return segments;
+}
+
+static qreal bruteDistance(const QList<QLineF> &segments, const QPointF &p)
+{
+    qreal best = std::numeric_limits<qreal>::infinity();
+    for (const QLineF &l : segments)
+        best = qMin(best, pointSegmentDistance(p, l));
+    return best;
+}
+
+static bool bruteNearPolygon(const QList<QLineF> &segments, const QPolygonF &area, qreal radius)
+{
+    for (const QLineF &l : segments)
+        if (segmentNearPolygon(l, area, radius))
+            return true;
+    return false;
+}
+
+static QPolygonF makeWalk(int count, QRandomGenerator &rng, const QPointF &start)
+{
+    QPolygonF points;
+    QPointF p = start;
+    for (int i = 0; i < count; ++i) {
+        p += QPointF(rng.bounded(8.0) - 4, rng.bounded(8.0) - 4);
+        points << p;
+    }
+    return points;
+}
+
+// 绕原点一圈、半径随机的简单多边形
+static QPolygonF makeStarPolygon(int count, QRandomGenerator &rng)
+{
+    QPolygonF poly;
+    for (int i = 0; i < count; ++i) {
+        const qreal a = 2 * M_PI * i / count;
+        poly << rng.bounded(40.0, 100.0) * QPointF(qCos(a), qSin(a));
+    }
+    return poly;
+}
+
+// 包围盒容纳描边轮廓（圆头线帽的贝塞尔近似可能略微外凸）
+static bool coversShape(const QRectF &bounds, const QPainterPath &shape)
+{
+    return bounds.adjusted(-0.01, -0.01, 0.01, 0.01).contains(shape.boundingRect());
+}
+
+// 以 center 为中心的小框选矩形
+static QPolygonF makeBand(const QPointF &center, QRandomGenerator &rng)
+{
+    const QRectF r(center, QSizeF(rng.bounded(0.5, 12.0), rng.bounded(0.5, 12.0)));
+    return QPolygonF(r.translated(-r.width() / 2, -r.height() / 2));
+}
+
+class HitShapesTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void bvhMatchesBruteForce_data();
+    void bvhMatchesBruteForce();
+    void bvhContainsPoint();
+    void pathItemMatchesShape();
+    void lineItemMatchesShape();
+    void polygonItemMatchesShape();
+};
+
+void HitShapesTests::bvhMatchesBruteForce_data()
+{
+    QTest::addColumn<int>("polylines");
+    QTest::addColumn<int>("points");
+    QTest::addColumn<bool>("closed");
+    QTest::newRow("one segment") << 1 << 2 << false;
+    QTest::newRow("under fanout") << 1 << 7 << false;
+    QTest::newRow("long stroke") << 1 << 5000 << false;
+    QTest::newRow("subpaths") << 5 << 300 << false;
+    QTest::newRow("closed") << 3 << 200 << true;
+}
+
+void HitShapesTests::bvhMatchesBruteForce()
+{
+    QFETCH(int, polylines);
+    QFETCH(int, points);
+    QFETCH(bool, closed);
+    QRandomGenerator rng(quint32(polylines * 10000 + points));
+    QList<QPolygonF> source;
+    for (int i = 0; i < polylines; ++i)
+        source.append(makeWalk(points, rng, QPointF(i * 30, 0)));
+    const QList<QLineF> segments = segmentsOf(source, closed);
+    SegmentBvh bvh;
+    QVERIFY(bvh.isEmpty());
+    bvh.build(source, closed);
+    QVERIFY(!bvh.isEmpty());
+
+    const QRectF range = QPolygonF(source.first()).boundingRect().adjusted(-20, -20, 200, 20);
+    for (int q = 0; q < 500; ++q) {
+        const QPointF pos(rng.bounded(range.left(), range.right()), rng.bounded(range.top(), range.bottom()));
+        const qreal radius = rng.bounded(0.1, 6.0);
+        QCOMPARE(bvh.nearPoint(pos, radius), bruteDistance(segments, pos) <= radius);
+
+        const QPolygonF area = makeBand(pos, rng);
+        QCOMPARE(bvh.nearPolygon(area, radius), bruteNearPolygon(segments, area, radius));
+    }
+    // 线段的端点和中点总能命中
+    for (const QLineF &l : segments) {
+        QVERIFY(bvh.nearPoint(l.p1(), 0));
+        QVERIFY(bvh.nearPoint(l.center(), 1e-9));
+    }
+    QVERIFY(!bvh.nearPolygon(QPolygonF(), 10));
+}
+
+void HitShapesTests::bvhContainsPoint()
+{
+    // 自相交的多边形：两种填充规则的结果不同
+    QRandomGenerator rng(5);
+    QPolygonF poly;
+    for (int i = 0; i < 500; ++i) {
+        const qreal a = 2 * M_PI * i * 7 / 500;
+        poly << rng.bounded(40.0, 100.0) * QPointF(qCos(a), qSin(a));
+    }
+    SegmentBvh bvh;
+    bvh.build({poly}, true);
+    int differ = 0;
+    for (int q = 0; q < 2000; ++q) {
+        const QPointF pos(rng.bounded(-110.0, 110.0), rng.bounded(-110.0, 110.0));
+        const bool oddEven = bvh.containsPoint(pos, Qt::OddEvenFill);
+        const bool winding = bvh.containsPoint(pos, Qt::WindingFill);
+        QCOMPARE(oddEven, poly.containsPoint(pos, Qt::OddEvenFill));
+        QCOMPARE(winding, poly.containsPoint(pos, Qt::WindingFill));
+        if (oddEven != winding) ++differ;
+    }
+    QVERIFY(differ > 0);
+}
+
+void HitShapesTests::pathItemMatchesShape()
+{
+    // 折线和曲线混合、两条子路径；圆头线帽和圆角连接的描边轮廓正好是到路径距离不超过半宽的区域
+    QRandomGenerator rng(23);
+    const QPolygonF walk = makeWalk(400, rng, QPointF());
+    QPainterPath path(walk.first());
+    for (int i = 1; i < walk.size(); ++i)
+        path.lineTo(walk[i]);
+    path.moveTo(0, 80);
+    path.cubicTo(QPointF(40, 20), QPointF(80, 140), QPointF(120, 80));
+    path.quadTo(QPointF(150, 40), QPointF(180, 90));
+
+    TransformablePathItem item(path);
+    const QPen pen(Qt::black, 6, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+    item.setPen(pen);
+    const qreal radius = ItemCommon::hitRadius(pen.widthF());
+    const QList<QLineF> segments = segmentsOf(path.toSubpathPolygons(), false);
+    const QPainterPath shape = item.shape();
+    QVERIFY(coversShape(item.boundingRect(), shape));
+
+    const QRectF range = item.boundingRect();
+    int hits = 0;
+    for (int q = 0; q < 3000; ++q) {
+        const QPointF pos(rng.bounded(range.left(), range.right()), rng.bounded(range.top(), range.bottom()));
+        const qreal dist = bruteDistance(segments, pos);
+        QCOMPARE(item.contains(pos), dist <= radius);
+        if (qAbs(dist - radius) > BOUNDARY_BAND)
+            QCOMPARE(shape.contains(pos), dist <= radius);
+        if (dist <= radius) ++hits;
+
+        const QPolygonF area = makeBand(pos, rng);
+        QPainterPath band;
+        band.addPolygon(area);
+        band.closeSubpath();
+        QCOMPARE(item.collidesWithPath(band), bruteNearPolygon(segments, area, radius));
+    }
+    QVERIFY(hits > 0);
+
+    // 线宽变化后命中范围随之变化
+    item.setPen(QPen(Qt::black, 30, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+    QVERIFY(item.contains(walk[200] + QPointF(12, 0)));
+    QVERIFY(item.shape().contains(walk[200] + QPointF(12, 0)));
+}
+
+void HitShapesTests::lineItemMatchesShape()
+{
+    const QLineF line(10, 20, 150, -40);
+    TransformableLineItem item(line);
+    const QPen pen(Qt::black, 9, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+    item.setPen(pen);
+    const qreal radius = ItemCommon::hitRadius(pen.widthF());
+    const QPainterPath shape = item.shape();
+    QVERIFY(coversShape(item.boundingRect(), shape));
+
+    QRandomGenerator rng(31);
+    const QRectF range = item.boundingRect();
+    for (int q = 0; q < 2000; ++q) {
+        const QPointF pos(rng.bounded(range.left(), range.right()), rng.bounded(range.top(), range.bottom()));
+        const qreal dist = pointSegmentDistance(pos, line);
+        QCOMPARE(item.contains(pos), dist <= radius);
+        if (qAbs(dist - radius) > BOUNDARY_BAND)
+            QCOMPARE(shape.contains(pos), dist <= radius);
+
+        const QPolygonF area = makeBand(pos, rng);
+        QPainterPath band;
+        band.addPolygon(area);
+        band.closeSubpath();
+        QCOMPARE(item.collidesWithPath(band), segmentNearPolygon(line, area, radius));
+    }
+}
+
+void HitShapesTests::polygonItemMatchesShape()
+{
+    QRandomGenerator rng(37);
+    const QPolygonF poly = makeStarPolygon(300, rng);
+    TransformablePolygonItem item(poly);
+    const QPen pen(Qt::black, 4, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+    item.setPen(pen);
+    const qreal radius = ItemCommon::hitRadius(pen.widthF());
+    const QList<QLineF> segments = segmentsOf({poly}, true);
+    const QPainterPath shape = item.shape();
+    QVERIFY(coversShape(item.boundingRect(), shape));
+
+    const QRectF range = item.boundingRect();
+    int inside = 0;
+    for (int q = 0; q < 3000; ++q) {
+        const QPointF pos(rng.bounded(range.left(), range.right()), rng.bounded(range.top(), range.bottom()));
+        const qreal dist = bruteDistance(segments, pos);
+        const bool interior = poly.containsPoint(pos, item.fillRule());
+        const bool expected = dist <= radius || interior;
+        QCOMPARE(item.contains(pos), expected);
+        // 内侧的描边与填充区域在轮廓中重叠，只比较多边形外的描边和远离边的内部
+        if (qAbs(dist - radius) > BOUNDARY_BAND && (!interior || dist > radius))
+            QCOMPARE(shape.contains(pos), expected);
+        if (dist > radius && interior) ++inside;
+    }
+    QVERIFY(inside > 0);
+
+    // 框选区域整个落在多边形内部时也算选中
+    QPainterPath band;
+    band.addRect(QRectF(-5, -5, 10, 10));
+    QVERIFY(item.collidesWithPath(band));
+    QPainterPath outside;
+    outside.addRect(QRectF(200, 200, 10, 10));
+    QVERIFY(!item.collidesWithPath(outside));
+}
+
+PROTOSHOP_TEST_MAIN(HitShapesTests)
+
+#include "tst_hitshapes.moc"
@@ -0,0 +1,114 @@
+// JSON 流式读写：按图元对象切分（字符串中的括号、跨读取块、格式错误），读写往返坐标不损失精度
+#include "testutil.h"
+#include <QBuffer>
+#include <QJsonDocument>
+#include "common.h"
+#include "itemstate.h"
+#include "jsonstream.h"
+
+class JsonStreamTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void jsonReaderSplitsItems();
+    void jsonReaderAcrossChunks();
+    void jsonReaderErrors_data();
+    void jsonReaderErrors();
+    void jsonRoundTrip();
+};
+
+void JsonStreamTests::jsonReaderSplitsItems()
+{
+    // 字符串中的括号、转义引号，嵌套数组和对象，以及顶层数组中的非对象值
+    const QByteArray doc =
+        "\xEF\xBB\xBF \n[ {\"s\":\"}]{[\\\"\",\"n\":[1,{\"a\":[2,{}]}]} ,\n"
+        "  42, \"skip {\", [ {\"inner\":true} ],\n"
+        "{\"t\":\"\\\\\"}, {} ]  ";
+    QBuffer buffer;
+    buffer.setData(doc);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    JsonItemReader reader(&buffer);
+
+    QJsonObject obj;
+    QVERIFY(reader.next(&obj));
+    QCOMPARE(obj["s"].toString(), QString("}]{[\""));
+    QCOMPARE(obj["n"].toArray()[1].toObject()["a"].toArray()[0].toInt(), 2);
+    QVERIFY(reader.next(&obj));
+    QCOMPARE(obj["t"].toString(), QString("\\"));
+    QVERIFY(reader.next(&obj));
+    QVERIFY(obj.isEmpty());
+    QVERIFY(!reader.next(&obj));
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+}
+
+void JsonStreamTests::jsonReaderAcrossChunks()
+{
+    // 写出的文档远大于读取的块大小，对象会跨块边界
+    QList<QJsonObject> objects;
+    QBuffer buffer;
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    JsonItemWriter writer(&buffer);
+    QVERIFY(writer.begin());
+    for (int i = 0; i < 3000; ++i) {
+        QJsonObject obj{{"i", i}, {"text", QString(i % 97, QChar('{'))}, {"quote", "\"]"}};
+        objects.append(obj);
+        QVERIFY(writer.write(obj));
+    }
+    QVERIFY(writer.end());
+    buffer.close();
+    QVERIFY(buffer.size() > 128 * 1024);
+
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    JsonItemReader reader(&buffer);
+    QJsonObject obj;
+    int count = 0;
+    while (reader.next(&obj)) {
+        QVERIFY(count < objects.size());
+        QCOMPARE(obj, objects[count]);
+        ++count;
+    }
+    QVERIFY2(!reader.hasError(), qPrintable(reader.errorString()));
+    QCOMPARE(count, objects.size());
+}
+
+void JsonStreamTests::jsonReaderErrors_data()
+{
+    QTest::addColumn<QByteArray>("doc");
+    QTest::addColumn<int>("items");
+    QTest::newRow("empty") << QByteArray() << 0;
+    QTest::newRow("object") << QByteArray("{\"a\":1}") << 0;
+    QTest::newRow("truncated") << QByteArray("[{\"a\":1},{\"b\":") << 1;
+    QTest::newRow("unterminated") << QByteArray("[{\"a\":1}") << 1;
+    QTest::newRow("bad object") << QByteArray("[{\"a\":1},{\"b\" 2}]") << 1;
+}
+
+void JsonStreamTests::jsonReaderErrors()
+{
+    QFETCH(QByteArray, doc);
+    QFETCH(int, items);
+    QBuffer buffer;
+    buffer.setData(doc);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    JsonItemReader reader(&buffer);
+    QJsonObject obj;
+    int count = 0;
+    while (reader.next(&obj))
+        ++count;
+    QCOMPARE(count, items);
+    QVERIFY(reader.hasError());
+}
+
+void JsonStreamTests::jsonRoundTrip()
+{
+    // 经过文本再读回，坐标不损失精度
+    for (const ItemState &st : makeDocumentStates()) {
+        const QByteArray text = QJsonDocument(itemStateToJson(st)).toJson(QJsonDocument::Compact);
+        const ItemState back = jsonToItemState(QJsonDocument::fromJson(text).object());
+        QCOMPARE(back, st);
+    }
+}
+
+PROTOSHOP_TEST_MAIN(JsonStreamTests)
+
+#include "tst_jsonstream.moc"
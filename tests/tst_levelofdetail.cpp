@@ -0,0 +1,120 @@
+// 层次细节：缩放比例对应的层级，各层抽稀后的折线与原始几何的偏差在屏幕上不超过半个像素
+#include "testutil.h"
+#include <QRandomGenerator>
+#include <cmath>
+#include <limits>
+#include "levelofdetail.h"
+#include "segmentbvh.h"
+
+// 随机游走的折线，步长在一个场景单位左右，抽稀时每层都会去掉不少点
+static QPolygonF makeWalk(int count, quint32 seed, const QPointF &start = QPointF())
+{
+    QRandomGenerator rng(seed);
+    QPolygonF points;
+    QPointF p = start;
+    for (int i = 0; i < count; ++i) {
+        p += QPointF(rng.bounded(2.0) - 0.5, rng.bounded(2.0) - 1.0);
+        points << p;
+    }
+    return points;
+}
+
+// 点到折线的距离
+static qreal polylineDistance(const QPolygonF &poly, const QPointF &p)
+{
+    if (poly.size() == 1) return QLineF(poly.first(), p).length();
+    qreal best = std::numeric_limits<qreal>::infinity();
+    for (int i = 1; i < poly.size(); ++i)
+        best = qMin(best, pointSegmentDistance(p, QLineF(poly[i - 1], poly[i])));
+    return best;
+}
+
+// 原始折线上每个点到抽稀结果的最大距离
+static qreal maxDeviation(const QPolygonF &source, const QPolygonF &level)
+{
+    qreal worst = 0;
+    for (const QPointF &p : source)
+        worst = qMax(worst, polylineDistance(level, p));
+    return worst;
+}
+
+class LevelOfDetailTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void levelForZoom();
+    void polygonLevels();
+    void pathLevels();
+};
+
+void LevelOfDetailTests::levelForZoom()
+{
+    // 原比例和放大时按原几何绘制，缩小到 (2^-(k+1), 2^-k] 时用第 k 层
+    QCOMPARE(LodPyramid::levelFor(1), -1);
+    QCOMPARE(LodPyramid::levelFor(4), -1);
+    QCOMPARE(LodPyramid::levelFor(0), -1);
+    QCOMPARE(LodPyramid::levelFor(0.99), 0);
+    QCOMPARE(LodPyramid::levelFor(0.5), 1);
+    QCOMPARE(LodPyramid::levelFor(0.3), 1);
+    QCOMPARE(LodPyramid::levelFor(0.25), 2);
+    QCOMPARE(LodPyramid::levelFor(1e-6), LodPyramid::LEVELS - 1);
+
+    // 各层累积的偏差乘以该层对应的最大缩放比例，不超过半个像素
+    for (int k = 0; k < LodPyramid::LEVELS; ++k) {
+        const qreal accumulated = 0.25 * ((1 << (k + 1)) - 1);
+        const qreal maxLod = k == 0 ? std::nextafter(qreal(1), qreal(0)) : qreal(1) / (1 << k);
+        QCOMPARE(LodPyramid::levelFor(maxLod), k);
+        QVERIFY(accumulated * maxLod < 0.5);
+    }
+}
+
+void LevelOfDetailTests::polygonLevels()
+{
+    const QPolygonF source = makeWalk(5000, 17);
+    LodPyramid lod;
+    // 跳着取层级：中间的层按需生成
+    for (int k : {2, 0, 1, 5, LodPyramid::LEVELS - 1, 3}) {
+        const QPolygonF &level = lod.polygonLevel(source, k);
+        QCOMPARE(level.first(), source.first());
+        QCOMPARE(level.last(), source.last());
+        const qreal deviation = maxDeviation(source, level);
+        QVERIFY2(deviation < 0.5 * (1 << k),
+                 qPrintable(QString("level %1 deviation %2").arg(k).arg(deviation)));
+    }
+    QVERIFY(lod.polygonLevel(source, 0).size() < source.size());
+
+    // 层级越高点越少
+    for (int k = 1; k < LodPyramid::LEVELS; ++k)
+        QVERIFY(lod.polygonLevel(source, k).size() <= lod.polygonLevel(source, k - 1).size());
+}
+
+void LevelOfDetailTests::pathLevels()
+{
+    // 多条子路径，其中一段是曲线
+    QPainterPath path;
+    for (int s = 0; s < 3; ++s) {
+        const QPolygonF walk = makeWalk(800, 100 + s, QPointF(0, s * 200));
+        path.moveTo(walk.first());
+        for (int i = 1; i < walk.size(); ++i)
+            path.lineTo(walk[i]);
+    }
+    path.moveTo(0, 700);
+    path.cubicTo(QPointF(100, 600), QPointF(300, 900), QPointF(400, 700));
+    const QList<QPolygonF> source = path.toSubpathPolygons();
+
+    LodPyramid lod;
+    for (int k = 0; k < LodPyramid::LEVELS; ++k) {
+        const QList<QPolygonF> &level = lod.pathLevel(path, k);
+        QCOMPARE(level.size(), source.size());
+        for (int s = 0; s < source.size(); ++s) {
+            const qreal deviation = maxDeviation(source[s], level[s]);
+            QVERIFY2(deviation < 0.5 * (1 << k),
+                     qPrintable(QString("level %1 subpath %2 deviation %3").arg(k).arg(s).arg(deviation)));
+        }
+    }
+}
+
+PROTOSHOP_TEST_MAIN(LevelOfDetailTests)
+
+#include "tst_levelofdetail.moc"
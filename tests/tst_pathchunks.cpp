@@ -0,0 +1,129 @@
+// 长笔画分段描边：只画与重绘区域相交的段，结果与整条描边一致（半透明、宽画笔、多条子路径）
+#include "testutil.h"
+#include <QImage>
+#include <QPainter>
+#include <QRandomGenerator>
+#include "pathchunks.h"
+
+// 随机游走的长笔画，夹杂三次曲线，中途另起一条子路径，自身多次交叠
+static QPainterPath makePath()
+{
+    QRandomGenerator rng(7);
+    QPainterPath path(QPointF(200, 200));
+    QPointF p(200, 200);
+    for (int i = 0; i < 3000; ++i) {
+        const QPointF step(rng.bounded(12.0) - 6, rng.bounded(12.0) - 6);
+        const QPointF next(qBound(10.0, p.x() + step.x(), 390.0), qBound(10.0, p.y() + step.y(), 390.0));
+        if (i == 1500) {
+            path.moveTo(next);
+        } else if (i % 7 == 0) {
+            path.cubicTo(p + QPointF(step.y(), step.x()), next - QPointF(step.y(), -step.x()), next);
+        } else {
+            path.lineTo(next);
+        }
+        p = next;
+    }
+    return path;
+}
+
+static QImage blank()
+{
+    QImage img(400, 400, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::white);
+    return img;
+}
+
+static int maxDifference(const QImage &a, const QImage &b, const QRect &area)
+{
+    int worst = 0;
+    for (int y = area.top(); y <= area.bottom(); ++y) {
+        for (int x = area.left(); x <= area.right(); ++x) {
+            const QRgb pa = a.pixel(x, y), pb = b.pixel(x, y);
+            worst = qMax(worst, qAbs(qRed(pa) - qRed(pb)));
+            worst = qMax(worst, qAbs(qGreen(pa) - qGreen(pb)));
+            worst = qMax(worst, qAbs(qBlue(pa) - qBlue(pb)));
+        }
+    }
+    return worst;
+}
+
+class PathChunksTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void chunksCoverPath();
+    void matchesWholeStroke_data();
+    void matchesWholeStroke();
+    void dashedPensDrawWhole();
+};
+
+void PathChunksTests::chunksCoverPath()
+{
+    const QPainterPath path = makePath();
+    PathChunks chunks;
+    chunks.build(path);
+    QVERIFY(chunks.size() > path.elementCount() / PathChunks::CHUNK_ELEMENTS);
+
+    // 区域包含整条路径时每段都画
+    QImage img = blank();
+    QPainter painter(&img);
+    QCOMPARE(chunks.draw(&painter, path, path.controlPointRect(), 0), chunks.size());
+    // 区域在路径以外时一段都不画
+    QCOMPARE(chunks.draw(&painter, path, QRectF(1000, 1000, 10, 10), 5), 0);
+}
+
+void PathChunksTests::matchesWholeStroke_data()
+{
+    QTest::addColumn<QColor>("color");
+    QTest::addColumn<qreal>("width");
+    QTest::addColumn<QRect>("exposed");
+    QTest::newRow("opaque thin, all") << QColor(Qt::black) << qreal(1) << QRect(0, 0, 400, 400);
+    QTest::newRow("translucent wide, all") << QColor(200, 0, 0, 100) << qreal(14) << QRect(0, 0, 400, 400);
+    QTest::newRow("translucent wide, part") << QColor(0, 0, 200, 90) << qreal(10) << QRect(130, 150, 90, 70);
+    QTest::newRow("opaque wide, strip") << QColor(Qt::darkGreen) << qreal(25) << QRect(0, 190, 400, 12);
+}
+
+void PathChunksTests::matchesWholeStroke()
+{
+    QFETCH(QColor, color);
+    QFETCH(qreal, width);
+    QFETCH(QRect, exposed);
+    const QPainterPath path = makePath();
+    QPen pen(color, width);
+    pen.setJoinStyle(Qt::MiterJoin);
+    QVERIFY(PathChunks::canDraw(pen));
+
+    // 与图元绘制时相同：按重绘区域裁剪
+    QImage whole = blank();
+    {
+        QPainter painter(&whole);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setClipRect(exposed);
+        painter.setPen(pen);
+        painter.drawPath(path);
+    }
+    QImage chunked = blank();
+    PathChunks chunks;
+    chunks.build(path);
+    {
+        QPainter painter(&chunked);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setClipRect(exposed);
+        painter.setPen(pen);
+        chunks.draw(&painter, path, exposed, width * qMax<qreal>(1, pen.miterLimit()) / 2 + 1);
+    }
+    const int diff = maxDifference(whole, chunked, exposed);
+    QVERIFY2(diff <= 2, qPrintable(QString("max channel difference %1").arg(diff)));
+}
+
+void PathChunksTests::dashedPensDrawWhole()
+{
+    QVERIFY(!PathChunks::canDraw(QPen(Qt::black, 1, Qt::DashLine)));
+    QVERIFY(!PathChunks::canDraw(QPen(Qt::black, 3, Qt::DotLine)));
+    QVERIFY(PathChunks::canDraw(QPen(QColor(0, 0, 0, 10), 40)));
+}
+
+PROTOSHOP_TEST_MAIN(PathChunksTests)
+
+#include "tst_pathchunks.moc"
@@ -0,0 +1,57 @@
+// .psb / .psbz 二进制文档：读写往返一致，随机读取与顺序读取一致，截断的文件读取失败
+#include "testutil.h"
+#include <QTemporaryDir>
+#include "psbformat.h"
+
+class PsbFormatTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void psbRoundTrip_data();
+    void psbRoundTrip();
+};
+
+void PsbFormatTests::psbRoundTrip_data()
+{
+    QTest::addColumn<QString>("suffix");
+    QTest::newRow("psb") << QString(".psb");
+    QTest::newRow("psbz") << QString(".psbz");
+}
+
+void PsbFormatTests::psbRoundTrip()
+{
+    QFETCH(QString, suffix);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("doc" + suffix);
+
+    const QList<ItemState> states = makeDocumentStates();
+    QVERIFY(writePsb(fileName, states));
+    QCOMPARE(isCompressedPsb(fileName), suffix == ".psbz");
+
+    QList<ItemState> back;
+    QVERIFY(readPsb(fileName, &back));
+    QCOMPARE(back.size(), states.size());
+    for (int i = 0; i < states.size(); ++i)
+        QCOMPARE(back[i], states[i]);
+
+    // 随机读取与顺序读取一致
+    PsbReader reader;
+    QVERIFY(reader.open(fileName));
+    QCOMPARE(reader.itemCount(), int(states.size()));
+    QCOMPARE(reader.itemState(int(states.size()) - 1), states.last());
+    QCOMPARE(reader.itemState(0), states.first());
+    reader.close();
+
+    // 截断的文件打开失败
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() / 2));
+    file.close();
+    QVERIFY(!readPsb(fileName, &back));
+}
+
+PROTOSHOP_TEST_MAIN(PsbFormatTests)
+
+#include "tst_psbformat.moc"
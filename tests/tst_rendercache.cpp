@@ -0,0 +1,153 @@
+// 图元绘制缓存：只缓存开销大的图元，总量不超出预算，超出时淘汰最久未绘制的缓存
+#include "testutil.h"
+#include <QtMath>
+#include "rendercache.h"
+#include "transformablepolygonitem.h"
+#include "transformablerectitem.h"
+
+// 以 center 为中心、顶点数为 vertices 的正多边形，大小相同的多边形缓存大小也相同
+static TransformablePolygonItem *makePolygon(int vertices, const QPointF &center)
+{
+    QPolygonF poly;
+    for (int i = 0; i < vertices; ++i) {
+        const qreal a = 2 * M_PI * i / vertices;
+        poly << center + 50 * QPointF(qCos(a), qSin(a));
+    }
+    return new TransformablePolygonItem(poly);
+}
+
+static bool isCached(QGraphicsItem *item)
+{
+    return item->cacheMode() == QGraphicsItem::DeviceCoordinateCache;
+}
+
+class RenderCacheTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void expensiveItems();
+    void budgetAndEviction();
+    void viewScale();
+};
+
+void RenderCacheTests::expensiveItems()
+{
+    std::unique_ptr<TransformablePolygonItem> small(makePolygon(RenderCache::MIN_POLYGON_VERTICES - 1, QPointF()));
+    std::unique_ptr<TransformablePolygonItem> large(makePolygon(RenderCache::MIN_POLYGON_VERTICES, QPointF()));
+    QVERIFY(!RenderCache::isExpensive(small.get()));
+    QVERIFY(RenderCache::isExpensive(large.get()));
+
+    // 宽的虚线画笔无论形状都值得缓存
+    TransformableRectItem rect(QRectF(0, 0, 10, 10));
+    QVERIFY(!RenderCache::isExpensive(&rect));
+    rect.penStyle = Qt::DashLine;
+    rect.penWidth = RenderCache::MIN_DASHED_PEN_WIDTH;
+    QVERIFY(RenderCache::isExpensive(&rect));
+
+    // 不值得缓存的图元不占预算
+    RenderCache cache;
+    cache.itemChanged(small.get());
+    QVERIFY(cache.isEmpty());
+    QVERIFY(!isCached(small.get()));
+    cache.itemChanged(large.get());
+    QCOMPARE(cache.cachedCount(), 1);
+    QVERIFY(isCached(large.get()));
+    cache.itemRemoved(large.get());
+    QVERIFY(cache.isEmpty());
+    QCOMPARE(cache.usedBytes(), qint64(0));
+    QVERIFY(!isCached(large.get()));
+}
+
+void RenderCacheTests::budgetAndEviction()
+{
+    std::unique_ptr<TransformablePolygonItem> a(makePolygon(100, QPointF(0, 0)));
+    std::unique_ptr<TransformablePolygonItem> b(makePolygon(100, QPointF(200, 0)));
+    std::unique_ptr<TransformablePolygonItem> c(makePolygon(100, QPointF(400, 0)));
+
+    // 先量出一个缓存的大小，预算定为两个半
+    RenderCache cache;
+    cache.itemChanged(a.get());
+    const qint64 bytes = cache.usedBytes();
+    QVERIFY(bytes > 0);
+    cache.itemRemoved(a.get());
+    cache.setBudget(bytes * 5 / 2);
+
+    cache.itemChanged(a.get());
+    cache.itemChanged(b.get());
+    cache.itemChanged(c.get());
+    QCOMPARE(cache.cachedCount(), 2);
+    QCOMPARE(cache.usedBytes(), 2 * bytes);
+    QVERIFY(isCached(a.get()) && isCached(b.get()) && !isCached(c.get()));
+
+    // c 刚绘制过：换下最久未绘制的 a
+    QVERIFY(cache.touch({c.get()}));
+    cache.rebalance();
+    QVERIFY(!isCached(a.get()) && isCached(b.get()) && isCached(c.get()));
+    QVERIFY(cache.usedBytes() <= cache.budget());
+
+    // 同一次绘制到 a 和 b：两者都留下，换下 c
+    QVERIFY(cache.touch({a.get(), b.get()}));
+    cache.rebalance();
+    QVERIFY(isCached(a.get()) && isCached(b.get()) && !isCached(c.get()));
+
+    // 这次画到的都已缓存，不需要重新分配
+    QVERIFY(!cache.touch({a.get(), b.get()}));
+
+    // 预算缩小时立即淘汰，最近绘制的留下
+    QVERIFY(!cache.touch({b.get()}));
+    cache.rebalance();
+    cache.setBudget(bytes);
+    QCOMPARE(cache.cachedCount(), 1);
+    QVERIFY(isCached(b.get()));
+    QCOMPARE(cache.usedBytes(), bytes);
+
+    // 离开场景立即释放，预算空出来给下一个
+    cache.itemRemoved(b.get());
+    QCOMPARE(cache.usedBytes(), qint64(0));
+    QVERIFY(!isCached(b.get()));
+    cache.rebalance();
+    QCOMPARE(cache.cachedCount(), 1);
+    QVERIFY(cache.usedBytes() <= cache.budget());
+
+    // 正在析构的图元只清除记录
+    cache.itemRemoved(a.get(), true);
+    cache.itemRemoved(c.get(), true);
+    QVERIFY(cache.isEmpty());
+    QCOMPARE(cache.usedBytes(), qint64(0));
+    QCOMPARE(cache.cachedCount(), 0);
+}
+
+void RenderCacheTests::viewScale()
+{
+    QList<TransformablePolygonItem*> items;
+    for (int i = 0; i < 10; ++i)
+        items.append(makePolygon(100, QPointF(i * 200, 0)));
+
+    RenderCache cache;
+    cache.itemChanged(items.first());
+    const qint64 bytes = cache.usedBytes();
+    cache.itemRemoved(items.first());
+    cache.setBudget(bytes * 10);
+    for (TransformablePolygonItem *item : std::as_const(items))
+        cache.itemChanged(item);
+    QCOMPARE(cache.cachedCount(), 10);
+
+    // 放大后每个缓存变大，超出预算的部分被淘汰
+    cache.setViewScale(4, QSizeF());
+    QVERIFY(cache.cachedCount() < 10);
+    QVERIFY(cache.usedBytes() <= cache.budget());
+
+    // 缓存最多只有视口大小
+    cache.setViewScale(4, QSizeF(64, 64));
+    QCOMPARE(cache.cachedCount(), 10);
+    QCOMPARE(cache.usedBytes(), qint64(10) * 64 * 64 * 4);
+
+    for (TransformablePolygonItem *item : std::as_const(items))
+        cache.itemRemoved(item, true);
+    qDeleteAll(items);
+}
+
+PROTOSHOP_TEST_MAIN(RenderCacheTests)
+
+#include "tst_rendercache.moc"
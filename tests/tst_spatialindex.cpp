@@ -0,0 +1,229 @@
+// 空间索引：R 树的增删改与查询，CanvasScene 的点选与堆叠顺序
+#include "testutil.h"
+#include <QRandomGenerator>
+#include <QtMath>
+#include <algorithm>
+#include <limits>
+#include "canvasscene.h"
+#include "rtree.h"
+#include "selectionoverlay.h"
+#include "transformablerectitem.h"
+
+static QRectF randomRect(QRandomGenerator &rng)
+{
+    // 包括宽或高为 0 的矩形（水平、竖直线段的包围盒）
+    const qreal w = rng.bounded(4) == 0 ? 0 : rng.bounded(50.0);
+    const qreal h = rng.bounded(4) == 1 ? 0 : rng.bounded(50.0);
+    return QRectF(rng.bounded(1000.0), rng.bounded(1000.0), w, h);
+}
+
+// 与 RTree 相同的相交判断：包含边界
+static bool touches(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right()
+        && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+static qreal rectDistance(const QRectF &r, const QPointF &p)
+{
+    const qreal dx = qMax(qMax(r.left() - p.x(), p.x() - r.right()), qreal(0));
+    const qreal dy = qMax(qMax(r.top() - p.y(), p.y() - r.bottom()), qreal(0));
+    return qSqrt(dx * dx + dy * dy);
+}
+
+static QList<int> sorted(QList<int> values)
+{
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+class SpatialIndexTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rtreeQueries_data();
+    void rtreeQueries();
+    void rtreeNearest();
+    void stackingOrder();
+    void handleStackingOrder();
+};
+
+void SpatialIndexTests::rtreeQueries_data()
+{
+    QTest::addColumn<bool>("bulk");
+    QTest::newRow("insert") << false;
+    QTest::newRow("bulkLoad") << true;
+}
+
+void SpatialIndexTests::rtreeQueries()
+{
+    QFETCH(bool, bulk);
+    QRandomGenerator rng(3);
+    QHash<int, QRectF> rects;
+    for (int i = 0; i < 2000; ++i)
+        rects.insert(i, randomRect(rng));
+
+    RTree<int> tree;
+    if (bulk) {
+        QList<QPair<int, QRectF>> entries;
+        for (auto it = rects.cbegin(); it != rects.cend(); ++it)
+            entries.append({it.key(), it.value()});
+        tree.bulkLoad(entries);
+    } else {
+        for (auto it = rects.cbegin(); it != rects.cend(); ++it)
+            tree.insert(it.key(), it.value());
+    }
+
+    // QRectF::united() 会忽略宽高都为 0 的矩形，这里逐个取极值
+    auto unionOf = [&rects] {
+        qreal left = std::numeric_limits<qreal>::max(), top = left;
+        qreal right = std::numeric_limits<qreal>::lowest(), bottom = right;
+        for (const QRectF &r : std::as_const(rects)) {
+            left = qMin(left, r.left());     top = qMin(top, r.top());
+            right = qMax(right, r.right());  bottom = qMax(bottom, r.bottom());
+        }
+        return QRectF(QPointF(left, top), QPointF(right, bottom));
+    };
+    QCOMPARE(tree.bounds(), unionOf());
+
+    // 删除、移动一部分，再插入新值，覆盖结点合并与重新插入
+    for (int i = 0; i < 2000; i += 3) {
+        QVERIFY(tree.remove(i));
+        rects.remove(i);
+    }
+    QVERIFY(!tree.remove(0));
+    for (int i = 1; i < 2000; i += 5) {
+        rects[i] = randomRect(rng);
+        tree.update(i, rects[i]);
+    }
+    for (int i = 2000; i < 2500; ++i) {
+        rects.insert(i, randomRect(rng));
+        tree.update(i, rects[i]);
+    }
+    QCOMPARE(tree.size(), rects.size());
+
+    // 原地更新不收缩结点矩形，之后的外包矩形只保证覆盖所有值
+    const QRectF all = unionOf();
+    const QRectF bounds = tree.bounds();
+    QVERIFY(bounds.left() <= all.left() && bounds.top() <= all.top()
+            && bounds.right() >= all.right() && bounds.bottom() >= all.bottom());
+
+    for (int q = 0; q < 200; ++q) {
+        const QRectF query = randomRect(rng);
+        QList<int> expected;
+        for (auto it = rects.cbegin(); it != rects.cend(); ++it)
+            if (touches(it.value(), query))
+                expected.append(it.key());
+        QCOMPARE(sorted(tree.intersecting(query)), sorted(expected));
+
+        const QPointF point = query.topLeft();
+        expected.clear();
+        for (auto it = rects.cbegin(); it != rects.cend(); ++it)
+            if (touches(it.value(), QRectF(point, point)))
+                expected.append(it.key());
+        QCOMPARE(sorted(tree.containing(point)), sorted(expected));
+    }
+
+    tree.clear();
+    QVERIFY(tree.isEmpty());
+    QVERIFY(tree.intersecting(all).isEmpty());
+}
+
+void SpatialIndexTests::rtreeNearest()
+{
+    QRandomGenerator rng(5);
+    QHash<int, QRectF> rects;
+    RTree<int> tree;
+    for (int i = 0; i < 1000; ++i) {
+        rects.insert(i, randomRect(rng));
+        tree.insert(i, rects[i]);
+    }
+
+    for (int q = 0; q < 100; ++q) {
+        const QPointF point(rng.bounded(1200.0) - 100, rng.bounded(1200.0) - 100);
+        QList<qreal> all;
+        for (const QRectF &r : std::as_const(rects))
+            all.append(rectDistance(r, point));
+        std::sort(all.begin(), all.end());
+
+        // 距离相同的值次序不定，只比较距离
+        const QList<int> found = tree.nearest(point, 8);
+        QCOMPARE(found.size(), 8);
+        for (int k = 0; k < found.size(); ++k)
+            QCOMPARE(rectDistance(rects.value(found[k]), point), all[k]);
+
+        const qreal maxDistance = 20;
+        const QList<int> within = tree.nearest(point, int(rects.size()), maxDistance);
+        const int expected = int(std::upper_bound(all.begin(), all.end(), maxDistance) - all.begin());
+        QCOMPARE(within.size(), expected);
+    }
+}
+
+void SpatialIndexTests::stackingOrder()
+{
+    // 同一位置叠放的矩形，z 值都为 0，ID 故意与加入顺序相反（与重新载入后的文档相同）
+    CanvasScene scene;
+    QList<TransformableRectItem*> items;
+    for (int i = 0; i < 6; ++i) {
+        auto *item = new TransformableRectItem(QRectF(i, i, 100, 100));
+        item->itemId = 100 - i;
+        scene.addItem(item);
+        items.append(item);
+    }
+    // 撤销删除时重新加入场景的图元回到最上面
+    scene.removeItem(items[1]);
+    scene.addItem(items[1]);
+    items[4]->setZValue(-1);
+
+    auto expectedAt = [&scene](const QPointF &pos) {
+        QList<QGraphicsItem*> result;
+        for (QGraphicsItem *item : scene.items(pos, Qt::IntersectsItemShape, Qt::DescendingOrder))
+            if (dynamic_cast<ItemCommon*>(item))
+                result.append(item);
+        return result;
+    };
+    const QPointF pos(50, 50);
+    const QList<QGraphicsItem*> expected = expectedAt(pos);
+    QCOMPARE(expected.size(), items.size());
+    QCOMPARE(expected.first(), static_cast<QGraphicsItem*>(items[1]));
+    QCOMPARE(expected.last(), static_cast<QGraphicsItem*>(items[4]));
+    QCOMPARE(scene.indexedItemsAt(pos), expected);
+
+    // 批量载入后整体重建索引，顺序不变
+    scene.beginBulkLoad();
+    auto *late = new TransformableRectItem(QRectF(20, 20, 100, 100));
+    late->itemId = 1;
+    scene.addItem(late);
+    scene.endBulkLoad();
+    QCOMPARE(scene.indexedItemsAt(pos).first(), static_cast<QGraphicsItem*>(late));
+    QCOMPARE(scene.indexedItemsAt(pos), expectedAt(pos));
+}
+
+void SpatialIndexTests::handleStackingOrder()
+{
+    // 两个选中的矩形共用左上角，控制点重叠时取 Qt 点选时会选中的那个
+    CanvasScene scene;
+    auto *lower = new TransformableRectItem(QRectF(0, 0, 100, 100));
+    auto *upper = new TransformableRectItem(QRectF(0, 0, 50, 50));
+    lower->itemId = 2;
+    upper->itemId = 1;
+    scene.addItem(lower);
+    scene.addItem(upper);
+    lower->setSelected(true);
+    upper->setSelected(true);
+
+    int handle = 0;
+    QCOMPARE(scene.selectionOverlay()->handleItemAt(QPointF(0, 0), &handle),
+             static_cast<QGraphicsItem*>(upper));
+    QVERIFY(handle != 0);
+
+    scene.removeItem(lower);
+    scene.addItem(lower);
+    lower->setSelected(true);
+    QCOMPARE(scene.selectionOverlay()->handleItemAt(QPointF(0, 0)), static_cast<QGraphicsItem*>(lower));
+}
+
+PROTOSHOP_TEST_MAIN(SpatialIndexTests)
+
+#include "tst_spatialindex.moc"
@@ -0,0 +1,144 @@
+// 笔画拟合：简化与平滑后的曲线与原始采样点的偏差不超过容差，带 CurveTo 的路径序列化后不变
+#include "testutil.h"
+#include <QJsonDocument>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <limits>
+#include "common.h"
+#include "itemstate.h"
+#include "strokefitting.h"
+
+// 随机游走的笔画采样点
+static QPolygonF makeStroke(int count, quint32 seed)
+{
+    QRandomGenerator rng(seed);
+    QPolygonF points;
+    QPointF p(0, 0);
+    for (int i = 0; i < count; ++i) {
+        p += QPointF(rng.bounded(4.0) - 1.0, rng.bounded(4.0) - 2.0);
+        points << p;
+    }
+    return points;
+}
+
+// 点到路径的距离：曲线按 Wang 公式展平成与曲线偏差不超过 FLATTEN_ERROR 的折线
+static const qreal FLATTEN_ERROR = 0.01;
+
+static qreal pathDistance(const QPainterPath &path, const QPointF &p)
+{
+    auto segmentDistance = [&p](const QPointF &a, const QPointF &b) {
+        const QPointF ab = b - a;
+        const qreal len2 = QPointF::dotProduct(ab, ab);
+        const qreal t = len2 > 0 ? qBound(qreal(0), QPointF::dotProduct(p - a, ab) / len2, qreal(1)) : 0;
+        const QPointF d = a + t * ab - p;
+        return qSqrt(QPointF::dotProduct(d, d));
+    };
+
+    qreal best = std::numeric_limits<qreal>::infinity();
+    QPointF last;
+    for (int i = 0; i < path.elementCount(); ++i) {
+        const QPainterPath::Element e = path.elementAt(i);
+        if (e.isMoveTo()) {
+            last = e;
+            best = qMin(best, QLineF(last, p).length());
+        } else if (e.isLineTo()) {
+            best = qMin(best, segmentDistance(last, e));
+            last = e;
+        } else if (e.isCurveTo() && i + 2 < path.elementCount()) {
+            const QPointF c1 = e, c2 = path.elementAt(i + 1), end = path.elementAt(i + 2);
+            const QPointF d1 = last - 2 * c1 + c2, d2 = c1 - 2 * c2 + end;
+            const qreal m = qSqrt(qMax(QPointF::dotProduct(d1, d1), QPointF::dotProduct(d2, d2)));
+            const int steps = qMax(1, qCeil(qSqrt(0.75 * m / FLATTEN_ERROR)));
+            QPointF prev = last;
+            for (int k = 1; k <= steps; ++k) {
+                const qreal t = qreal(k) / steps, mt = 1 - t;
+                const QPointF q = mt * mt * mt * last + 3 * mt * mt * t * c1 + 3 * mt * t * t * c2 + t * t * t * end;
+                best = qMin(best, segmentDistance(prev, q));
+                prev = q;
+            }
+            last = end;
+            i += 2;
+        }
+    }
+    return best;
+}
+
+class StrokeFittingTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void curveToRoundTrip();
+    void strokeFitting_data();
+    void strokeFitting();
+};
+
+void StrokeFittingTests::curveToRoundTrip()
+{
+    ItemState st;
+    st.type = "TransformablePathItem";
+    st.id = 7;
+    QPainterPath path(QPointF(0.5, 0.25));
+    path.cubicTo(QPointF(10.125, 20), QPointF(30, 40.75), QPointF(50, 0.1));
+    path.lineTo(60, 10);
+    path.cubicTo(QPointF(70, 20), QPointF(80, -20), QPointF(90.3, 0));
+    st.geometry.path = path;
+
+    const QJsonObject obj = itemStateToJson(st);
+    const QByteArray text = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    const ItemState back = jsonToItemState(QJsonDocument::fromJson(text).object());
+    const QPainterPath &p = back.geometry.path;
+    QCOMPARE(p.elementCount(), path.elementCount());
+    for (int i = 0; i < path.elementCount(); ++i) {
+        QCOMPARE(int(p.elementAt(i).type), int(path.elementAt(i).type));
+        QCOMPARE(QPointF(p.elementAt(i)), QPointF(path.elementAt(i)));
+    }
+    QCOMPARE(back, st);
+
+    // 经过图元再取回状态也不变
+    QGraphicsItem *item = createItem(back);
+    QVERIFY(item);
+    QCOMPARE(captureItemState(item).geometry, st.geometry);
+    delete item;
+}
+
+void StrokeFittingTests::strokeFitting_data()
+{
+    QTest::addColumn<int>("points");
+    QTest::addColumn<qreal>("tolerance");
+    QTest::newRow("short") << 5 << qreal(1);
+    QTest::newRow("1k") << 1000 << qreal(1);
+    QTest::newRow("1k-fine") << 1000 << qreal(0.25);
+    QTest::newRow("10k") << 10000 << qreal(2);
+}
+
+void StrokeFittingTests::strokeFitting()
+{
+    QFETCH(int, points);
+    QFETCH(qreal, tolerance);
+    const QPolygonF stroke = makeStroke(points, quint32(points));
+
+    const QPolygonF simplified = simplifyPolyline(stroke, tolerance);
+    QCOMPARE(simplified.first(), stroke.first());
+    QCOMPARE(simplified.last(), stroke.last());
+    QVERIFY(simplified.size() <= stroke.size());
+
+    const QPainterPath path = smoothStroke(stroke, tolerance);
+    QCOMPARE(path.elementAt(0).x, stroke.first().x());
+    QCOMPARE(path.elementAt(0).y, stroke.first().y());
+    QCOMPARE(path.currentPosition(), stroke.last());
+    // 拟合时曲线按 tolerance 的 1/10 展平后量误差，这里留出同样的余量，再加上本身展平的误差
+    qreal worst = 0;
+    for (const QPointF &p : stroke)
+        worst = qMax(worst, pathDistance(path, p));
+    QVERIFY2(worst <= tolerance * 1.1 + FLATTEN_ERROR,
+             qPrintable(QString("max deviation %1 > %2").arg(worst).arg(tolerance)));
+
+    // tolerance <= 0 时按原始折线返回
+    const QPainterPath raw = smoothStroke(stroke, 0);
+    QCOMPARE(raw.elementCount(), int(stroke.size()));
+}
+
+PROTOSHOP_TEST_MAIN(StrokeFittingTests)
+
+#include "tst_strokefitting.moc"
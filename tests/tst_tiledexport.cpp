@@ -0,0 +1,161 @@
+// 分块导出 PNG：写出的文件能被 QImage 读回，与整图一次绘制的结果一致（条带接缝处不丢线帽）
+#include "testutil.h"
+#include <QImage>
+#include <QPainter>
+#include <QTemporaryDir>
+#include "tiledexport.h"
+
+// 宽线段的方头线帽斜着伸出包围盒，线段端点落在条带接缝附近
+static QList<ItemState> makeStates()
+{
+    QList<ItemState> states;
+    quint64 id = 1;
+    for (int i = 0; i < 12; ++i) {
+        ItemState st;
+        st.type = "TransformableLineItem";
+        st.id = id++;
+        const qreal y = 10 + i * 23.5;
+        st.geometry.line = QLineF(QPointF(20 + i * 7, y), QPointF(60 + i * 7, y + 40));
+        st.style.penColor = QColor::fromHsv(i * 30, 255, 200);
+        st.style.penWidth = 4 + i * 2;
+        states.append(st);
+    }
+    ItemState rect;
+    rect.type = "TransformableRectItem";
+    rect.id = id++;
+    rect.pos = QPointF(100, 120);
+    rect.rotation = 30;
+    rect.origin = QPointF(40, 25);
+    rect.geometry.rect = QRectF(0, 0, 80, 50);
+    rect.style.penColor = QColor(0, 0, 0, 160);
+    rect.style.brushColor = QColor(255, 200, 0, 128);
+    rect.style.penWidth = 9;
+    states.append(rect);
+    return states;
+}
+
+// 不分块、不经过编码器的参考图
+static QImage renderReference(const QList<ItemState> &states, const ExportOptions &o)
+{
+    QImage img(exportImageSize(o), QImage::Format_ARGB32_Premultiplied);
+    img.fill(o.background);
+    QPainter painter(&img);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.scale(o.scale, o.scale);
+    painter.translate(-o.source.topLeft());
+    for (const ItemState &st : states)
+        paintItemState(&painter, st);
+    return img;
+}
+
+static int maxChannelDifference(const QImage &a, const QImage &b)
+{
+    int worst = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const QRgb *pa = reinterpret_cast<const QRgb*>(a.constScanLine(y));
+        const QRgb *pb = reinterpret_cast<const QRgb*>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); ++x) {
+            worst = qMax(worst, qAbs(qRed(pa[x]) - qRed(pb[x])));
+            worst = qMax(worst, qAbs(qGreen(pa[x]) - qGreen(pb[x])));
+            worst = qMax(worst, qAbs(qBlue(pa[x]) - qBlue(pb[x])));
+            worst = qMax(worst, qAbs(qAlpha(pa[x]) - qAlpha(pb[x])));
+        }
+    }
+    return worst;
+}
+
+class TiledExportTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void pngRoundTrip_data();
+    void pngRoundTrip();
+    void drawingBoundsCoverStrokes();
+    void cancelledExport();
+};
+
+void TiledExportTests::pngRoundTrip_data()
+{
+    QTest::addColumn<qreal>("scale");
+    QTest::addColumn<int>("tileRows");
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<QColor>("background");
+    QTest::newRow("one band") << qreal(1) << 4096 << 1 << QColor(Qt::white);
+    QTest::newRow("7-row bands") << qreal(1) << 7 << 4 << QColor(Qt::white);
+    QTest::newRow("1-row bands") << qreal(1) << 1 << 2 << QColor(Qt::white);
+    QTest::newRow("scale 2.5") << qreal(2.5) << 13 << 3 << QColor(Qt::white);
+    QTest::newRow("scale 0.3") << qreal(0.3) << 3 << 2 << QColor(Qt::white);
+    QTest::newRow("transparent") << qreal(1) << 9 << 2 << QColor(Qt::transparent);
+}
+
+void TiledExportTests::pngRoundTrip()
+{
+    QFETCH(qreal, scale);
+    QFETCH(int, tileRows);
+    QFETCH(int, threads);
+    QFETCH(QColor, background);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("out.png");
+
+    const QList<ItemState> states = makeStates();
+    ExportOptions o;
+    o.source = QRectF(3.25, 1.5, 260, 330);
+    o.scale = scale;
+    o.maxTileRows = tileRows;
+    o.threads = threads;
+    o.background = background;
+    o.dpi = 150;
+    QVERIFY(exportTiledPng(fileName, states, o));
+
+    // 由 Qt 的 PNG 解码器读回：文件头、各 IDAT 块和 zlib 校验和都必须正确
+    QImage back(fileName, "PNG");
+    QVERIFY(!back.isNull());
+    QCOMPARE(back.size(), exportImageSize(o));
+    QCOMPARE(back.dotsPerMeterX(), qRound(o.dpi / 0.0254));
+    back = back.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QImage reference = renderReference(states, o);
+    // 透明背景经过 PNG 的非预乘存储，边缘的半透明像素可能差一两级
+    const int diff = maxChannelDifference(back, reference);
+    QVERIFY2(diff <= 2, qPrintable(QString("max channel difference %1").arg(diff)));
+}
+
+void TiledExportTests::drawingBoundsCoverStrokes()
+{
+    // 导出所有图元的包围盒时，图片最外一圈像素应当是背景：线帽和抗锯齿的像素都在图片内
+    const QList<ItemState> states = makeStates();
+    ExportOptions o;
+    o.source = itemStatesBounds(states);
+    o.background = Qt::white;
+    const QImage img = renderReference(states, o);
+    auto nearlyWhite = [&img](int x, int y) {
+        const QRgb c = img.pixel(x, y);
+        return qMin(qRed(c), qMin(qGreen(c), qBlue(c))) >= 250;
+    };
+    for (int x = 0; x < img.width(); ++x) {
+        QVERIFY2(nearlyWhite(x, 0), qPrintable(QString("top edge at x=%1").arg(x)));
+        QVERIFY2(nearlyWhite(x, img.height() - 1), qPrintable(QString("bottom edge at x=%1").arg(x)));
+    }
+    for (int y = 0; y < img.height(); ++y) {
+        QVERIFY2(nearlyWhite(0, y), qPrintable(QString("left edge at y=%1").arg(y)));
+        QVERIFY2(nearlyWhite(img.width() - 1, y), qPrintable(QString("right edge at y=%1").arg(y)));
+    }
+}
+
+void TiledExportTests::cancelledExport()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath("cancelled.png");
+    ExportOptions o;
+    o.source = QRectF(0, 0, 300, 300);
+    o.maxTileRows = 4;
+    const std::atomic<bool> cancel{true};
+    QVERIFY(!exportTiledPng(fileName, makeStates(), o, {}, &cancel));
+    QVERIFY(!QFile::exists(fileName));
+}
+
+PROTOSHOP_TEST_MAIN(TiledExportTests)
+
+#include "tst_tiledexport.moc"
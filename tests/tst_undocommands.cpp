@@ -0,0 +1,131 @@
+// 撤销重做命令：删除、添加、移动图元，撤销删除后堆叠顺序不变
+#include "testutil.h"
+#include <QUndoStack>
+#include "canvasscene.h"
+#include "transformablerectitem.h"
+#include "undocommands.h"
+
+// 叠在同一处的矩形，自下而上
+static QList<QGraphicsItem*> addStack(CanvasScene *scene, int count)
+{
+    QList<QGraphicsItem*> items;
+    for (int i = 0; i < count; ++i) {
+        auto *item = new TransformableRectItem(QRectF(i, i, 100, 100));
+        scene->addItem(item);
+        items.append(item);
+    }
+    return items;
+}
+
+// pos 处 Qt 绘制的堆叠顺序，自下而上
+static QList<QGraphicsItem*> paintOrderAt(CanvasScene *scene, const QPointF &pos)
+{
+    QList<QGraphicsItem*> result;
+    for (QGraphicsItem *item : scene->items(pos, Qt::IntersectsItemShape, Qt::AscendingOrder))
+        if (dynamic_cast<ItemCommon*>(item))
+            result.append(item);
+    return result;
+}
+
+class UndoCommandsTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void removeRestoresStacking_data();
+    void removeRestoresStacking();
+    void addUndoRedo();
+    void moveUndoRedo();
+};
+
+void UndoCommandsTests::removeRestoresStacking_data()
+{
+    QTest::addColumn<QList<int>>("removed");
+    QTest::newRow("middle") << QList<int>{3};
+    QTest::newRow("bottom") << QList<int>{0};
+    QTest::newRow("top") << QList<int>{7};
+    QTest::newRow("scattered") << QList<int>{6, 1, 4};
+    QTest::newRow("top run") << QList<int>{7, 5, 6};
+    QTest::newRow("all") << QList<int>{0, 1, 2, 3, 4, 5, 6, 7};
+}
+
+void UndoCommandsTests::removeRestoresStacking()
+{
+    QFETCH(QList<int>, removed);
+    CanvasScene scene;
+    const QList<QGraphicsItem*> items = addStack(&scene, 8);
+    const QPointF pos(50, 50);
+    QCOMPARE(paintOrderAt(&scene, pos), items);
+
+    // 删除顺序与堆叠顺序无关（选中图元的顺序不定）
+    QList<QGraphicsItem*> selection;
+    for (int i : removed)
+        selection.append(items[i]);
+    QUndoStack stack;
+    stack.push(new RemoveItemsCommand(&scene, selection));
+    for (QGraphicsItem *item : std::as_const(selection))
+        QVERIFY(!item->scene());
+    QCOMPARE(paintOrderAt(&scene, pos).size(), items.size() - selection.size());
+
+    stack.undo();
+    QCOMPARE(paintOrderAt(&scene, pos), items);
+    QList<QGraphicsItem*> topDown(items.crbegin(), items.crend());
+    QCOMPARE(scene.indexedItemsAt(pos), topDown);
+
+    // 再删除、撤销一次，结果相同；之后新加的图元在最上面
+    stack.redo();
+    stack.undo();
+    QCOMPARE(paintOrderAt(&scene, pos), items);
+    auto *late = new TransformableRectItem(QRectF(0, 0, 100, 100));
+    scene.addItem(late);
+    QCOMPARE(scene.indexedItemsAt(pos).first(), static_cast<QGraphicsItem*>(late));
+    QCOMPARE(paintOrderAt(&scene, pos).last(), static_cast<QGraphicsItem*>(late));
+}
+
+void UndoCommandsTests::addUndoRedo()
+{
+    CanvasScene scene;
+    addStack(&scene, 3);
+    auto *item = new TransformableRectItem(QRectF(0, 0, 10, 10));
+    scene.addItem(item);
+
+    QUndoStack stack;
+    stack.push(new AddItemsCommand(&scene, {item}));
+    QCOMPARE(item->scene(), static_cast<QGraphicsScene*>(&scene));
+    stack.undo();
+    QVERIFY(!item->scene());
+    QVERIFY(!scene.indexedItemsAt(QPointF(5, 5)).contains(item));
+    stack.redo();
+    QCOMPARE(item->scene(), static_cast<QGraphicsScene*>(&scene));
+    QCOMPARE(scene.indexedItemsAt(QPointF(5, 5)).first(), static_cast<QGraphicsItem*>(item));
+}
+
+void UndoCommandsTests::moveUndoRedo()
+{
+    CanvasScene scene;
+    const QList<QGraphicsItem*> items = addStack(&scene, 2);
+    QList<MoveItemsCommand::Entry> entries;
+    for (QGraphicsItem *item : items)
+        entries.append({item, item->pos(), item->pos() + QPointF(500, 0)});
+
+    // 命令入栈时执行 redo()，空间索引随位置更新
+    QUndoStack stack;
+    stack.push(new MoveItemsCommand(entries));
+    for (QGraphicsItem *item : items)
+        QCOMPARE(item->pos(), QPointF(500, 0));
+    QVERIFY(scene.indexedItemsAt(QPointF(50, 50)).isEmpty());
+    QCOMPARE(scene.indexedItemsAt(QPointF(550, 50)).size(), items.size());
+
+    stack.undo();
+    for (QGraphicsItem *item : items)
+        QCOMPARE(item->pos(), QPointF(0, 0));
+    QVERIFY(scene.indexedItemsAt(QPointF(550, 50)).isEmpty());
+    QCOMPARE(scene.indexedItemsAt(QPointF(50, 50)).size(), items.size());
+
+    stack.redo();
+    QCOMPARE(scene.indexedItemsAt(QPointF(550, 50)).size(), items.size());
+}
+
+PROTOSHOP_TEST_MAIN(UndoCommandsTests)
+
+#include "tst_undocommands.moc"
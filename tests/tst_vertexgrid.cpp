@@ -0,0 +1,133 @@
+// 顶点网格索引：最近顶点和区域查询与逐个比较的结果一致，顶点移动后增量更新的索引仍然正确
+#include "testutil.h"
+#include <QRandomGenerator>
+#include <algorithm>
+#include "transformablepolygonitem.h"
+#include "vertexgrid.h"
+
+// 逐个比较：横纵距离都不超过 radius 的顶点中最近的一个，距离相同时取下标小的
+static int bruteNearest(const QPolygonF &points, const QPointF &pos, qreal radius)
+{
+    int best = -1;
+    qreal bestDist = 0;
+    for (int i = 0; i < points.size(); ++i) {
+        const QPointF d = points.at(i) - pos;
+        if (qAbs(d.x()) > radius || qAbs(d.y()) > radius) continue;
+        const qreal dist = QPointF::dotProduct(d, d);
+        if (best < 0 || dist < bestDist) {
+            best = i;
+            bestDist = dist;
+        }
+    }
+    return best;
+}
+
+static QList<int> bruteInRect(const QPolygonF &points, const QRectF &rect)
+{
+    QList<int> result;
+    for (int i = 0; i < points.size(); ++i)
+        if (rect.contains(points.at(i)))
+            result.append(i);
+    return result;
+}
+
+// 顶点落在格点上，不少顶点重合、正好在格子边界上或坐标为负
+static QPolygonF makePoints(int count, QRandomGenerator &rng)
+{
+    QPolygonF points;
+    for (int i = 0; i < count; ++i)
+        points << QPointF(rng.bounded(-100, 100) * 2.5, rng.bounded(-100, 100) * 2.5);
+    return points;
+}
+
+class VertexGridTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesBruteForce_data();
+    void matchesBruteForce();
+    void polygonHandles();
+};
+
+void VertexGridTests::matchesBruteForce_data()
+{
+    QTest::addColumn<qreal>("cellSize");
+    QTest::addColumn<int>("count");
+    QTest::newRow("cell 10") << qreal(10) << 2000;
+    QTest::newRow("cell 1") << qreal(1) << 500;
+    QTest::newRow("cell 100") << qreal(100) << 2000;
+    QTest::newRow("few points") << qreal(10) << 3;
+}
+
+void VertexGridTests::matchesBruteForce()
+{
+    QFETCH(qreal, cellSize);
+    QFETCH(int, count);
+    QRandomGenerator rng(quint32(count));
+    QPolygonF points = makePoints(count, rng);
+    VertexGrid grid(cellSize);
+    grid.build(points);
+
+    auto check = [&] {
+        for (int q = 0; q < 300; ++q) {
+            const QPointF pos(rng.bounded(-300.0, 300.0), rng.bounded(-300.0, 300.0));
+            // 半径从小于格子到远大于整个范围（后者走逐个比较的分支）
+            const qreal radius = q % 10 == 0 ? 1000 : rng.bounded(0.5, 30.0);
+            QCOMPARE(grid.nearest(points, pos, radius), bruteNearest(points, pos, radius));
+
+            const QRectF rect(pos, QSizeF(rng.bounded(0.0, q % 10 == 0 ? 600.0 : 40.0),
+                                          rng.bounded(0.0, 40.0)));
+            QList<int> found = grid.inRect(points, rect);
+            std::sort(found.begin(), found.end());
+            QCOMPARE(found, bruteInRect(points, rect));
+        }
+        // 正好在顶点上
+        for (int i = 0; i < points.size(); i += qMax(1, count / 50)) {
+            const int hit = grid.nearest(points, points[i], 0.1);
+            QVERIFY(hit >= 0);
+            QCOMPARE(points[hit], points[i]);
+            QCOMPARE(hit, bruteNearest(points, points[i], 0.1));
+        }
+    };
+    check();
+    if (QTest::currentTestFailed()) return;
+
+    // 增量移动顶点，包括留在原来的格子里和移到很远的地方
+    for (int m = 0; m < count; ++m) {
+        const int i = rng.bounded(int(points.size()));
+        const QPointF from = points[i];
+        const QPointF to = m % 3 == 0 ? from + QPointF(0.01, 0)
+                                      : QPointF(rng.bounded(-100, 100) * 2.5, rng.bounded(-100, 100) * 2.5);
+        points[i] = to;
+        grid.move(i, from, to);
+    }
+    check();
+}
+
+void VertexGridTests::polygonHandles()
+{
+    // 顶点间距大于控制点，点在第 i 个顶点上就命中第 i 个顶点的控制点
+    QPolygonF poly;
+    for (int i = 0; i < 400; ++i)
+        poly << QPointF((i % 20) * 30, (i / 20) * 30);
+    TransformablePolygonItem item(poly);
+    const int first = item.handleAt(poly[0]);
+    QCOMPARE(item.handleCursor(first), Qt::CrossCursor);
+    for (int i = 0; i < poly.size(); ++i)
+        QCOMPARE(item.handleAt(poly[i] + QPointF(1, -1)), first + i);
+    QCOMPARE(item.handleCursor(item.handleAt(QPointF(15, 15))), Qt::ArrowCursor);
+
+    // 移动顶点后索引随之更新：旧位置不再命中，新位置命中
+    item.moveVertex(7, QPointF(15, 15));
+    item.moveVertex(300, QPointF(1000, 1000));
+    item.settleVertices();
+    QCOMPARE(item.handleAt(QPointF(15, 15)), first + 7);
+    QCOMPARE(item.handleAt(QPointF(1000, 1000)), first + 300);
+    QVERIFY(item.handleAt(poly[300]) != first + 300);
+    QCOMPARE(item.handleCursor(item.handleAt(poly[7])), Qt::ArrowCursor);
+}
+
+PROTOSHOP_TEST_MAIN(VertexGridTests)
+
+#include "tst_vertexgrid.moc"
@@ -0,0 +1,334 @@
+#include "tiledexport.h"
+#include "rtree.h"
+#include <QImage>
+#include <QPainter>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QMap>
+#include <QtMath>
+#include <algorithm>
+#ifdef PROTOSHOP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+QSize exportImageSize(const ExportOptions &o)
+{
+    return QSize(qCeil(o.source.width() * o.scale), qCeil(o.source.height() * o.scale));
+}
+
+QRectF itemStatesBounds(const QList<ItemState> &states)
+{
+    QRectF bounds;
+    for (const ItemState &st : states)
+        bounds |= itemStateBounds(st);
+    return bounds;
+}
+
+namespace {
+
+// 一个条带：图片中 [y, y + height) 这些行
+struct Band {
+    QImage image;           // 退化路径使用
+    QByteArray deflated;    // 压缩后的行数据（raw deflate）
+    quint32 adler = 1;      // 未压缩数据的 adler32
+    qint64 rawLength = 0;
+    bool failed = false;    // 压缩出错
+};
+
+// 对预乘 alpha 的图片按 n×n 块取平均
+QImage downsample(const QImage &src, int n)
+{
+    QImage dst(src.width() / n, src.height() / n, QImage::Format_ARGB32_Premultiplied);
+    const int count = n * n;
+    for (int y = 0; y < dst.height(); ++y) {
+        QRgb *out = reinterpret_cast<QRgb*>(dst.scanLine(y));
+        for (int x = 0; x < dst.width(); ++x) {
+            int a = 0, r = 0, g = 0, b = 0;
+            for (int dy = 0; dy < n; ++dy) {
+                const QRgb *in = reinterpret_cast<const QRgb*>(src.constScanLine(y * n + dy)) + x * n;
+                for (int dx = 0; dx < n; ++dx) {
+                    a += qAlpha(in[dx]); r += qRed(in[dx]);
+                    g += qGreen(in[dx]); b += qBlue(in[dx]);
+                }
+            }
+            const int half = count / 2;
+            out[x] = qRgba((r + half) / count, (g + half) / count, (b + half) / count, (a + half) / count);
+        }
+    }
+    return dst;
+}
+
+QImage renderBand(const QList<ItemState> &states, const RTree<int> &index,
+                  const ExportOptions &o, int width, int y, int height)
+{
+    // 超采样时按 ss 倍尺寸绘制，再缩小回输出尺寸
+    const int ss = qMax(1, o.supersample);
+    QImage img(width * ss, height * ss, QImage::Format_ARGB32_Premultiplied);
+    img.fill(o.background);
+
+    // 条带对应的场景区域，只画与之相交的图元。
+    // 缩小导出时 1 个像素大于 1 个场景单位，按像素再外扩，条带接缝处不丢抗锯齿的边缘
+    const qreal aa = 1 / o.scale;
+    const QRectF area = QRectF(o.source.left(), o.source.top() + y / o.scale,
+                               o.source.width(), height / o.scale).adjusted(-aa, -aa, aa, aa);
+    QList<int> hits = index.intersecting(area);
+    std::sort(hits.begin(), hits.end());
+
+    QPainter painter(&img);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(0, -y * ss);
+    painter.scale(o.scale * ss, o.scale * ss);
+    painter.translate(-o.source.topLeft());
+    for (int i : std::as_const(hits))
+        paintItemState(&painter, states[i]);
+    painter.end();
+    return ss > 1 ? downsample(img, ss) : img;
+}
+
+#ifdef PROTOSHOP_HAVE_ZLIB
+// 把条带做 PNG Sub 行过滤后压缩成一段 raw deflate 数据。
+// 非最后一段以 Z_SYNC_FLUSH 结束（字节对齐、不带结束标志），各段可以直接首尾相接。
+// zlib 出错时返回 false，导出随之失败，不会写出损坏的 PNG
+bool deflateBand(const QImage &argb, bool last, int level, Band *band)
+{
+    const QImage img = argb.convertToFormat(QImage::Format_RGBA8888); // PNG 要求非预乘的 RGBA
+    if (img.isNull()) return false;
+    const int rowBytes = img.width() * 4;
+    QByteArray row(rowBytes + 1, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar*>(row.data());
+
+    z_stream zs = {};
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    band->deflated.resize(qsizetype(deflateBound(&zs, uLong(img.height()) * uLong(rowBytes + 1))) + 64);
+    qsizetype produced = 0;
+
+    // 压缩当前输入；输出缓冲区用完时加倍后继续
+    auto compress = [&](int flush) {
+        for (;;) {
+            zs.next_out = reinterpret_cast<Bytef*>(band->deflated.data() + produced);
+            zs.avail_out = uInt(band->deflated.size() - produced);
+            const int ret = deflate(&zs, flush);
+            produced = band->deflated.size() - qsizetype(zs.avail_out);
+            if (ret != Z_OK && ret != Z_BUF_ERROR && ret != Z_STREAM_END)
+                return false;
+            // Z_BUF_ERROR 只表示这次调用没有可做的事，不是错误
+            if (flush == Z_FINISH ? ret == Z_STREAM_END : zs.avail_in == 0 && zs.avail_out > 0)
+                return true;
+            if (zs.avail_out != 0)
+                return false; // 输出空间还有剩余却没能处理完输入
+            band->deflated.resize(band->deflated.size() * 2);
+        }
+    };
+
+    bool ok = true;
+    uLong adler = adler32(0, nullptr, 0);
+    for (int y = 0; ok && y < img.height(); ++y) {
+        const uchar *src = img.constScanLine(y);
+        out[0] = 1; // Sub 过滤
+        for (int i = 0; i < 4 && i < rowBytes; ++i)
+            out[1 + i] = src[i];
+        for (int i = 4; i < rowBytes; ++i)
+            out[1 + i] = uchar(src[i] - src[i - 4]);
+        adler = adler32(adler, out, uInt(rowBytes + 1));
+
+        zs.next_in = out;
+        zs.avail_in = uInt(rowBytes + 1);
+        const bool finalRow = y == img.height() - 1;
+        ok = compress(finalRow ? (last ? Z_FINISH : Z_SYNC_FLUSH) : Z_NO_FLUSH);
+    }
+    deflateEnd(&zs);
+    if (!ok) {
+        band->deflated.clear();
+        return false;
+    }
+    band->deflated.resize(produced);
+    band->adler = quint32(adler);
+    band->rawLength = qint64(img.height()) * (rowBytes + 1);
+    return true;
+}
+
+void putUInt32(QByteArray *out, quint32 v)
+{
+    const char bytes[4] = {char(v >> 24), char(v >> 16), char(v >> 8), char(v)};
+    out->append(bytes, 4);
+}
+
+bool writeChunk(QIODevice *dev, const char *type, const QByteArray &data)
+{
+    QByteArray chunk;
+    chunk.reserve(data.size() + 12);
+    putUInt32(&chunk, quint32(data.size()));
+    chunk.append(type, 4);
+    chunk.append(data);
+    const quint32 crc = quint32(crc32(crc32(0, nullptr, 0),
+                                      reinterpret_cast<const Bytef*>(chunk.constData() + 4),
+                                      uInt(data.size() + 4)));
+    putUInt32(&chunk, crc);
+    return dev->write(chunk) == chunk.size();
+}
+#endif
+
+} // namespace
+
+bool exportTiledPng(const QString &fileName, const QList<ItemState> &states,
+                    const ExportOptions &o, const std::function<void(int)> &progress,
+                    const std::atomic<bool> *cancel)
+{
+    const QSize size = exportImageSize(o);
+    if (size.isEmpty() || o.scale <= 0) return false;
+    const int width = size.width(), height = size.height();
+
+    RTree<int> index;
+    {
+        QList<QPair<int, QRectF>> entries;
+        entries.reserve(states.size());
+        for (int i = 0; i < states.size(); ++i)
+            entries.append({i, itemStateBounds(states[i])});
+        index.bulkLoad(entries);
+    }
+
+    // 超采样时条带按放大后的像素数计算大小
+    const qint64 ss = qMax(1, o.supersample);
+    const qint64 rowBytes = qint64(width) * 4 * ss * ss;
+    const int bandHeight = int(qBound<qint64>(1, o.tileBytes / rowBytes, qMax(1, o.maxTileRows)));
+    const int bandCount = (height + bandHeight - 1) / bandHeight;
+    const int threads = o.threads > 0 ? o.threads : qMax(1, QThread::idealThreadCount());
+    auto cancelled = [cancel] { return cancel && cancel->load(); };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    // 在途（绘制中或等待写出）的条带数上限，决定了内存峰值
+    QSemaphore inFlight(2 * threads);
+    QMutex mutex;
+    QWaitCondition bandDone;
+    QMap<int, Band> done;
+
+    auto dispatch = [&](int b) {
+        pool.start([&, b] {
+            Band band;
+            if (!cancelled()) {
+                const int y = b * bandHeight;
+                const int h = qMin(bandHeight, height - y);
+                QImage img = renderBand(states, index, o, width, y, h);
+#ifdef PROTOSHOP_HAVE_ZLIB
+                band.failed = !deflateBand(img, b == bandCount - 1, o.compressionLevel, &band);
+#else
+                band.image = std::move(img);
+#endif
+            }
+            QMutexLocker lock(&mutex);
+            done.insert(b, std::move(band));
+            bandDone.wakeAll();
+        });
+    };
+    auto takeBand = [&](int b) {
+        QMutexLocker lock(&mutex);
+        while (!done.contains(b))
+            bandDone.wait(&mutex);
+        return done.take(b);
+    };
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    bool ok = true;
+    int dispatched = 0;
+
+#ifdef PROTOSHOP_HAVE_ZLIB
+    // PNG 文件头与 IHDR：8 位 RGBA，不隔行
+    ok = file.write("\x89PNG\r\n\x1a\n", 8) == 8;
+    QByteArray ihdr;
+    putUInt32(&ihdr, quint32(width));
+    putUInt32(&ihdr, quint32(height));
+    ihdr.append("\x08\x06\x00\x00\x00", 5);
+    ok = ok && writeChunk(&file, "IHDR", ihdr);
+    if (o.dpi > 0) {
+        // pHYs：每米像素数
+        const quint32 ppm = quint32(qRound(o.dpi / 0.0254));
+        QByteArray phys;
+        putUInt32(&phys, ppm);
+        putUInt32(&phys, ppm);
+        phys.append('\x01');
+        ok = ok && writeChunk(&file, "pHYs", phys);
+    }
+
+    // 各条带的 raw deflate 数据拼成一个 zlib 流，分成若干 IDAT 块写出
+    QByteArray idat("\x78\x9c", 2);
+    uLong adler = adler32(0, nullptr, 0);
+    for (int written = 0; ok && written < bandCount; ++written) {
+        while (dispatched < bandCount && inFlight.tryAcquire()) dispatch(dispatched++);
+        const Band band = takeBand(written);
+        inFlight.release();
+        if (cancelled() || band.failed) { ok = false; break; }
+
+        idat.append(band.deflated);
+        adler = adler32_combine(adler, band.adler, z_off_t(band.rawLength));
+        if (written == bandCount - 1)
+            putUInt32(&idat, quint32(adler));
+        if (idat.size() >= 1024 * 1024 || written == bandCount - 1) {
+            ok = writeChunk(&file, "IDAT", idat);
+            idat.clear();
+        }
+        if (progress) progress((written + 1) * 100 / bandCount);
+    }
+    ok = ok && writeChunk(&file, "IEND", QByteArray());
+#else
+    QImage full(width, height, QImage::Format_ARGB32_Premultiplied);
+    if (full.isNull()) ok = false;
+    if (o.dpi > 0) {
+        full.setDotsPerMeterX(qRound(o.dpi / 0.0254));
+        full.setDotsPerMeterY(qRound(o.dpi / 0.0254));
+    }
+    for (int written = 0; ok && written < bandCount; ++written) {
+        while (dispatched < bandCount && inFlight.tryAcquire()) dispatch(dispatched++);
+        const Band band = takeBand(written);
+        inFlight.release();
+        if (cancelled()) { ok = false; break; }
+
+        QPainter painter(&full);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(0, written * bandHeight, band.image);
+        if (progress) progress((written + 1) * 100 / bandCount);
+    }
+    ok = ok && full.save(&file, "PNG");
+#endif
+
+    // 中途退出时等已派发的条带结束，它们引用着本函数的局部变量
+    pool.waitForDone();
+    if (!ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+/* ===== 后台导出 ===== */
+ExportJob::ExportJob(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ExportJob::~ExportJob()
+{
+    if (m_thread) {
+        m_cancel = true;
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+void ExportJob::start(const QString &fileName, const QList<ItemState> &states, const ExportOptions &options)
+{
+    if (m_thread) return;
+    m_cancel = false;
+    m_thread = QThread::create([this, fileName, states, options] {
+        const bool ok = exportTiledPng(fileName, states, options, [this](int percent) {
+            QMetaObject::invokeMethod(this, [this, percent] { emit progress(percent); }, Qt::QueuedConnection);
+        }, &m_cancel);
+        QMetaObject::invokeMethod(this, [this, ok] { emit finished(ok); }, Qt::QueuedConnection);
+    });
+    m_thread->start();
+}
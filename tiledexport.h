@@ -0,0 +1,67 @@
+#ifndef TILEDEXPORT_H
+#define TILEDEXPORT_H
+
+#include <QObject>
+#include <QThread>
+#include <QColor>
+#include <QRectF>
+#include <functional>
+#include <atomic>
+#include "itemstate.h"
+
+// 分块并行导出 PNG，支持任意缩放倍数（或目标 DPI）、任意导出区域和超采样：
+// 图片按整行宽的条带（tile）切分，每个条带在线程池里用自己的 QImage / QPainter 绘制，
+// 只画空间索引查询出的相交图元；条带绘制完后在同一个工作线程里做 PNG 行过滤和 deflate 压缩，
+// 各条带的压缩结果按顺序拼接写入文件。内存占用只与在途的条带数和条带大小有关。
+// 没有 zlib 时退化为整图绘制后用 QImage 保存。
+
+struct ExportOptions {
+    QRectF source;                          // 导出的场景区域
+    qreal scale = 1.0;                      // 像素 / 场景单位
+    qreal dpi = 0;                          // 写入 PNG 的物理分辨率，0 表示不写
+    int supersample = 1;                    // 每个输出像素按 n×n 个子像素绘制后取平均
+    QColor background = Qt::transparent;
+    qint64 tileBytes = 8 * 1024 * 1024;     // 单个条带的像素数据上限
+    int maxTileRows = 256;
+    int threads = 0;                        // <= 0 时使用 QThread::idealThreadCount()
+    int compressionLevel = 6;               // zlib 压缩级别
+};
+
+// 场景单位按 96 DPI 下的 1 像素计，目标 DPI 对应的缩放倍数
+inline qreal scaleForDpi(qreal dpi) { return dpi / 96.0; }
+// 导出图片的像素尺寸
+QSize exportImageSize(const ExportOptions &options);
+// 图元集合在场景中的紧凑包围盒
+QRectF itemStatesBounds(const QList<ItemState> &states);
+// 同步导出。states 按绘制顺序（自下而上）排列；progress 在调用线程上回调（0~100），
+// cancel 不为空且被置为 true 时中止并放弃写入的文件
+bool exportTiledPng(const QString &fileName, const QList<ItemState> &states,
+                    const ExportOptions &options,
+                    const std::function<void(int)> &progress = {},
+                    const std::atomic<bool> *cancel = nullptr);
+
+// 在后台线程上运行 exportTiledPng，供 GUI 使用
+class ExportJob : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ExportJob(QObject *parent = nullptr);
+    ~ExportJob() override; // 会取消并等待导出线程结束
+
+    void start(const QString &fileName, const QList<ItemState> &states, const ExportOptions &options);
+    // 是否由 cancel() 结束（区别于写文件出错）
+    bool wasCancelled() const { return m_cancel; }
+
+public slots:
+    void cancel() { m_cancel = true; }
+
+signals:
+    void progress(int percent);
+    void finished(bool ok);
+
+private:
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_cancel{false};
+};
+
+#endif // TILEDEXPORT_H
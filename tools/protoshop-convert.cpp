@@ -0,0 +1,35 @@
+// protoshop-convert：在 JSON 与 .psb 二进制文档之间互相转换，格式由扩展名决定
+// 用法：protoshop-convert input.json output.psb
+#include "documentio.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("protoshop-convert");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Convert a Protoshop document between .json and .psb.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "Source document (.json or .psb).");
+    parser.addPositionalArgument("output", "Destination document (.json or .psb).");
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 2)
+        parser.showHelp(1);
+
+    QList<ItemState> states;
+    if (!readDocumentStates(args[0], &states)) {
+        err << "cannot read document: " << args[0] << Qt::endl;
+        return 1;
+    }
+    if (!writeDocumentStates(args[1], states)) {
+        err << "cannot write document: " << args[1] << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
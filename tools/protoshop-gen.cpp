@@ -0,0 +1,146 @@
+// protoshop-gen：按种子生成合成测试文档（与 itemToJson 相同的 JSON 格式，扩展名为 .psb 时写二进制格式）
+// 用法：protoshop-gen --count 100000 --distribution clustered --seed 42 out.json
+#include "scenegenerator.h"
+#include "documentio.h"
+#include "jsonstream.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QtMath>
+
+// "a" 或 "a-b" 形式的范围
+static bool parseRange(const QString &text, int *lo, int *hi)
+{
+    const QStringList parts = text.split('-');
+    bool ok1 = false, ok2 = true;
+    *lo = parts[0].toInt(&ok1);
+    *hi = parts.size() > 1 ? parts[1].toInt(&ok2) : *lo;
+    return parts.size() <= 2 && ok1 && ok2 && *lo <= *hi;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("protoshop-gen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generate a deterministic synthetic Protoshop document.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("output", "Destination .json or .psb document, or - for JSON on stdout.");
+
+    QCommandLineOption seedOption("seed", "Random seed (default 1).", "n", "1");
+    QCommandLineOption countOption("count", "Total item count, split evenly across the five types.", "n");
+    QCommandLineOption rectsOption("rects", "Number of rectangles.", "n");
+    QCommandLineOption ellipsesOption("ellipses", "Number of ellipses / circles.", "n");
+    QCommandLineOption linesOption("lines", "Number of lines.", "n");
+    QCommandLineOption polygonsOption("polygons", "Number of polygons.", "n");
+    QCommandLineOption pathsOption("paths", "Number of freehand strokes.", "n");
+    QCommandLineOption verticesOption("polygon-vertices", "Vertices per polygon, n or min-max (default 3-8).",
+                                      "range", "3-8");
+    QCommandLineOption pointsOption("stroke-points", "Points per stroke, n or min-max (default 16-64).",
+                                    "range", "16-64");
+    QCommandLineOption fitOption("fit-strokes", "Curve-fit strokes like the PEN tool does on release.");
+    QCommandLineOption sizeOption("size", "Item size in scene units, n or min-max (default 10-100).",
+                                  "range", "10-100");
+    QCommandLineOption stylesOption("styles", "Number of distinct styles (default 16, 1 = uniform).", "n", "16");
+    QCommandLineOption rotationOption("rotation", "Maximum absolute rotation in degrees (default 0).", "deg", "0");
+    QCommandLineOption distributionOption("distribution", "uniform, clustered or overlapping (default uniform).",
+                                          "mode", "uniform");
+    QCommandLineOption extentOption("extent", "Canvas side length (default: scales with the item count).", "n", "0");
+    QCommandLineOption clustersOption("clusters", "Cluster count for clustered mode (default 8).", "n", "8");
+    QCommandLineOption spreadOption("spread", "Cluster spread in scene units (default 200).", "n", "200");
+    parser.addOptions({seedOption, countOption, rectsOption, ellipsesOption, linesOption, polygonsOption,
+                       pathsOption, verticesOption, pointsOption, fitOption, sizeOption, stylesOption,
+                       rotationOption, distributionOption, extentOption, clustersOption, spreadOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1)
+        parser.showHelp(1);
+
+    // 参数不合法时报告出错的选项并打印用法，退出码为 1
+    auto fail = [&](const QCommandLineOption &option) {
+        err << "invalid --" << option.names().first() << ": " << parser.value(option) << Qt::endl;
+        parser.showHelp(1);
+    };
+    // 不小于 min 的整数
+    auto intValue = [&](const QCommandLineOption &option, int min) {
+        bool ok = false;
+        const int value = parser.value(option).toInt(&ok);
+        if (!ok || value < min) fail(option);
+        return value;
+    };
+    // 不小于 0 的实数
+    auto realValue = [&](const QCommandLineOption &option) {
+        bool ok = false;
+        const qreal value = parser.value(option).toDouble(&ok);
+        if (!ok || !qIsFinite(value) || value < 0) fail(option);
+        return value;
+    };
+
+    SceneGeneratorOptions opt;
+    bool seedOk = false;
+    opt.seed = parser.value(seedOption).toUInt(&seedOk);
+    if (!seedOk) fail(seedOption);
+    opt.setUniformMix(parser.isSet(countOption) ? intValue(countOption, 0) : 100);
+    // 单独指定的类型数量覆盖平均分配的结果
+    if (parser.isSet(rectsOption))    opt.rectCount    = intValue(rectsOption, 0);
+    if (parser.isSet(ellipsesOption)) opt.ellipseCount = intValue(ellipsesOption, 0);
+    if (parser.isSet(linesOption))    opt.lineCount    = intValue(linesOption, 0);
+    if (parser.isSet(polygonsOption)) opt.polygonCount = intValue(polygonsOption, 0);
+    if (parser.isSet(pathsOption))    opt.pathCount    = intValue(pathsOption, 0);
+
+    int lo = 0, hi = 0;
+    if (!parseRange(parser.value(verticesOption), &lo, &hi) || lo < 3)
+        fail(verticesOption);
+    opt.polygonVerticesMin = lo;
+    opt.polygonVerticesMax = hi;
+    if (!parseRange(parser.value(pointsOption), &lo, &hi) || lo < 2)
+        fail(pointsOption);
+    opt.strokePointsMin = lo;
+    opt.strokePointsMax = hi;
+    if (!parseRange(parser.value(sizeOption), &lo, &hi) || lo <= 0)
+        fail(sizeOption);
+    opt.sizeMin = lo;
+    opt.sizeMax = hi;
+    opt.fitStrokes = parser.isSet(fitOption);
+    opt.styleVariety = intValue(stylesOption, 1);
+    opt.maxRotation = realValue(rotationOption);
+    opt.extent = realValue(extentOption);
+    opt.clusterCount = intValue(clustersOption, 1);
+    opt.clusterSpread = realValue(spreadOption);
+
+    const QString mode = parser.value(distributionOption);
+    if (mode == "uniform")
+        opt.distribution = SceneGeneratorOptions::Uniform;
+    else if (mode == "clustered")
+        opt.distribution = SceneGeneratorOptions::Clustered;
+    else if (mode == "overlapping")
+        opt.distribution = SceneGeneratorOptions::Overlapping;
+    else
+        fail(distributionOption);
+
+    const QList<ItemState> states = generateScene(opt);
+    bool ok = false;
+    if (args[0] == "-") {
+        // 写到标准输出时总是 JSON
+        QFile out;
+        if (out.open(stdout, QIODevice::WriteOnly)) {
+            JsonItemWriter writer(&out);
+            ok = writer.begin();
+            for (const ItemState &st : states)
+                if (ok)
+                    ok = writer.write(itemStateToJson(st));
+            ok = ok && writer.end();
+        }
+    } else {
+        ok = writeDocumentStates(args[0], states);
+    }
+    if (!ok) {
+        err << "cannot write document: " << args[0] << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
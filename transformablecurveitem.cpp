@@ -0,0 +1,438 @@
+#include "transformablecurveitem.h"
+#include "canvasscene.h"
+#include "levelofdetail.h"
+#include <QPainter>
+#include <QtMath>
+#include <QGuiApplication>
+#include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
+#include <cmath>
+
+// 单段最多细分的段数，避免极端控制点导致展平结果过大
+static const int MAX_FLATTEN_STEPS = 1024;
+
+// 按 Wang 公式由二阶差分的上界确定均匀细分的段数，使折线与曲线的偏差不超过 tolerance
+static void flattenCubic(const QPointF &p0, const QPointF &p1, const QPointF &p2,
+                         const QPointF &p3, qreal tolerance, QPolygonF *out)
+{
+    const QPointF d1 = p0 - 2 * p1 + p2;
+    const QPointF d2 = p1 - 2 * p2 + p3;
+    const qreal m = qSqrt(qMax(QPointF::dotProduct(d1, d1), QPointF::dotProduct(d2, d2)));
+    const int steps = qBound(1, qCeil(qSqrt(0.75 * m / tolerance)), MAX_FLATTEN_STEPS);
+    out->reserve(steps + 1);
+    out->append(p0);
+    for (int i = 1; i < steps; ++i) {
+        const qreal t = qreal(i) / steps;
+        const qreal mt = 1 - t;
+        out->append(mt * mt * mt * p0 + 3 * mt * mt * t * p1 + 3 * mt * t * t * p2 + t * t * t * p3);
+    }
+    out->append(p3);
+}
+
+TransformableCurveItem::TransformableCurveItem(const QPolygonF &points,
+                                               QGraphicsItem *parent)
+    : QAbstractGraphicsShapeItem(parent)
+{
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable | ItemSendsGeometryChanges);
+    setPoints(points);
+}
+
+TransformableCurveItem::~TransformableCurveItem()
+{
+    CanvasScene::itemDestroyed(this);
+}
+
+QVariant TransformableCurveItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    CanvasScene::itemChanged(this, change);
+    return QAbstractGraphicsShapeItem::itemChange(change, value);
+}
+
+QRectF TransformableCurveItem::tightBoundingRect() const
+{
+    const qreal half = hitPadding(pen().widthF());
+    return m_geom.bounds.adjusted(-half, -half, half, half);
+}
+
+QRectF TransformableCurveItem::boundingRect() const
+{
+    // 控制点由 SelectionOverlay 绘制，包围盒只需容纳图形本身
+    return tightBoundingRect();
+}
+
+QPainterPath TransformableCurveItem::curvePath(const QPolygonF &points)
+{
+    QPainterPath path;
+    if (points.isEmpty()) return path;
+    path.moveTo(points.first());
+    for (int i = 1; i + 2 < points.size(); i += 3)
+        path.cubicTo(points.at(i), points.at(i + 1), points.at(i + 2));
+    return path;
+}
+
+void TransformableCurveItem::setPoints(const QPolygonF &points)
+{
+    prepareGeometryChange();
+    m_points = points;
+    m_geom.bounds = points.boundingRect();
+    m_boundsLoose = false;
+    updateHandleGeometry();
+    m_grid.reset();
+    m_paintFlat.reset(segmentCount());
+    m_hitFlat.reset(segmentCount());
+    m_bvh.reset();
+    m_shapeRadius = -1;
+    update();
+    CanvasScene::itemGeometryChanged(this);
+}
+
+void TransformableCurveItem::Flattening::reset(int segmentCount)
+{
+    segments = QList<QPolygonF>(segmentCount);
+    flat.clear();
+    dirty = true;
+}
+
+void TransformableCurveItem::Flattening::invalidate(int segment)
+{
+    if (segment < 0 || segment >= segments.size()) return;
+    segments[segment].clear();
+    dirty = true;
+}
+
+bool TransformableCurveItem::Flattening::build(const QPolygonF &points, qreal tolerance)
+{
+    if (!dirty) return false;
+    flat.clear();
+    for (int s = 0; s < segments.size(); ++s) {
+        QPolygonF &segment = segments[s];
+        if (segment.isEmpty())
+            flattenCubic(points.at(3 * s), points.at(3 * s + 1), points.at(3 * s + 2),
+                         points.at(3 * s + 3), tolerance, &segment);
+        // 相邻两段共享锚点
+        for (int i = s == 0 ? 0 : 1; i < segment.size(); ++i)
+            flat.append(segment.at(i));
+    }
+    dirty = false;
+    return true;
+}
+
+void TransformableCurveItem::invalidateSegment(int segment)
+{
+    m_paintFlat.invalidate(segment);
+    m_hitFlat.invalidate(segment);
+}
+
+void TransformableCurveItem::movePoint(int index, const QPointF &pos)
+{
+    if (index < 0 || index >= m_points.size()) return;
+    const QPointF old = m_points.at(index);
+    if (old == pos) return;
+
+    // 锚点影响前后两段，控制点只影响所在的一段
+    const int first = index % 3 == 0 ? index / 3 - 1 : index / 3;
+    const int last = index / 3;
+    qreal left = pos.x(), right = pos.x(), top = pos.y(), bottom = pos.y();
+    for (int s = qMax(0, first); s <= qMin(last, segmentCount() - 1); ++s) {
+        for (int i = 3 * s; i <= 3 * s + 3; ++i) {
+            const QPointF &p = m_points.at(i);
+            left = qMin(left, p.x()); right = qMax(right, p.x());
+            top = qMin(top, p.y());   bottom = qMax(bottom, p.y());
+        }
+        invalidateSegment(s);
+    }
+    const qreal pad = pen().widthF() * qMax<qreal>(1, pen().miterLimit()) / 2 + 1;
+    const QRectF dirty = QRectF(QPointF(left, top), QPointF(right, bottom)).adjusted(-pad, -pad, pad, pad);
+
+    const bool grows = pos.x() < m_geom.bounds.left() || pos.x() > m_geom.bounds.right()
+                    || pos.y() < m_geom.bounds.top() || pos.y() > m_geom.bounds.bottom();
+    if (grows) {
+        prepareGeometryChange();
+        m_geom.bounds = QRectF(QPointF(qMin(m_geom.bounds.left(), pos.x()), qMin(m_geom.bounds.top(), pos.y())),
+                               QPointF(qMax(m_geom.bounds.right(), pos.x()), qMax(m_geom.bounds.bottom(), pos.y())));
+        updateHandleGeometry();
+    } else if (old.x() == m_geom.bounds.left() || old.x() == m_geom.bounds.right()
+               || old.y() == m_geom.bounds.top() || old.y() == m_geom.bounds.bottom()) {
+        m_boundsLoose = true;
+    }
+
+    m_points[index] = pos;
+    if (m_grid) m_grid->move(index, old, pos);
+
+    if (grows) {
+        update();
+        CanvasScene::itemGeometryChanged(this);
+    } else {
+        update(dirty);
+        CanvasScene::itemRegionChanged(this, dirty);
+    }
+}
+
+void TransformableCurveItem::settlePoints()
+{
+    if (!m_boundsLoose) return;
+    m_boundsLoose = false;
+    const QRectF exact = m_points.boundingRect();
+    if (exact == m_geom.bounds) return;
+    prepareGeometryChange();
+    m_geom.bounds = exact;
+    updateHandleGeometry();
+    CanvasScene::itemGeometryChanged(this);
+}
+
+int TransformableCurveItem::zoomBucket(qreal lod)
+{
+    if (lod <= 0) return 0;
+    return qBound(MIN_BUCKET, int(std::floor(std::log2(lod))), MAX_BUCKET);
+}
+
+const QPolygonF &TransformableCurveItem::tessellation(int bucket) const
+{
+    if (bucket != m_bucket) {
+        m_bucket = bucket;
+        m_paintFlat.reset(segmentCount());
+    }
+    // 第 k 档在 item 坐标下允许 0.25 / 2^k 的偏差，屏幕上不超过半个像素
+    m_paintFlat.build(m_points, std::ldexp(0.25, -bucket));
+    return m_paintFlat.flat;
+}
+
+const QPolygonF &TransformableCurveItem::hitTessellation() const
+{
+    if (m_hitFlat.build(m_points, HIT_FLATTEN_TOLERANCE)) {
+        m_bvh.reset();
+        m_shapeRadius = -1;
+    }
+    return m_hitFlat.flat;
+}
+
+const VertexGrid &TransformableCurveItem::vertexGrid() const
+{
+    if (!m_grid) {
+        m_grid = std::make_unique<VertexGrid>(HANDLE_SIZE);
+        m_grid->build(m_points);
+    }
+    return *m_grid;
+}
+
+const SegmentBvh &TransformableCurveItem::segmentBvh() const
+{
+    const QPolygonF &flat = hitTessellation();
+    if (!m_bvh) {
+        m_bvh = std::make_unique<SegmentBvh>();
+        m_bvh->build({flat}, false);
+    }
+    return *m_bvh;
+}
+
+QPainterPath TransformableCurveItem::shape() const
+{
+    const QPolygonF &flat = hitTessellation();
+    // 线宽通过 setItemStyle() 直接改 pen，按线宽判断缓存是否过期
+    if (m_shapeRadius != hitRadius(pen().widthF())) {
+        QPainterPath polyline;
+        polyline.addPolygon(flat);
+        m_shape = strokeShape(polyline, pen());
+        m_shapeRadius = hitRadius(pen().widthF());
+    }
+    return m_shape;
+}
+
+bool TransformableCurveItem::contains(const QPointF &point) const
+{
+    const qreal radius = hitRadius(pen().widthF());
+    if (!m_geom.bounds.adjusted(-radius, -radius, radius, radius).contains(point))
+        return false;
+    return segmentBvh().nearPoint(point, radius);
+}
+
+bool TransformableCurveItem::collidesWithPath(const QPainterPath &path,
+                                              Qt::ItemSelectionMode mode) const
+{
+    if (mode != Qt::IntersectsItemShape)
+        return QAbstractGraphicsShapeItem::collidesWithPath(path, mode);
+    const qreal radius = hitRadius(pen().widthF());
+    if (!m_geom.bounds.adjusted(-radius, -radius, radius, radius).intersects(path.controlPointRect()))
+        return false;
+    return segmentBvh().nearPolygon(path.toFillPolygon(), radius);
+}
+
+void TransformableCurveItem::updateHandleGeometry()
+{
+    m_geom.center = m_geom.bounds.center();
+    /* 旋转手柄：包围盒顶部中点上方 */
+    m_geom.rotateHandle = QPointF(m_geom.center.x(), m_geom.bounds.top() - rotateHandleOffset());
+    m_geom.rotateAnchor = m_geom.rotateHandle;
+}
+
+int TransformableCurveItem::handleAt(const QPointF &pos) const
+{
+    // 控制点按网格索引查找，重叠时取离 pos 最近的一个
+    const int point = vertexGrid().nearest(m_points, pos, handleSize() / 2);
+    if (point >= 0)
+        return FirstPoint + point;
+
+    if (handleRectAt(m_geom.rotateHandle).contains(pos))
+        return RotateHandle;
+    return NoHandle;
+}
+
+Qt::CursorShape TransformableCurveItem::handleCursor(int handle) const
+{
+    if (handle == RotateHandle) return Qt::SizeAllCursor;
+    if (handle >= FirstPoint) return Qt::CrossCursor;
+    return Qt::ArrowCursor;
+}
+
+void TransformableCurveItem::markRotateHandle(int handle)
+{
+    isRotateHandle = (handle == RotateHandle);
+}
+
+void TransformableCurveItem::beginHandleDrag(int handle, const QPointF &pos)
+{
+    m_currentHandle = handle;
+    m_mouseDownScene= mapToScene(pos);
+    m_center        = m_geom.center;
+    m_dragPoint     = handle >= FirstPoint ? handle - FirstPoint : -1;
+    m_pullHandle    = m_dragPoint % 3 == 0
+                   && (QGuiApplication::keyboardModifiers() & Qt::AltModifier);
+    if (m_currentHandle == RotateHandle)
+        m_initialRotation = rotation();
+}
+
+void TransformableCurveItem::dragHandle(const QPointF &pos)
+{
+    if (m_dragPoint < 0)
+        return; // 旋转在广播里处理
+
+    const int i = m_dragPoint;
+    const QPointF anchor = m_points.at(i);
+    if (m_pullHandle) {
+        /* 从锚点拉出控制点：后一侧跟随鼠标，前一侧与之关于锚点对称 */
+        if (i + 1 < m_points.size()) movePoint(i + 1, pos);
+        if (i > 0)                   movePoint(i - 1, 2 * anchor - pos);
+    } else if (i % 3 == 0) {
+        /* 拖动锚点时两侧的控制点随之平移 */
+        const QPointF delta = pos - anchor;
+        if (i > 0)                   movePoint(i - 1, m_points.at(i - 1) + delta);
+        if (i + 1 < m_points.size()) movePoint(i + 1, m_points.at(i + 1) + delta);
+        movePoint(i, pos);
+    } else {
+        movePoint(i, pos);
+    }
+}
+
+void TransformableCurveItem::endHandleDrag()
+{
+    if (m_dragPoint >= 0) {
+        settlePoints();
+        setTransformOriginPoint(m_geom.center);
+    }
+    m_currentHandle = NoHandle;
+    m_dragPoint = -1;
+    m_pullHandle = false;
+}
+
+void TransformableCurveItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
+{
+    m_currentHandle = NoHandle;
+    isRotateHandling = false;
+    CanvasScene::updateMouseSubscription(this);
+    QAbstractGraphicsShapeItem::mouseReleaseEvent(event);
+}
+
+/* ================= 旋转 ================= */
+void TransformableCurveItem::receiveSceneMousePosition(
+    const QPointF &scenePos, MouseLeftClickStatus status)
+{
+    if (!isSelected() && !isRotateHandling) return;
+
+    if (!isUnderMouse()) {
+        const int h = handleAt(mapFromScene(scenePos));
+        markRotateHandle(h);
+
+        if (status == MouseLeftClickStatus::PRESS
+            && h == RotateHandle && !isRotateHandling) {
+            m_currentHandle    = RotateHandle;
+            m_mouseDownScene   = scenePos;
+            m_center           = mapToScene(m_geom.center);
+            m_initialRotation  = rotation();
+            isRotateHandling   = true;
+        }
+    }
+    if (status == MouseLeftClickStatus::RELEASE) {
+        m_currentHandle  = NoHandle;
+        isRotateHandling = false;
+        CanvasScene::updateMouseSubscription(this);
+    }
+
+    if (isRotateHandling) {
+        QLineF start(m_center, m_mouseDownScene);
+        QLineF curr(m_center, scenePos);
+        qreal angleDelta = start.angleTo(curr);
+        setTransformOriginPoint(m_geom.center);
+        setRotation(m_initialRotation - angleDelta);
+    }
+}
+
+/* ================= 绘制 ================= */
+void TransformableCurveItem::paint(QPainter *painter,
+                                   const QStyleOptionGraphicsItem *option,
+                                   QWidget *widget)
+{
+    Q_UNUSED(widget)
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+    // 按图形本身判断，不算包围盒中的点选容差
+    const qreal half = pen().widthF() / 2;
+    if (paintCollapsed(painter, m_geom.bounds.adjusted(-half, -half, half, half), lod, pen().color()))
+        return;
+    painter->setPen(pen());
+    painter->setBrush(Qt::NoBrush);
+    painter->drawPolyline(tessellation(zoomBucket(lod)));
+    paintSelectionOutline(painter, option, boundingRect());
+}
+
+/* ================= 控制点 ================= */
+void TransformableCurveItem::paintHandles(QPainter *painter) const
+{
+    painter->setPen(QPen(Qt::black, 0));
+    painter->setBrush(Qt::white);
+
+    /* SelectionOverlay 会把画家裁剪到重绘区域，控制点多时只画区域内的 */
+    QList<int> visible;
+    QRectF area;
+    if (painter->hasClipping()) {
+        const qreal half = handleSize() / 2;
+        area = painter->clipBoundingRect().adjusted(-half, -half, half, half);
+        visible = vertexGrid().inRect(m_points, area);
+    } else {
+        visible.reserve(m_points.size());
+        for (int i = 0; i < m_points.size(); ++i)
+            visible.append(i);
+    }
+
+    /* 锚点与其控制点之间的连线：从控制点一侧画，控制点在区域外时由锚点补画 */
+    QList<QLineF> lines;
+    QList<QRectF> anchors;
+    QList<QRectF> controls;
+    for (int i : std::as_const(visible)) {
+        const QPointF &p = m_points.at(i);
+        if (i % 3 == 0) {
+            anchors.append(handleRectAt(p));
+            for (int c : {i - 1, i + 1})
+                if (c >= 0 && c < m_points.size() && area.isValid() && !area.contains(m_points.at(c)))
+                    lines.append(QLineF(p, m_points.at(c)));
+        } else {
+            controls.append(handleRectAt(p));
+            lines.append(QLineF(m_points.at(i % 3 == 1 ? i - 1 : i + 1), p));
+        }
+    }
+    painter->drawLines(lines.constData(), int(lines.size()));
+    painter->drawRects(anchors.constData(), int(anchors.size()));
+    for (const QRectF &r : std::as_const(controls))
+        painter->drawEllipse(r);
+
+    /* 旋转手柄 */
+    painter->drawEllipse(handleRectAt(m_geom.rotateHandle));
+}
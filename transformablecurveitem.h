@@ -0,0 +1,120 @@
+#ifndef TRANSFORMABLECURVEITEM_H
+#define TRANSFORMABLECURVEITEM_H
+
+#include "common.h"
+#include "vertexgrid.h"
+#include "segmentbvh.h"
+#include <QAbstractGraphicsShapeItem>
+#include <memory>
+
+// 由若干段三次贝塞尔曲线首尾相接组成的开放曲线。
+// 控制点依次为 起点, (控制点1, 控制点2, 终点) × 段数，共 3n + 1 个，下标为 3 的倍数的是锚点。
+// 绘制使用按缩放档位展平的折线，命中测试使用按固定容差展平的折线，与上次绘制时的缩放无关。
+// 展平结果按段缓存，移动一个控制点只重新展平相邻的一两段；
+// 各段首尾相接成整条折线仍要按总点数拷贝一遍（只是内存拷贝，不再求值曲线）
+class TransformableCurveItem : public QAbstractGraphicsShapeItem,
+                               public IMousePositionReceiver,
+                               public ItemCommon
+{
+public:
+    // 不能沿用 QGraphicsPathItem 的类型，否则 qgraphicsitem_cast 会把曲线当成任意画笔
+    enum { Type = UserType + 1 };
+    int type() const override { return Type; }
+
+    explicit TransformableCurveItem(const QPolygonF &points = QPolygonF(),
+                                    QGraphicsItem *parent = nullptr);
+    ~TransformableCurveItem() override;
+
+    /* 关键重写 */
+    QRectF boundingRect() const override;
+    QRectF tightBoundingRect() const override;
+    QPolygonF points() const { return m_points; }
+    void setPoints(const QPolygonF &points);
+    int segmentCount() const { return m_points.size() < 4 ? 0 : int(m_points.size() - 1) / 3; }
+    // 移动第 index 个控制点，只重新展平、重绘受影响的段
+    void movePoint(int index, const QPointF &pos);
+    // 一系列 movePoint() 之后重新计算精确的包围盒（移动期间包围盒只扩大不缩小）
+    void settlePoints();
+    // 按控制点生成 QPainterPath（不经过图元直接绘制时使用）
+    static QPainterPath curvePath(const QPolygonF &points);
+
+    // 精确的描边轮廓，第一次使用时生成并缓存
+    QPainterPath shape() const override;
+    // 点选和框选走展平折线的线段 BVH
+    bool contains(const QPointF &point) const override;
+    bool collidesWithPath(const QPainterPath &path,
+                          Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
+    /* 接收来自 CustomView 的广播 */
+    void receiveSceneMousePosition(const QPointF &scenePos,
+                                   MouseLeftClickStatus status) override;
+
+    /* 控制点（由 SelectionOverlay 绘制和分发鼠标事件） */
+    void paintHandles(QPainter *painter) const override;
+    int handleAt(const QPointF &pos) const override;
+    Qt::CursorShape handleCursor(int handle) const override;
+    void beginHandleDrag(int handle, const QPointF &pos) override;
+    void dragHandle(const QPointF &pos) override;
+    void endHandleDrag() override;
+    // 包围盒变化后重新计算 m_geom 中的中心和旋转控制点
+    void updateHandleGeometry() override;
+
+protected:
+    // 选中状态、所在场景变化时通知画布场景
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
+
+private:
+    // 控制点编号：第 i 个控制点为 FirstPoint + i
+    enum Handle { NoHandle, RotateHandle, FirstPoint };
+    // 展平的缩放档位：lod 在 [2^k, 2^(k+1)) 内为第 k 档
+    static constexpr int MIN_BUCKET = -8;
+    static constexpr int MAX_BUCKET = 8;
+    static int zoomBucket(qreal lod);
+    // 命中测试折线与曲线的最大偏差（item 坐标），即 1:1 显示时绘制用的容差
+    static constexpr qreal HIT_FLATTEN_TOLERANCE = 0.25;
+
+    // 一种容差下的展平缓存：各段分别展平，再首尾相接成一条折线
+    struct Flattening {
+        QList<QPolygonF> segments; // 各段的展平结果，为空表示需要重新展平
+        QPolygonF flat;            // 各段首尾相接的折线
+        bool dirty = true;
+
+        void reset(int segmentCount);
+        void invalidate(int segment);
+        // 按 tolerance 展平失效的段并重新拼接，返回 flat 是否变化
+        bool build(const QPolygonF &points, qreal tolerance);
+    };
+
+    void markRotateHandle(int handle);
+    const VertexGrid &vertexGrid() const;
+    const SegmentBvh &segmentBvh() const;
+    // 第 bucket 档的展平折线；档位变化时全部重新展平，否则只展平失效的段
+    const QPolygonF &tessellation(int bucket) const;
+    // 按 HIT_FLATTEN_TOLERANCE 展平的折线，shape() 和线段 BVH 由它生成
+    const QPolygonF &hitTessellation() const;
+    void invalidateSegment(int segment);
+
+    QPolygonF m_points;
+    HandleGeometry m_geom;             // bounds 为控制点的包围盒（曲线总在控制点的凸包内）
+    bool m_boundsLoose = false;        // movePoint() 之后 m_geom.bounds 可能大于实际范围
+    mutable std::unique_ptr<VertexGrid> m_grid; // 第一次命中测试时才建立
+    mutable std::unique_ptr<SegmentBvh> m_bvh;  // 同上，命中测试折线变化后丢弃
+    mutable QPainterPath m_shape;
+    mutable qreal m_shapeRadius = -1;   // 生成 m_shape 时的 hitRadius（随线宽和缩放变化），-1 表示需要重新生成
+
+    mutable int m_bucket = 0;          // m_paintFlat 对应的缩放档位
+    mutable Flattening m_paintFlat;    // 绘制用，容差随缩放档位变化
+    mutable Flattening m_hitFlat;      // 命中测试用，容差固定
+
+    int m_currentHandle = NoHandle;
+    int m_dragPoint = -1;              // 正在拖动的控制点下标
+    bool m_pullHandle = false;         // 按住 Alt 拖动锚点：从锚点拉出两侧的控制点
+    QPointF m_mouseDownScene;          // mousePress 时的场景坐标
+    QPointF m_center;                  // 几何中心
+    qreal m_initialRotation = 0;
+};
+
+#endif // TRANSFORMABLECURVEITEM_H
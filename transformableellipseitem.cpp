@@ -1,4 +1,5 @@
 #include "transformableellipseitem.h"
+#include "canvasscene.h"
 #include <QPainter>
 #include <QtMath>
 
@@ -7,135 +8,128 @@ TransformableEllipseItem::TransformableEllipseItem(const QRectF &rect,
                                                    bool isCircle)
     : QGraphicsEllipseItem(rect, parent), isCircle(isCircle)
 {
-    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
-    setAcceptHoverEvents(true);
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable | ItemSendsGeometryChanges);
+    updateHandleGeometry();
 }
 
-QRectF TransformableEllipseItem::boundingRect() const
+TransformableEllipseItem::~TransformableEllipseItem()
 {
-    const qreal extra = HANDLE_SIZE + ROTATE_HANDLE_OFFSET;
-    return rect().adjusted(-extra, -extra, extra, extra);
+    CanvasScene::itemDestroyed(this);
 }
 
-void TransformableEllipseItem::paint(QPainter *painter,
-                                     const QStyleOptionGraphicsItem *option,
-                                     QWidget *widget)
+QVariant TransformableEllipseItem::itemChange(GraphicsItemChange change, const QVariant &value)
 {
-    QGraphicsEllipseItem::paint(painter, option, widget);
-    if (!isSelected()) return;
+    CanvasScene::itemChanged(this, change);
+    return QGraphicsEllipseItem::itemChange(change, value);
+}
 
-    painter->setRenderHint(QPainter::Antialiasing);
-    painter->setPen(QPen(Qt::black, 1));
-    painter->setBrush(Qt::white);
+QRectF TransformableEllipseItem::tightBoundingRect() const
+{
+    const qreal half = pen().widthF() / 2;
+    return m_geom.bounds.adjusted(-half, -half, half, half);
+}
+
+void TransformableEllipseItem::setRect(const QRectF &rect)
+{
+    QGraphicsEllipseItem::setRect(rect);
+    updateHandleGeometry();
+    CanvasScene::itemGeometryChanged(this);
+}
 
+QRectF TransformableEllipseItem::boundingRect() const
+{
+    // 控制点由 SelectionOverlay 绘制，包围盒只需容纳图形本身
+    return tightBoundingRect();
+}
+
+void TransformableEllipseItem::updateHandleGeometry()
+{
     const QRectF r = rect();
-    const auto tl = r.topLeft(), tr = r.topRight() - QPointF(HANDLE_SIZE, 0),
-        bl = r.bottomLeft() - QPointF(0, HANDLE_SIZE), br = r.bottomRight() - QPointF(HANDLE_SIZE, HANDLE_SIZE);
+    m_geom.bounds = r.normalized();
+    m_geom.center = r.center();
 
     // 4 个缩放手柄
-    auto drawHandle = [&](const QPointF &p) {
-        painter->drawRect(QRectF(p,
-                                 QSize(HANDLE_SIZE, HANDLE_SIZE)));
-    };
-    drawHandle(tl); drawHandle(tr); drawHandle(bl); drawHandle(br);
+    const qreal hs = handleSize();
+    const QSizeF size(hs, hs);
+    m_geom.handles[TopLeft - 1]     = QRectF(r.topLeft(), size);
+    m_geom.handles[TopRight - 1]    = QRectF(r.topRight() - QPointF(hs, 0), size);
+    m_geom.handles[BottomLeft - 1]  = QRectF(r.bottomLeft() - QPointF(0, hs), size);
+    m_geom.handles[BottomRight - 1] = QRectF(r.bottomRight() - QPointF(hs, hs), size);
+    m_geom.handleCount = 4;
 
     // 旋转手柄
     const QPointF topCenter = (r.topLeft() + r.topRight()) / 2.;
-    const QPointF center = ellipseCenter();
-    QPointF dir = topCenter - center;
-    if (!qFuzzyIsNull(QPointF::dotProduct(dir, dir)))
-        dir /= sqrt(QPointF::dotProduct(dir, dir));
-    const QPointF rotPos = topCenter + dir * ROTATE_HANDLE_OFFSET;
-    painter->drawLine(topCenter, rotPos);
-    painter->drawEllipse(QRectF(rotPos - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                                QSize(HANDLE_SIZE, HANDLE_SIZE)));
+    QPointF dir = topCenter - m_geom.center;
+    const qreal norm2 = QPointF::dotProduct(dir, dir);
+    if (!qFuzzyIsNull(norm2))
+        dir /= sqrt(norm2);
+    m_geom.rotateAnchor = topCenter;
+    m_geom.rotateHandle = topCenter + dir * rotateHandleOffset();
+}
+
+void TransformableEllipseItem::paintHandles(QPainter *painter) const
+{
+    painter->setPen(QPen(Qt::black, 0));
+    painter->setBrush(Qt::white);
+
+    // 4 个缩放手柄
+    painter->drawRects(m_geom.handles.data(), m_geom.handleCount);
+
+    // 旋转手柄
+    painter->drawLine(m_geom.rotateAnchor, m_geom.rotateHandle);
+    painter->drawEllipse(handleRectAt(m_geom.rotateHandle));
 }
 
 QPainterPath TransformableEllipseItem::shape() const
 {
-    // 用 rect 作为交互区域，手柄就能被 hover 到
+    // 用 rect 作为交互区域
     QPainterPath p;
     p.addRect(rect());
     return p;
 }
 
-TransformableEllipseItem::Handle
-TransformableEllipseItem::handleAt(const QPointF &pos) const
+int TransformableEllipseItem::handleAt(const QPointF &pos) const
 {
-    const QRectF r = rect();
-    const QRectF tlH(r.topLeft(),
-                     QSize(HANDLE_SIZE, HANDLE_SIZE));
-    const QRectF trH(r.topRight() - QPointF(HANDLE_SIZE, 0),
-                     QSize(HANDLE_SIZE, HANDLE_SIZE));
-    const QRectF blH(r.bottomLeft() - QPointF(0, HANDLE_SIZE),
-                     QSize(HANDLE_SIZE, HANDLE_SIZE));
-    const QRectF brH(r.bottomRight() - QPointF(HANDLE_SIZE, HANDLE_SIZE),
-                     QSize(HANDLE_SIZE, HANDLE_SIZE));
-
-    const QPointF topCenter = (r.topLeft() + r.topRight()) / 2.;
-    const QPointF center = ellipseCenter();
-    QPointF dir = topCenter - center;
-    if (!qFuzzyIsNull(QPointF::dotProduct(dir, dir)))
-        dir /= sqrt(QPointF::dotProduct(dir, dir));
-    const QPointF rotPos = topCenter + dir * ROTATE_HANDLE_OFFSET;
-    const QRectF rotH(rotPos - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                      QSize(HANDLE_SIZE, HANDLE_SIZE));
-
-    if (tlH.contains(pos)) return TopLeft;
-    if (trH.contains(pos)) return TopRight;
-    if (blH.contains(pos)) return BottomLeft;
-    if (brH.contains(pos)) return BottomRight;
-    if (rotH.contains(pos)) return RotateHandle;
+    const int corner = m_geom.handleIndexAt(pos);
+    if (corner >= 0) return TopLeft + corner;
+    if (handleRectAt(m_geom.rotateHandle).contains(pos)) return RotateHandle;
     return NoHandle;
 }
 
-void TransformableEllipseItem::setHandleCursor(Handle h)
+Qt::CursorShape TransformableEllipseItem::handleCursor(int handle) const
 {
-    isRotateHandle = false;
-    switch (h) {
-    case TopLeft: case BottomRight: setCursor(Qt::SizeFDiagCursor); break;
-    case TopRight: case BottomLeft: setCursor(Qt::SizeBDiagCursor); break;
-    case RotateHandle: isRotateHandle = true; break;
-    default: setCursor(Qt::ArrowCursor); break;
+    switch (handle) {
+    case TopLeft: case BottomRight: return Qt::SizeFDiagCursor;
+    case TopRight: case BottomLeft: return Qt::SizeBDiagCursor;
+    case RotateHandle: return Qt::SizeAllCursor;
+    default: return Qt::ArrowCursor;
     }
 }
 
-void TransformableEllipseItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+void TransformableEllipseItem::markRotateHandle(Handle h)
 {
-    setHandleCursor(handleAt(event->pos()));
-    QGraphicsEllipseItem::hoverMoveEvent(event);
+    isRotateHandle = (h == RotateHandle);
 }
 
-void TransformableEllipseItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
+void TransformableEllipseItem::beginHandleDrag(int handle, const QPointF &pos)
 {
-    m_currentHandle = handleAt(event->pos());
-    if (m_currentHandle != NoHandle) {
-        m_mouseDownPos = event->pos();
-        m_mouseDownRect = rect();
-        m_centerPoint = ellipseCenter();
-        if (m_currentHandle == RotateHandle)
-            m_initialRotation = rotation();
-    } else {
-        QGraphicsEllipseItem::mousePressEvent(event);
-    }
+    m_currentHandle = Handle(handle);
+    m_mouseDownPos = pos;
+    m_mouseDownRect = rect();
+    m_centerPoint = m_geom.center;
+    if (m_currentHandle == RotateHandle)
+        m_initialRotation = rotation();
 }
 
-void TransformableEllipseItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
+void TransformableEllipseItem::dragHandle(const QPointF &p)
 {
-    if (m_currentHandle == NoHandle) {
-        QGraphicsEllipseItem::mouseMoveEvent(event);
-        return;
-    }
-    prepareGeometryChange();
     QRectF newRect = m_mouseDownRect;
-    const QPointF p = event->pos();
     switch (m_currentHandle) {
     case TopLeft:     newRect.setTopLeft(p);     break;
     case TopRight:    newRect.setTopRight(p);    break;
     case BottomLeft:  newRect.setBottomLeft(p);  break;
     case BottomRight: newRect.setBottomRight(p); break;
-    case RotateHandle: return; // 在 receiveSceneMousePosition 中处理
-    default: break;
+    default: return; // 旋转在 receiveSceneMousePosition 中处理
     }
     if(isCircle){
         qreal side = qMax(newRect.width(), newRect.height());
@@ -146,11 +140,17 @@ void TransformableEllipseItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
     setTransformOriginPoint(newRect.center());
 }
 
+void TransformableEllipseItem::endHandleDrag()
+{
+    m_currentHandle = NoHandle;
+}
+
 void TransformableEllipseItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
     Q_UNUSED(event)
     m_currentHandle = NoHandle;
     isRotateHandling = false;
+    CanvasScene::updateMouseSubscription(this);
     QGraphicsEllipseItem::mouseReleaseEvent(event);
 }
 
@@ -163,15 +163,15 @@ void TransformableEllipseItem::receiveSceneMousePosition(const QPointF &scenePos
         if (!isUnderMouse())
         {
             const QPointF itemPos = mapFromScene(scenePos);
-            const Handle h = handleAt(itemPos);
-            setHandleCursor(h);
+            const Handle h = Handle(handleAt(itemPos));
+            markRotateHandle(h);
 
             if (status == MouseLeftClickStatus::PRESS
                 && h == RotateHandle && !isRotateHandling) {
                 m_currentHandle   = RotateHandle;
                 m_mouseDownPos    = scenePos;
                 m_mouseDownRect   = rect();
-                m_centerPoint     = mapToScene(ellipseCenter());
+                m_centerPoint     = mapToScene(m_geom.center);
                 m_initialRotation = rotation();
                 isRotateHandling  = true;
             }
@@ -179,13 +179,14 @@ void TransformableEllipseItem::receiveSceneMousePosition(const QPointF &scenePos
         if (status == MouseLeftClickStatus::RELEASE) {
             m_currentHandle  = NoHandle;
             isRotateHandling = false;
+            CanvasScene::updateMouseSubscription(this);
         }
 
         if (isRotateHandling) {
             const QLineF start(m_centerPoint, m_mouseDownPos);
             const QLineF curr(m_centerPoint, scenePos);
             const qreal angleDelta = start.angleTo(curr);
-            setTransformOriginPoint(ellipseCenter());
+            setTransformOriginPoint(m_geom.center);
             setRotation(m_initialRotation - angleDelta);
         }
     }
@@ -14,27 +14,36 @@ public:
     explicit TransformableEllipseItem(const QRectF &rect = QRectF(),
                                       QGraphicsItem *parent = nullptr,
                                       bool isCircle = false);
+    ~TransformableEllipseItem() override;
 
     /* 关键重写 */
     QRectF boundingRect() const override;
-    void paint(QPainter *painter,
-               const QStyleOptionGraphicsItem *option,
-               QWidget *widget = nullptr) override;
+    QRectF tightBoundingRect() const override;
+    void setRect(const QRectF &rect);
     void receiveSceneMousePosition(const QPointF &scenePos,
                                    MouseLeftClickStatus status) override;
     QPainterPath shape() const override;
 
+    /* 控制点（由 SelectionOverlay 绘制和分发鼠标事件） */
+    void paintHandles(QPainter *painter) const override;
+    int handleAt(const QPointF &pos) const override;
+    Qt::CursorShape handleCursor(int handle) const override;
+    void beginHandleDrag(int handle, const QPointF &pos) override;
+    void dragHandle(const QPointF &pos) override;
+    void endHandleDrag() override;
+    // setRect() 之后重新计算 m_geom
+    void updateHandleGeometry() override;
+
 protected:
-    void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
-    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
-    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    // 选中状态、所在场景变化时通知画布场景
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
 
 private:
     enum Handle { NoHandle, TopLeft, TopRight, BottomLeft, BottomRight, RotateHandle };
-    Handle handleAt(const QPointF &pos) const;
-    void setHandleCursor(Handle h);
-    QPointF ellipseCenter() const { return rect().center(); }
+    void markRotateHandle(Handle h);
+
+    HandleGeometry m_geom;
 
     Handle m_currentHandle = NoHandle;
     QRectF m_mouseDownRect;
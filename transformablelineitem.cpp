@@ -1,4 +1,6 @@
 #include "transformablelineitem.h"
+#include "canvasscene.h"
+#include "segmentbvh.h"
 #include <QPainter>
 #include <QLineF>
 #include <QtMath>
@@ -7,93 +9,100 @@ TransformableLineItem::TransformableLineItem(const QLineF &line,
                                              QGraphicsItem *parent)
     : QGraphicsLineItem(line, parent)
 {
-    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
-    setAcceptHoverEvents(true);
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable | ItemSendsGeometryChanges);
+    updateHandleGeometry();
 }
 
-QRectF TransformableLineItem::boundingRect() const
+TransformableLineItem::~TransformableLineItem()
 {
-    qreal extra = HANDLE_SIZE + ROTATE_HANDLE_OFFSET;
-    return QRectF(line().p1(), line().p2())
-        .normalized()
-        .adjusted(-extra, -extra, extra, extra);
+    CanvasScene::itemDestroyed(this);
 }
 
-void TransformableLineItem::paint(QPainter *painter,
-                                  const QStyleOptionGraphicsItem *option,
-                                  QWidget *widget)
+QVariant TransformableLineItem::itemChange(GraphicsItemChange change, const QVariant &value)
 {
-    QGraphicsLineItem::paint(painter, option, widget);
-    if (!isSelected()) return;
-
-    painter->setRenderHint(QPainter::Antialiasing);
-    painter->setPen(QPen(Qt::black, 1));
-    painter->setBrush(Qt::white);
+    CanvasScene::itemChanged(this, change);
+    return QGraphicsLineItem::itemChange(change, value);
+}
 
-    /* 端点手柄 */
-    QPointF p1 = line().p1();
-    QPointF p2 = line().p2();
-    painter->drawRect(QRectF(p1 - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                             QSize(HANDLE_SIZE, HANDLE_SIZE)));
-    painter->drawRect(QRectF(p2 - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                             QSize(HANDLE_SIZE, HANDLE_SIZE)));
+QRectF TransformableLineItem::tightBoundingRect() const
+{
+    const qreal half = hitPadding(pen().widthF());
+    return m_geom.bounds.adjusted(-half, -half, half, half);
+}
 
-    /* 旋转手柄 */
-    QPointF dir = p2 - p1;
-    dir = dir / sqrt(QPointF::dotProduct(dir, dir));
-    QPointF rotPos = p2 + dir * ROTATE_HANDLE_OFFSET;
-    painter->drawEllipse(QRectF(rotPos - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                                QSize(HANDLE_SIZE, HANDLE_SIZE)));
+void TransformableLineItem::setLine(const QLineF &line)
+{
+    QGraphicsLineItem::setLine(line);
+    updateHandleGeometry();
+    m_shapeRadius = -1;
+    CanvasScene::itemGeometryChanged(this);
 }
 
-QPointF TransformableLineItem::lineCenter() const
+QRectF TransformableLineItem::boundingRect() const
 {
-    const QLineF l = line();
-    return (l.p1() + l.p2()) * 0.5;
+    // 控制点由 SelectionOverlay 绘制，包围盒只需容纳图形本身
+    return tightBoundingRect();
 }
 
-TransformableLineItem::Handle
-TransformableLineItem::handleAt(const QPointF &pos)
+void TransformableLineItem::updateHandleGeometry()
 {
-    QPointF p1 = line().p1();
-    QPointF p2 = line().p2();
+    const QPointF p1 = line().p1();
+    const QPointF p2 = line().p2();
+    m_geom.bounds = QRectF(p1, p2).normalized();
+    m_geom.center = (p1 + p2) * 0.5;
 
-    QRectF p1Rect(p1 - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                  QSize(HANDLE_SIZE, HANDLE_SIZE));
-    QRectF p2Rect(p2 - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                  QSize(HANDLE_SIZE, HANDLE_SIZE));
+    /* 端点手柄 */
+    m_geom.handles[Pole1Handle - 1] = handleRectAt(p1);
+    m_geom.handles[Pole2Handle - 1] = handleRectAt(p2);
+    m_geom.handleCount = 2;
 
+    /* 旋转手柄：p2 沿线段方向延长，线段退化为一点时与 p2 重合 */
     QPointF dir = p2 - p1;
-    dir = dir / sqrt(QPointF::dotProduct(dir, dir));
-    QPointF rotPos = p2 + dir * ROTATE_HANDLE_OFFSET;
-    QRectF rotRect(rotPos - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                   QSize(HANDLE_SIZE, HANDLE_SIZE));
-
-    if (p1Rect.contains(pos)) return Pole1Handle;
-    if (p2Rect.contains(pos)) return Pole2Handle;
-    if (rotRect.contains(pos)) return RotateHandle;
+    const qreal norm2 = QPointF::dotProduct(dir, dir);
+    if (norm2 > PRECISION)
+        dir /= sqrt(norm2);
+    else
+        dir = QPointF();
+    m_geom.rotateAnchor = p2;
+    m_geom.rotateHandle = p2 + dir * rotateHandleOffset();
+}
+
+void TransformableLineItem::paintHandles(QPainter *painter) const
+{
+    painter->setPen(QPen(Qt::black, 0));
+    painter->setBrush(Qt::white);
+
+    /* 端点手柄 */
+    painter->drawRects(m_geom.handles.data(), m_geom.handleCount);
+
+    /* 旋转手柄 */
+    painter->drawEllipse(handleRectAt(m_geom.rotateHandle));
+}
+
+int TransformableLineItem::handleAt(const QPointF &pos) const
+{
+    const int pole = m_geom.handleIndexAt(pos);
+    if (pole >= 0) return Pole1Handle + pole;
+    if (handleRectAt(m_geom.rotateHandle).contains(pos)) return RotateHandle;
     return NoHandle;
 }
 
-void TransformableLineItem::setHandleCursor(Handle handle)
+Qt::CursorShape TransformableLineItem::handleCursor(int handle) const
 {
-    isRotateHandle = false;
     switch (handle) {
     case Pole1Handle:
     case Pole2Handle:
-        setCursor(Qt::CrossCursor); break;
+        return Qt::CrossCursor;
     case RotateHandle:
-        isRotateHandle = true;      break;
+        return Qt::SizeAllCursor;
     default:
-        setCursor(Qt::ArrowCursor); break;
+        return Qt::ArrowCursor;
     }
 }
 
-void TransformableLineItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+void TransformableLineItem::markRotateHandle(Handle handle)
 {
-    Handle handle = handleAt(event->pos());
-    setHandleCursor(handle);
-    QGraphicsLineItem::hoverMoveEvent(event);
+    isRotateHandle = (handle == RotateHandle);
 }
 
 /* ====== 旋转核心 ====== */
@@ -105,15 +114,15 @@ void TransformableLineItem::receiveSceneMousePosition(
         if (!this->isUnderMouse())
         {
             QPointF itemPos = mapFromScene(scenePos);
-            Handle handle = handleAt(itemPos);
-            setHandleCursor(handle);
+            Handle handle = Handle(handleAt(itemPos));
+            markRotateHandle(handle);
 
             if (status == MouseLeftClickStatus::PRESS && handle == RotateHandle
                 && !isRotateHandling) {
                 m_currentHandle     = RotateHandle;
                 m_mouseDownPos      = scenePos;
                 m_mouseDownLine     = line();
-                m_centerPoint       = mapToScene(lineCenter());
+                m_centerPoint       = mapToScene(m_geom.center);
                 m_initialRotation   = rotation();
                 isRotateHandling    = true;
             }
@@ -121,64 +130,78 @@ void TransformableLineItem::receiveSceneMousePosition(
         if (status == MouseLeftClickStatus::RELEASE) {
             m_currentHandle  = NoHandle;
             isRotateHandling = false;
+            CanvasScene::updateMouseSubscription(this);
         }
 
         if (isRotateHandling) {
             QLineF start(m_centerPoint, m_mouseDownPos);
             QLineF curr(m_centerPoint, scenePos);
             qreal angleDelta = curr.angleTo(start);
-            setTransformOriginPoint(lineCenter());
+            setTransformOriginPoint(m_geom.center);
             setRotation(m_initialRotation + angleDelta);
         }
     }
 }
 
-void TransformableLineItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
+void TransformableLineItem::beginHandleDrag(int handle, const QPointF &pos)
 {
-    Handle handle = handleAt(event->pos());
-    if (handle == NoHandle) {
-        QGraphicsLineItem::mousePressEvent(event);
-        return;
-    }
-    m_currentHandle = handle;
-    m_mouseDownPos  = event->pos();          // item 坐标
+    m_currentHandle = Handle(handle);
+    m_mouseDownPos  = pos;                   // item 坐标
     m_mouseDownLine = line();
-    m_centerPoint   = lineCenter();          // item 坐标
-    if (handle == RotateHandle)
+    m_centerPoint   = m_geom.center;          // item 坐标
+    if (m_currentHandle == RotateHandle)
         m_initialRotation = rotation();
 }
 
-void TransformableLineItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
+void TransformableLineItem::dragHandle(const QPointF &pos)
 {
-    if (m_currentHandle == NoHandle) {
-        QGraphicsLineItem::mouseMoveEvent(event);
-        return;
-    }
-    prepareGeometryChange();
-
     QPointF p1 = m_mouseDownLine.p1();
     QPointF p2 = m_mouseDownLine.p2();
 
     if (m_currentHandle == Pole1Handle)
-        p1 = event->pos();
+        p1 = pos;
     else if (m_currentHandle == Pole2Handle)
-        p2 = event->pos();
-    else if (m_currentHandle == RotateHandle)
-        return; // 已在 receiveSceneMousePosition 处理
+        p2 = pos;
+    else
+        return; // 旋转在 receiveSceneMousePosition 处理
 
     setLine(QLineF(p1, p2));
     setTransformOriginPoint(QLineF(p1, p2).center());
 }
 
+void TransformableLineItem::endHandleDrag()
+{
+    m_currentHandle = NoHandle;
+}
+
 void TransformableLineItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
 {
     m_currentHandle = NoHandle;
     isRotateHandling = false;
+    CanvasScene::updateMouseSubscription(this);
     QGraphicsLineItem::mouseReleaseEvent(event);
 }
 
-QPainterPath TransformableLineItem::shape() const{
-    QPainterPath rectPath;
-    rectPath.addRect(QRectF(line().p1(), line().p2()).normalized());
-    return rectPath;
+QPainterPath TransformableLineItem::shape() const
+{
+    if (m_shapeRadius != hitRadius(pen().widthF())) {
+        QPainterPath linePath(line().p1());
+        linePath.lineTo(line().p2());
+        m_shape = strokeShape(linePath, pen());
+        m_shapeRadius = hitRadius(pen().widthF());
+    }
+    return m_shape;
+}
+
+bool TransformableLineItem::contains(const QPointF &point) const
+{
+    return pointSegmentDistance(point, line()) <= hitRadius(pen().widthF());
+}
+
+bool TransformableLineItem::collidesWithPath(const QPainterPath &path,
+                                             Qt::ItemSelectionMode mode) const
+{
+    if (mode != Qt::IntersectsItemShape)
+        return QGraphicsLineItem::collidesWithPath(path, mode);
+    return segmentNearPolygon(line(), path.toFillPolygon(), hitRadius(pen().widthF()));
 }
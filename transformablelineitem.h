@@ -12,18 +12,33 @@ class TransformableLineItem : public QGraphicsLineItem, public IMousePositionRec
 {
 public:
     TransformableLineItem(const QLineF &line, QGraphicsItem *parent = nullptr);
+    ~TransformableLineItem() override;
 
     // 重写关键的虚函数
-    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
     QRectF boundingRect() const override;
+    QRectF tightBoundingRect() const override;
+    void setLine(const QLineF &line);
     void receiveSceneMousePosition(const QPointF &scenePos, const MouseLeftClickStatus mouseLeftClickStatus) override;
+    // 精确的描边轮廓，第一次使用时生成并缓存
     QPainterPath shape() const override;
+    // 点选和框选直接按点、多边形到线段的距离判断
+    bool contains(const QPointF &point) const override;
+    bool collidesWithPath(const QPainterPath &path,
+                          Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+
+    // 控制点（由 SelectionOverlay 绘制和分发鼠标事件）
+    void paintHandles(QPainter *painter) const override;
+    int handleAt(const QPointF &pos) const override;
+    Qt::CursorShape handleCursor(int handle) const override;
+    void beginHandleDrag(int handle, const QPointF &pos) override;
+    void dragHandle(const QPointF &pos) override;
+    void endHandleDrag() override;
+    // setLine() 之后重新计算 m_geom
+    void updateHandleGeometry() override;
 
 protected:
-    // 重写鼠标事件以处理控制点
-    void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
-    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
-    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    // 选中状态、所在场景变化时通知画布场景
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
 
 private:
@@ -44,9 +59,11 @@ private:
     qreal m_initialRotation = 0;
 
     // 辅助函数
-    void setHandleCursor(Handle handle);
-    Handle handleAt(const QPointF &pos);
-    QPointF lineCenter() const;
+    void markRotateHandle(Handle handle);
+
+    HandleGeometry m_geom;
+    mutable QPainterPath m_shape;
+    mutable qreal m_shapeRadius = -1; // 生成 m_shape 时的 hitRadius（随线宽和缩放变化），-1 表示需要重新生成
 };
 
 #endif // TRANSFORMABLELINEITEM_H
@@ -1,95 +1,177 @@
 #include "transformablepathitem.h"
+#include "canvasscene.h"
 #include <QPainter>
 #include <QtMath>
 #include <QGraphicsSceneMouseEvent>
 #include <QCursor>
+#include <QStyleOptionGraphicsItem>
 
 TransformablePathItem::TransformablePathItem(const QPainterPath &path,
                                              QGraphicsItem *parent)
     : QGraphicsPathItem(path, parent)
 {
-    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
-    setAcceptHoverEvents(true);
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable | ItemSendsGeometryChanges);
+    setFlag(ItemUsesExtendedStyleOption); // paint() 中按 exposedRect 挑选要描边的分段
+    updateHandleGeometry();
 }
 
-QRectF TransformablePathItem::boundingRect() const
+TransformablePathItem::~TransformablePathItem()
+{
+    CanvasScene::itemDestroyed(this);
+}
+
+QVariant TransformablePathItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    CanvasScene::itemChanged(this, change);
+    return QGraphicsPathItem::itemChange(change, value);
+}
+
+QRectF TransformablePathItem::tightBoundingRect() const
+{
+    const qreal half = hitPadding(pen().widthF());
+    return m_geom.bounds.adjusted(-half, -half, half, half);
+}
+
+void TransformablePathItem::setPath(const QPainterPath &path)
 {
-    const qreal extra = HANDLE_SIZE + ROTATE_HANDLE_OFFSET;
-    return path().controlPointRect().adjusted(-extra, -extra, extra, extra);
+    QGraphicsPathItem::setPath(path);
+    updateHandleGeometry();
+    m_lod.reset();
+    m_chunks.reset();
+    m_bvh.reset();
+    m_shapeRadius = -1;
+    CanvasScene::itemGeometryChanged(this);
 }
 
 void TransformablePathItem::paint(QPainter *painter,
                                   const QStyleOptionGraphicsItem *option,
                                   QWidget *widget)
 {
-    QGraphicsPathItem::paint(painter, option, widget);
-    if (!isSelected()) return;
+    // 不足一个像素时画成一个点；密集的笔画在缩小显示时用抽稀后的折线代替
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+    // 按图形本身判断，不算包围盒中的点选容差
+    const qreal half = pen().widthF() / 2;
+    if (paintCollapsed(painter, m_geom.bounds.adjusted(-half, -half, half, half), lod, pen().color()))
+        return;
+    const int level = LodPyramid::levelFor(lod);
+    if (level < 0 || path().elementCount() < LodPyramid::MIN_POINTS) {
+        if (path().elementCount() < 2 * PathChunks::CHUNK_ELEMENTS || !PathChunks::canDraw(pen())) {
+            QGraphicsPathItem::paint(painter, option, widget);
+            return;
+        }
+        if (!m_chunks) {
+            m_chunks = std::make_unique<PathChunks>();
+            m_chunks->build(path());
+        }
+        painter->setPen(pen());
+        painter->setBrush(Qt::NoBrush);
+        // 外扩到尖角连接和方头线帽都不会伸进重绘区域，再加抗锯齿的一个像素
+        const qreal width = pen().isCosmetic() ? qMax<qreal>(pen().widthF(), 1) / lod : pen().widthF();
+        m_chunks->draw(painter, path(), option->exposedRect,
+                       width * qMax<qreal>(1, pen().miterLimit()) / 2 + 1 / lod);
+        paintSelectionOutline(painter, option, boundingRect());
+        return;
+    }
+    if (!m_lod) m_lod = std::make_unique<LodPyramid>();
+    painter->setPen(pen());
+    painter->setBrush(Qt::NoBrush);
+    for (const QPolygonF &poly : m_lod->pathLevel(path(), level))
+        painter->drawPolyline(poly);
+    paintSelectionOutline(painter, option, boundingRect());
+}
 
-    painter->setRenderHint(QPainter::Antialiasing);
-    painter->setPen(QPen(Qt::black, 1));
-    painter->setBrush(Qt::white);
+QRectF TransformablePathItem::boundingRect() const
+{
+    // 控制点由 SelectionOverlay 绘制，包围盒只需容纳图形本身
+    return tightBoundingRect();
+}
 
-    /* 旋转手柄 */
-    const QPointF c = pathCenter();
-    const qreal top = path().controlPointRect().top();
-    const QPointF rotateHandle(c.x(), top - ROTATE_HANDLE_OFFSET);
-    painter->drawEllipse(QRectF(rotateHandle - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                                QSize(HANDLE_SIZE, HANDLE_SIZE)));
+void TransformablePathItem::updateHandleGeometry()
+{
+    m_geom.bounds = path().controlPointRect();
+    m_geom.center = m_geom.bounds.center();
+    /* 旋转手柄：包围盒顶部中点上方 */
+    m_geom.rotateHandle = QPointF(m_geom.center.x(), m_geom.bounds.top() - rotateHandleOffset());
+    m_geom.rotateAnchor = m_geom.rotateHandle;
+}
+
+void TransformablePathItem::paintHandles(QPainter *painter) const
+{
+    painter->setPen(QPen(Qt::black, 0));
+    painter->setBrush(Qt::white);
+    painter->drawEllipse(handleRectAt(m_geom.rotateHandle));
 }
 
 QPainterPath TransformablePathItem::shape() const
 {
-    QPainterPath pathShape;
-    pathShape.addRect(path().controlPointRect());
-    return pathShape;
+    // 线宽通过 setItemStyle() 等直接改 pen，按线宽判断缓存是否过期
+    if (m_shapeRadius != hitRadius(pen().widthF())) {
+        m_shape = strokeShape(path(), pen());
+        m_shapeRadius = hitRadius(pen().widthF());
+    }
+    return m_shape;
+}
+
+const SegmentBvh &TransformablePathItem::segmentBvh() const
+{
+    if (!m_bvh) {
+        m_bvh = std::make_unique<SegmentBvh>();
+        m_bvh->build(path().toSubpathPolygons(), false);
+    }
+    return *m_bvh;
 }
 
-QPointF TransformablePathItem::pathCenter() const
+bool TransformablePathItem::contains(const QPointF &point) const
 {
-    return path().controlPointRect().center();
+    const qreal radius = hitRadius(pen().widthF());
+    if (!m_geom.bounds.adjusted(-radius, -radius, radius, radius).contains(point))
+        return false;
+    return segmentBvh().nearPoint(point, radius);
 }
 
-TransformablePathItem::Handle
-TransformablePathItem::handleAt(const QPointF &pos) const
+bool TransformablePathItem::collidesWithPath(const QPainterPath &path,
+                                             Qt::ItemSelectionMode mode) const
 {
-    const QPointF c = pathCenter();
-    const qreal top = path().controlPointRect().top();
-    const QPointF rotateHandle(c.x(), top - ROTATE_HANDLE_OFFSET);
-    if (QRectF(rotateHandle - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-               QSize(HANDLE_SIZE, HANDLE_SIZE)).contains(pos))
+    if (mode != Qt::IntersectsItemShape)
+        return QGraphicsPathItem::collidesWithPath(path, mode);
+    const qreal radius = hitRadius(pen().widthF());
+    if (!m_geom.bounds.adjusted(-radius, -radius, radius, radius).intersects(path.controlPointRect()))
+        return false;
+    return segmentBvh().nearPolygon(path.toFillPolygon(), radius);
+}
+
+int TransformablePathItem::handleAt(const QPointF &pos) const
+{
+    if (handleRectAt(m_geom.rotateHandle).contains(pos))
         return RotateHandle;
     return NoHandle;
 }
 
-void TransformablePathItem::setHandleCursor(Handle h)
+Qt::CursorShape TransformablePathItem::handleCursor(int handle) const
 {
-    isRotateHandle = false;
-    setCursor(h == RotateHandle ? Qt::SizeAllCursor : Qt::ArrowCursor);
-    if (h == RotateHandle) isRotateHandle = true;
+    return handle == RotateHandle ? Qt::SizeAllCursor : Qt::ArrowCursor;
 }
 
-void TransformablePathItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+void TransformablePathItem::markRotateHandle(Handle h)
 {
-    setHandleCursor(handleAt(event->pos()));
-    QGraphicsPathItem::hoverMoveEvent(event);
+    isRotateHandle = (h == RotateHandle);
 }
 
-void TransformablePathItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
+/* 任意画笔只有旋转控制点，旋转在广播里处理 */
+void TransformablePathItem::beginHandleDrag(int handle, const QPointF &pos)
 {
-    m_currentHandle = handleAt(event->pos());
-    if (m_currentHandle == NoHandle) {
-        QGraphicsPathItem::mousePressEvent(event);
-        return;
-    }
-    m_mouseDownScene = mapToScene(event->pos());
-    m_center         = pathCenter();
-    m_initialRotation= rotation();
+    Q_UNUSED(pos)
+    m_currentHandle = Handle(handle);
 }
 
-void TransformablePathItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
+void TransformablePathItem::dragHandle(const QPointF &pos)
 {
-    if (m_currentHandle == NoHandle)
-        QGraphicsPathItem::mouseMoveEvent(event);
+    Q_UNUSED(pos)
+}
+
+void TransformablePathItem::endHandleDrag()
+{
+    m_currentHandle = NoHandle;
 }
 
 void TransformablePathItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
@@ -97,6 +179,7 @@ void TransformablePathItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     Q_UNUSED(event)
     m_currentHandle = NoHandle;
     isRotateHandling= false;
+    CanvasScene::updateMouseSubscription(this);
     QGraphicsPathItem::mouseReleaseEvent(event);
 }
 
@@ -107,13 +190,13 @@ void TransformablePathItem::receiveSceneMousePosition(
     if (!isSelected() && !isRotateHandling) return;
 
     if (!isUnderMouse()) {
-        Handle h = handleAt(mapFromScene(scenePos));
-        setHandleCursor(h);
+        Handle h = Handle(handleAt(mapFromScene(scenePos)));
+        markRotateHandle(h);
         if (status == MouseLeftClickStatus::PRESS
             && h == RotateHandle && !isRotateHandling) {
             m_currentHandle   = RotateHandle;
             m_mouseDownScene  = scenePos;
-            m_center          = mapToScene(pathCenter());
+            m_center          = mapToScene(m_geom.center);
             m_initialRotation = rotation();
             isRotateHandling  = true;
         }
@@ -121,12 +204,13 @@ void TransformablePathItem::receiveSceneMousePosition(
     if (status == MouseLeftClickStatus::RELEASE) {
         m_currentHandle  = NoHandle;
         isRotateHandling = false;
+        CanvasScene::updateMouseSubscription(this);
     }
     if (isRotateHandling) {
         QLineF start(m_center, m_mouseDownScene);
         QLineF curr(m_center, scenePos);
         qreal angleDelta = start.angleTo(curr);
-        setTransformOriginPoint(pathCenter());
+        setTransformOriginPoint(m_geom.center);
         setRotation(m_initialRotation - angleDelta);
     }
 }
@@ -2,7 +2,11 @@
 #define TRANSFORMABLEPATHITEM_H
 
 #include "common.h"
+#include "levelofdetail.h"
+#include "segmentbvh.h"
+#include "pathchunks.h"
 #include <QGraphicsPathItem>
+#include <memory>
 
 class TransformablePathItem : public QGraphicsPathItem,
                               public IMousePositionReceiver,
@@ -11,31 +15,55 @@ class TransformablePathItem : public QGraphicsPathItem,
 public:
     explicit TransformablePathItem(const QPainterPath &path,
                                    QGraphicsItem *parent = nullptr);
+    ~TransformablePathItem() override;
 
     /* 关键重写 */
     QRectF boundingRect() const override;
+    QRectF tightBoundingRect() const override;
+    void setPath(const QPainterPath &path);
+    // 缩小显示时按 LOD 绘制；原比例下长笔画只描边重绘区域内的分段
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                QWidget *widget = nullptr) override;
     void receiveSceneMousePosition(const QPointF &scenePos,
                                    MouseLeftClickStatus status) override;
+    // 精确的描边轮廓，第一次使用时生成并缓存
     QPainterPath shape() const override;
+    // 点选和框选走线段 BVH，不遍历整条描边轮廓
+    bool contains(const QPointF &point) const override;
+    bool collidesWithPath(const QPainterPath &path,
+                          Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+
+    /* 控制点（由 SelectionOverlay 绘制和分发鼠标事件） */
+    void paintHandles(QPainter *painter) const override;
+    int handleAt(const QPointF &pos) const override;
+    Qt::CursorShape handleCursor(int handle) const override;
+    void beginHandleDrag(int handle, const QPointF &pos) override;
+    void dragHandle(const QPointF &pos) override;
+    void endHandleDrag() override;
+    // setPath() 之后重新计算 m_geom（controlPointRect() 需要遍历整条路径）
+    void updateHandleGeometry() override;
 
 protected:
-    void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
-    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
-    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    // 选中状态、所在场景变化时通知画布场景
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
 
 private:
     enum Handle { NoHandle, RotateHandle };
-    Handle handleAt(const QPointF &pos) const;
-    void setHandleCursor(Handle h);
-    QPointF pathCenter() const;
+    void markRotateHandle(Handle h);
+
+    HandleGeometry m_geom;
 
     Handle m_currentHandle = NoHandle;
     QPointF m_mouseDownScene;
     QPointF m_center;
     qreal m_initialRotation = 0.;
+    std::unique_ptr<LodPyramid> m_lod; // 第一次缩小显示时才创建
+    std::unique_ptr<PathChunks> m_chunks; // 第一次按原比例绘制长笔画时才创建
+    const SegmentBvh &segmentBvh() const;
+    mutable std::unique_ptr<SegmentBvh> m_bvh; // 第一次命中测试时才创建
+    mutable QPainterPath m_shape;
+    mutable qreal m_shapeRadius = -1; // 生成 m_shape 时的 hitRadius（随线宽和缩放变化），-1 表示需要重新生成
 };
 
 #endif // TRANSFORMABLEPATHITEM_H
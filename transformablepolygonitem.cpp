@@ -1,109 +1,232 @@
 #include "transformablepolygonitem.h"
+#include "canvasscene.h"
 #include <QPainter>
 #include <QtMath>
 #include <QCursor>
 #include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
 
 TransformablePolygonItem::TransformablePolygonItem(const QPolygonF &poly,
                                                    QGraphicsItem *parent)
-    : QGraphicsPolygonItem(poly, parent)
+    : QGraphicsPolygonItem(parent)
 {
-    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
-    setAcceptHoverEvents(true);
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable | ItemSendsGeometryChanges);
+    setPolygon(poly);
+}
+
+TransformablePolygonItem::~TransformablePolygonItem()
+{
+    CanvasScene::itemDestroyed(this);
+}
+
+QVariant TransformablePolygonItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    CanvasScene::itemChanged(this, change);
+    return QGraphicsPolygonItem::itemChange(change, value);
+}
+
+QRectF TransformablePolygonItem::tightBoundingRect() const
+{
+    const qreal half = hitPadding(pen().widthF());
+    return m_geom.bounds.adjusted(-half, -half, half, half);
+}
+
+void TransformablePolygonItem::setPolygon(const QPolygonF &polygon)
+{
+    prepareGeometryChange();
+    m_polygon = polygon;
+    m_geom.bounds = polygon.boundingRect();
+    m_boundsLoose = false;
+    updateHandleGeometry();
+    m_grid.reset();
+    m_lod.reset();
+    invalidateHitTest();
+    update();
+    CanvasScene::itemGeometryChanged(this);
+}
+
+void TransformablePolygonItem::moveVertex(int index, const QPointF &pos)
+{
+    const int n = m_polygon.size();
+    if (index < 0 || index >= n) return;
+    const QPointF old = m_polygon.at(index);
+    if (old == pos) return;
+
+    // 填充和描边的变化都在 前一顶点-原位置-后一顶点 与 前一顶点-新位置-后一顶点 两个三角形内
+    const QPointF prev = m_polygon.at((index + n - 1) % n);
+    const QPointF next = m_polygon.at((index + 1) % n);
+    const qreal left   = qMin(qMin(prev.x(), next.x()), qMin(old.x(), pos.x()));
+    const qreal right  = qMax(qMax(prev.x(), next.x()), qMax(old.x(), pos.x()));
+    const qreal top    = qMin(qMin(prev.y(), next.y()), qMin(old.y(), pos.y()));
+    const qreal bottom = qMax(qMax(prev.y(), next.y()), qMax(old.y(), pos.y()));
+    // 尖角处的斜接最多伸出 线宽 * miterLimit / 2
+    const qreal pad = pen().widthF() * qMax<qreal>(1, pen().miterLimit()) / 2 + 1;
+    const QRectF dirty = QRectF(QPointF(left, top), QPointF(right, bottom)).adjusted(-pad, -pad, pad, pad);
+
+    const bool grows = pos.x() < m_geom.bounds.left() || pos.x() > m_geom.bounds.right()
+                    || pos.y() < m_geom.bounds.top() || pos.y() > m_geom.bounds.bottom();
+    if (grows) {
+        prepareGeometryChange();
+        m_geom.bounds = QRectF(QPointF(qMin(m_geom.bounds.left(), pos.x()), qMin(m_geom.bounds.top(), pos.y())),
+                               QPointF(qMax(m_geom.bounds.right(), pos.x()), qMax(m_geom.bounds.bottom(), pos.y())));
+        updateHandleGeometry();
+    } else if (old.x() == m_geom.bounds.left() || old.x() == m_geom.bounds.right()
+               || old.y() == m_geom.bounds.top() || old.y() == m_geom.bounds.bottom()) {
+        m_boundsLoose = true;
+    }
+
+    m_polygon[index] = pos; // 只在第一次修改时与其他副本分离
+    if (m_grid) m_grid->move(index, old, pos);
+    m_lod.reset();
+    invalidateHitTest();
+
+    if (grows) {
+        update();
+        CanvasScene::itemGeometryChanged(this);
+    } else {
+        update(dirty);
+        CanvasScene::itemRegionChanged(this, dirty);
+    }
+}
+
+void TransformablePolygonItem::settleVertices()
+{
+    if (!m_boundsLoose) return;
+    m_boundsLoose = false;
+    const QRectF exact = m_polygon.boundingRect();
+    if (exact == m_geom.bounds) return;
+    prepareGeometryChange();
+    m_geom.bounds = exact;
+    updateHandleGeometry();
+    CanvasScene::itemGeometryChanged(this);
+}
+
+const VertexGrid &TransformablePolygonItem::vertexGrid() const
+{
+    if (!m_grid) {
+        m_grid = std::make_unique<VertexGrid>(HANDLE_SIZE);
+        m_grid->build(m_polygon);
+    }
+    return *m_grid;
 }
 
 QRectF TransformablePolygonItem::boundingRect() const
 {
-    const qreal extra = HANDLE_SIZE + ROTATE_HANDLE_OFFSET;
-    return polygon().boundingRect().adjusted(-extra, -extra, extra, extra);
+    // 控制点由 SelectionOverlay 绘制，包围盒只需容纳图形本身
+    return tightBoundingRect();
+}
+
+void TransformablePolygonItem::invalidateHitTest()
+{
+    m_bvh.reset();
+    m_shapeRadius = -1;
+}
+
+const SegmentBvh &TransformablePolygonItem::segmentBvh() const
+{
+    if (!m_bvh) {
+        m_bvh = std::make_unique<SegmentBvh>();
+        m_bvh->build({m_polygon}, true);
+    }
+    return *m_bvh;
 }
 
 QPainterPath TransformablePolygonItem::shape() const
 {
-    QPainterPath p;
-    p.addPolygon(polygon().boundingRect());
-    return p;
+    // 线宽通过 setItemStyle() 直接改 pen，按线宽判断缓存是否过期
+    if (m_shapeRadius != hitRadius(pen().widthF())) {
+        QPainterPath outline;
+        outline.addPolygon(m_polygon);
+        outline.closeSubpath();
+        outline.setFillRule(fillRule());
+        m_shape = strokeShape(outline, pen());
+        m_shape.addPath(outline);
+        m_shapeRadius = hitRadius(pen().widthF());
+    }
+    return m_shape;
 }
 
-QPointF TransformablePolygonItem::nodePos(int idx) const
+bool TransformablePolygonItem::contains(const QPointF &point) const
 {
-    const QPolygonF poly = polygon();
-    return idx < poly.size() ? poly.at(idx) : QPointF();
+    const qreal radius = hitRadius(pen().widthF());
+    if (!m_geom.bounds.adjusted(-radius, -radius, radius, radius).contains(point))
+        return false;
+    const SegmentBvh &bvh = segmentBvh();
+    return bvh.containsPoint(point, fillRule()) || bvh.nearPoint(point, radius);
 }
 
-QRectF TransformablePolygonItem::handleRect(const QPointF &c) const
+bool TransformablePolygonItem::collidesWithPath(const QPainterPath &path,
+                                                Qt::ItemSelectionMode mode) const
 {
-    return QRectF(c - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2),
-                  QSize(HANDLE_SIZE, HANDLE_SIZE));
+    if (mode != Qt::IntersectsItemShape)
+        return QGraphicsPolygonItem::collidesWithPath(path, mode);
+    const qreal radius = hitRadius(pen().widthF());
+    if (!m_geom.bounds.adjusted(-radius, -radius, radius, radius).intersects(path.controlPointRect()))
+        return false;
+    // 与边相交或靠近；否则框选区域整个落在多边形内部时也算相交
+    const QPolygonF area = path.toFillPolygon();
+    const SegmentBvh &bvh = segmentBvh();
+    return bvh.nearPolygon(area, radius)
+        || (!area.isEmpty() && bvh.containsPoint(area.first(), fillRule()));
 }
 
-TransformablePolygonItem::Handle
-TransformablePolygonItem::handleAt(const QPointF &pos) const
+void TransformablePolygonItem::updateHandleGeometry()
 {
-    const QPolygonF poly = polygon();
-    for (int i = 0; i < poly.size(); ++i)
-        if (handleRect(nodePos(i)).contains(pos))
-            return static_cast<Handle>(Node0 + i);
+    m_geom.center = m_geom.bounds.center();
+    /* 旋转手柄：包围盒顶部中点上方 */
+    m_geom.rotateHandle = QPointF(m_geom.center.x(), m_geom.bounds.top() - rotateHandleOffset());
+    m_geom.rotateAnchor = m_geom.rotateHandle;
+}
 
-    /* 旋转手柄：顶点质心上方 */
-    const QPointF centroid = polygon().boundingRect().center();
-    const qreal topY = polygon().boundingRect().top();
-    const QPointF rotateHandle(centroid.x(), topY - ROTATE_HANDLE_OFFSET);
-    if (handleRect(rotateHandle).contains(pos))
+int TransformablePolygonItem::handleAt(const QPointF &pos) const
+{
+    // 顶点按网格索引查找，重叠时取离 pos 最近的顶点
+    const int vertex = vertexGrid().nearest(m_polygon, pos, handleSize() / 2);
+    if (vertex >= 0)
+        return FirstVertex + vertex;
+
+    if (handleRectAt(m_geom.rotateHandle).contains(pos))
         return RotateHandle;
     return NoHandle;
 }
 
-void TransformablePolygonItem::setHandleCursor(Handle h)
+Qt::CursorShape TransformablePolygonItem::handleCursor(int handle) const
 {
-    isRotateHandle = false;
-    switch (h) {
-    case Node0: case Node1: case Node2: case Node3:
-    case Node4: case Node5: case Node6: case Node7:
-        setCursor(Qt::CrossCursor); break;
-    case RotateHandle: isRotateHandle = true; break;
-    default: setCursor(Qt::ArrowCursor); break;
-    }
+    if (handle == RotateHandle) return Qt::SizeAllCursor;
+    if (handle >= FirstVertex) return Qt::CrossCursor;
+    return Qt::ArrowCursor;
 }
 
-void TransformablePolygonItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+void TransformablePolygonItem::markRotateHandle(int handle)
 {
-    setHandleCursor(handleAt(event->pos()));
-    QGraphicsPolygonItem::hoverMoveEvent(event);
+    isRotateHandle = (handle == RotateHandle);
 }
 
-void TransformablePolygonItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
+void TransformablePolygonItem::beginHandleDrag(int handle, const QPointF &pos)
 {
-    m_currentHandle = handleAt(event->pos());
-    if (m_currentHandle == NoHandle) {
-        QGraphicsPolygonItem::mousePressEvent(event);
-        return;
-    }
-    m_startPolygon  = polygon();
-    m_mouseDownScene= mapToScene(event->pos());
-    m_center        = polygon().boundingRect().center();
+    m_currentHandle = handle;
+    m_mouseDownScene= mapToScene(pos);
+    m_center        = m_geom.center;
     if (m_currentHandle == RotateHandle)
         m_initialRotation = rotation();
 }
 
-void TransformablePolygonItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
+void TransformablePolygonItem::dragHandle(const QPointF &pos)
 {
-    if (m_currentHandle == NoHandle) {
-        QGraphicsPolygonItem::mouseMoveEvent(event);
-        return;
-    }
-    prepareGeometryChange();
-    if (m_currentHandle == RotateHandle) return; // 广播里处理
-
-    /* 简易缩放：拖动节点即移动该顶点 */
-    const QPointF local = event->pos();
-    QPolygonF newPoly = m_startPolygon;
-    int idx = m_currentHandle - Node0;
-    if (idx >= 0 && idx < newPoly.size()) {
-        newPoly[idx] = local;
-        setPolygon(newPoly);
-        setTransformOriginPoint(newPoly.boundingRect().center());
+    if (m_currentHandle < FirstVertex)
+        return; // 旋转在广播里处理
+
+    /* 拖动节点即移动该顶点 */
+    moveVertex(m_currentHandle - FirstVertex, pos);
+}
+
+void TransformablePolygonItem::endHandleDrag()
+{
+    if (m_currentHandle >= FirstVertex) {
+        settleVertices();
+        setTransformOriginPoint(m_geom.center);
     }
+    m_currentHandle = NoHandle;
 }
 
 void TransformablePolygonItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
@@ -111,6 +234,7 @@ void TransformablePolygonItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event
     Q_UNUSED(event)
     m_currentHandle = NoHandle;
     isRotateHandling = false;
+    CanvasScene::updateMouseSubscription(this);
     QGraphicsPolygonItem::mouseReleaseEvent(event);
 }
 
@@ -122,15 +246,14 @@ void TransformablePolygonItem::receiveSceneMousePosition(
 
     if (!isUnderMouse()) {
         const QPointF ip = mapFromScene(scenePos);
-        Handle h = handleAt(ip);
-        setHandleCursor(h);
+        const int h = handleAt(ip);
+        markRotateHandle(h);
 
         if (status == MouseLeftClickStatus::PRESS
             && h == RotateHandle && !isRotateHandling) {
             m_currentHandle    = RotateHandle;
             m_mouseDownScene   = scenePos;
-            m_startPolygon     = polygon();
-            m_center           = mapToScene(polygon().boundingRect().center());
+            m_center           = mapToScene(m_geom.center);
             m_initialRotation  = rotation();
             isRotateHandling   = true;
         }
@@ -138,13 +261,14 @@ void TransformablePolygonItem::receiveSceneMousePosition(
     if (status == MouseLeftClickStatus::RELEASE) {
         m_currentHandle  = NoHandle;
         isRotateHandling = false;
+        CanvasScene::updateMouseSubscription(this);
     }
 
     if (isRotateHandling) {
         QLineF start(m_center, m_mouseDownScene);
         QLineF curr(m_center, scenePos);
         qreal angleDelta = start.angleTo(curr);
-        setTransformOriginPoint(polygon().boundingRect().center());
+        setTransformOriginPoint(m_geom.center);
         setRotation(m_initialRotation - angleDelta);
     }
 }
@@ -154,21 +278,45 @@ void TransformablePolygonItem::paint(QPainter *painter,
                                      const QStyleOptionGraphicsItem *option,
                                      QWidget *widget)
 {
-    QGraphicsPolygonItem::paint(painter, option, widget);
-    if (!isSelected()) return;
+    // 不足一个像素时画成一个点；顶点很多的多边形在缩小显示时用抽稀后的轮廓代替
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+    // 按图形本身判断，不算包围盒中的点选容差
+    const qreal half = pen().widthF() / 2;
+    if (paintCollapsed(painter, m_geom.bounds.adjusted(-half, -half, half, half), lod, pen().color()))
+        return;
+    Q_UNUSED(widget)
+    painter->setPen(pen());
+    painter->setBrush(brush());
+    const int level = LodPyramid::levelFor(lod);
+    if (level < 0 || m_polygon.size() < LodPyramid::MIN_POINTS) {
+        painter->drawPolygon(m_polygon, fillRule());
+    } else {
+        if (!m_lod) m_lod = std::make_unique<LodPyramid>();
+        painter->drawPolygon(m_lod->polygonLevel(m_polygon, level), fillRule());
+    }
+    paintSelectionOutline(painter, option, boundingRect());
+}
 
-    painter->setRenderHint(QPainter::Antialiasing);
-    painter->setPen(QPen(Qt::black, 1));
+/* ================= 控制点 ================= */
+void TransformablePolygonItem::paintHandles(QPainter *painter) const
+{
+    painter->setPen(QPen(Qt::black, 0));
     painter->setBrush(Qt::white);
 
-    /* 节点手柄 */
-    const QPolygonF poly = polygon();
-    for (int i = 0; i < poly.size(); ++i)
-        painter->drawRect(handleRect(nodePos(i)));
+    /* 节点手柄：SelectionOverlay 会把画家裁剪到重绘区域，顶点多时只画区域内的 */
+    QList<QRectF> rects;
+    if (painter->hasClipping()) {
+        const qreal half = handleSize() / 2;
+        const QRectF area = painter->clipBoundingRect().adjusted(-half, -half, half, half);
+        for (int i : vertexGrid().inRect(m_polygon, area))
+            rects.append(handleRectAt(m_polygon.at(i)));
+    } else {
+        rects.reserve(m_polygon.size());
+        for (const QPointF &p : m_polygon)
+            rects.append(handleRectAt(p));
+    }
+    painter->drawRects(rects.constData(), int(rects.size()));
 
     /* 旋转手柄 */
-    const QPointF centroid = poly.boundingRect().center();
-    const qreal topY = poly.boundingRect().top();
-    const QPointF rotateHandle(centroid.x(), topY - ROTATE_HANDLE_OFFSET);
-    painter->drawEllipse(handleRect(rotateHandle));
+    painter->drawEllipse(handleRectAt(m_geom.rotateHandle));
 }
@@ -2,7 +2,11 @@
 #define TRANSFORMABLEPOLYGONITEM_H
 
 #include "common.h"
+#include "levelofdetail.h"
+#include "vertexgrid.h"
+#include "segmentbvh.h"
 #include <QGraphicsPolygonItem>
+#include <memory>
 
 class TransformablePolygonItem : public QGraphicsPolygonItem,
                                  public IMousePositionReceiver,
@@ -11,36 +15,70 @@ class TransformablePolygonItem : public QGraphicsPolygonItem,
 public:
     explicit TransformablePolygonItem(const QPolygonF &poly = QPolygonF(),
                                       QGraphicsItem *parent = nullptr);
+    ~TransformablePolygonItem() override;
 
     /* 关键重写 */
     QRectF boundingRect() const override;
+    QRectF tightBoundingRect() const override;
+    // 顶点由本类保存（基类的多边形始终为空），包围盒随之缓存，
+    // 这样拖动单个顶点时不必复制整个多边形、也不必重绘整个图形
+    QPolygonF polygon() const { return m_polygon; }
+    void setPolygon(const QPolygonF &polygon);
+    // 移动第 index 个顶点，只重绘相邻两条边附近的区域
+    void moveVertex(int index, const QPointF &pos);
+    // 一系列 moveVertex() 之后重新计算精确的包围盒（移动期间包围盒只扩大不缩小）
+    void settleVertices();
+    // 精确形状（填充区域加描边轮廓），第一次使用时生成并缓存
+    QPainterPath shape() const override;
+    // 点选和框选走边的 BVH：内部按 fillRule() 做射线测试，描边按到边的距离判断
+    bool contains(const QPointF &point) const override;
+    bool collidesWithPath(const QPainterPath &path,
+                          Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+    // 缩小显示时按 LOD 绘制
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
                QWidget *widget = nullptr) override;
-    QPainterPath shape() const override;
 
     /* 接收来自 CustomView 的广播 */
     void receiveSceneMousePosition(const QPointF &scenePos,
                                    MouseLeftClickStatus status) override;
 
+    /* 控制点（由 SelectionOverlay 绘制和分发鼠标事件） */
+    void paintHandles(QPainter *painter) const override;
+    int handleAt(const QPointF &pos) const override;
+    Qt::CursorShape handleCursor(int handle) const override;
+    void beginHandleDrag(int handle, const QPointF &pos) override;
+    void dragHandle(const QPointF &pos) override;
+    void endHandleDrag() override;
+    // 包围盒变化后重新计算 m_geom 中的中心和旋转控制点
+    void updateHandleGeometry() override;
+
 protected:
-    void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
-    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
-    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
+    // 选中状态、所在场景变化时通知画布场景
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
     void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
 
 private:
-    enum Handle { NoHandle, Node0, Node1, Node2, Node3,
-                  Node4, Node5, Node6, Node7, RotateHandle };
-    Handle handleAt(const QPointF &pos) const;
-    void setHandleCursor(Handle h);
-    QPointF nodePos(int idx) const;
-    QRectF handleRect(const QPointF &c) const;
-
-    Handle m_currentHandle = NoHandle;
-    QPolygonF m_startPolygon;          // mousePress 时的原始多边形
+    // 控制点编号：第 i 个顶点为 FirstVertex + i，顶点数不受限制
+    enum Handle { NoHandle, RotateHandle, FirstVertex };
+    void markRotateHandle(int handle);
+    const VertexGrid &vertexGrid() const;
+    const SegmentBvh &segmentBvh() const;
+    // 顶点变化后丢弃命中测试用的缓存
+    void invalidateHitTest();
+
+    QPolygonF m_polygon;
+    HandleGeometry m_geom;             // bounds 为顶点的包围盒
+    bool m_boundsLoose = false;        // moveVertex() 之后 m_geom.bounds 可能大于实际范围
+    mutable std::unique_ptr<VertexGrid> m_grid; // 第一次命中测试时才建立
+    mutable std::unique_ptr<SegmentBvh> m_bvh;  // 同上
+    mutable QPainterPath m_shape;
+    mutable qreal m_shapeRadius = -1;   // 生成 m_shape 时的 hitRadius（随线宽和缩放变化），-1 表示需要重新生成
+
+    int m_currentHandle = NoHandle;
     QPointF m_mouseDownScene;          // mousePress 时的场景坐标
     QPointF m_center;                  // 几何中心
     qreal m_initialRotation = 0;
+    std::unique_ptr<LodPyramid> m_lod; // 第一次缩小显示时才创建
 };
 
 #endif // TRANSFORMABLEPOLYGONITEM_H
@@ -1,20 +1,44 @@
 #include "transformablerectitem.h"
+#include "canvasscene.h"
 #include <qmath.h> // for qAtan2, M_PI
 
 TransformableRectItem::TransformableRectItem(const QRectF &rect, QGraphicsItem *parent)
     : QGraphicsRectItem(rect, parent), m_currentHandle(NoHandle)
 {
     // 设置标志位
-    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable);
-    // 开启Hover事件，以便在鼠标悬停时改变光标
-    setAcceptHoverEvents(true);
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemIsFocusable | ItemSendsGeometryChanges);
+    // 控制点的悬停光标由 SelectionOverlay 负责，图元本身不接收 Hover 事件
+    updateHandleGeometry();
+}
+
+TransformableRectItem::~TransformableRectItem()
+{
+    CanvasScene::itemDestroyed(this);
+}
+
+QVariant TransformableRectItem::itemChange(GraphicsItemChange change, const QVariant &value)
+{
+    CanvasScene::itemChanged(this, change);
+    return QGraphicsRectItem::itemChange(change, value);
+}
+
+QRectF TransformableRectItem::tightBoundingRect() const
+{
+    const qreal half = pen().widthF() / 2;
+    return m_geom.bounds.adjusted(-half, -half, half, half);
+}
+
+void TransformableRectItem::setRect(const QRectF &rect)
+{
+    QGraphicsRectItem::setRect(rect);
+    updateHandleGeometry();
+    CanvasScene::itemGeometryChanged(this);
 }
 
 QRectF TransformableRectItem::boundingRect() const
 {
-    // 在原有包围盒的基础上扩大，以容纳控制点
-    qreal extra = HANDLE_SIZE + ROTATE_HANDLE_OFFSET;
-    return rect().adjusted(-extra, -extra, extra, extra);
+    // 控制点由 SelectionOverlay 绘制，包围盒只需容纳图形本身
+    return tightBoundingRect();
 }
 
 void TransformableRectItem::receiveSceneMousePosition(const QPointF &scenePos, const MouseLeftClickStatus mouseLeftClickStatus)
@@ -22,14 +46,14 @@ void TransformableRectItem::receiveSceneMousePosition(const QPointF &scenePos, c
     if (isSelected() || isRotateHandling || isRotateHandle){
         if (!this->isUnderMouse()) {
             QPointF itemPos = this->mapFromScene(scenePos);
-            Handle handle = handleAt(itemPos);
-            setHandleCursor(handle);
+            Handle handle = Handle(handleAt(itemPos));
+            markRotateHandle(handle);
 
             if (handle == Handle::RotateHandle && mouseLeftClickStatus == MouseLeftClickStatus::PRESS && !isRotateHandling) {
                 m_currentHandle = handle;
                 m_mouseDownPos = scenePos;
                 m_mouseDownRect = rect();
-                m_centerPoint = mapToScene(rect().center());
+                m_centerPoint = mapToScene(m_geom.center);
                 m_initialRotation = this->rotation();
                 isRotateHandling = true;
             }
@@ -37,6 +61,7 @@ void TransformableRectItem::receiveSceneMousePosition(const QPointF &scenePos, c
         if (mouseLeftClickStatus == MouseLeftClickStatus::RELEASE) {
             m_currentHandle = NoHandle;
             isRotateHandling = false;
+            CanvasScene::updateMouseSubscription(this); // 旋转结束，未选中的图元退出广播
         }
         if (isRotateHandling) {
             // 创建从中心点到鼠标按下点和当前点的两条线
@@ -47,7 +72,7 @@ void TransformableRectItem::receiveSceneMousePosition(const QPointF &scenePos, c
             qreal angleDelta = currentLine.angleTo(startLine);
 
             // 设置变换原点为矩形中心
-            setTransformOriginPoint(rect().center());
+            setTransformOriginPoint(m_geom.center);
             // 在初始角度的基础上，应用角度增量
             // Qt中角度逆时针为正，angleTo也是逆时针为正，所以用减法
             setRotation(m_initialRotation + angleDelta);
@@ -55,152 +80,117 @@ void TransformableRectItem::receiveSceneMousePosition(const QPointF &scenePos, c
     }
 }
 
-void TransformableRectItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+void TransformableRectItem::updateHandleGeometry()
 {
-    // 首先调用基类的paint方法绘制矩形本身
-    QGraphicsRectItem::paint(painter, option, widget);
-
-    painter->setRenderHint(QPainter::Antialiasing);
-
-    // 如果被选中，就绘制控制点
-    if (isSelected()) {
-        painter->setPen(QPen(Qt::black, 1, Qt::SolidLine));
-        painter->setBrush(Qt::white);
-
-        // 缩放控制点 (四个角)
-        painter->drawRect(rect().topLeft().x(), rect().topLeft().y(), HANDLE_SIZE, HANDLE_SIZE);
-        painter->drawRect(rect().topRight().x() - HANDLE_SIZE, rect().topRight().y(), HANDLE_SIZE, HANDLE_SIZE);
-        painter->drawRect(rect().bottomLeft().x(), rect().bottomLeft().y() - HANDLE_SIZE, HANDLE_SIZE, HANDLE_SIZE);
-        painter->drawRect(rect().bottomRight().x() - HANDLE_SIZE, rect().bottomRight().y() - HANDLE_SIZE, HANDLE_SIZE, HANDLE_SIZE);
-
-        // 旋转控制点 (顶部中心)
-        QPointF topCenter = QPointF(rect().center().x(), rect().top());
-        QPointF centerToTopVector = topCenter - rect().center();
-        qreal centerToTopVectorNorm2 = QPointF::dotProduct(centerToTopVector, centerToTopVector);
-        if(centerToTopVectorNorm2 > PRECISION){
-            centerToTopVector /= sqrt(QPointF::dotProduct(centerToTopVector, centerToTopVector));
-        }
-        QPointF rotateHandlePos = topCenter + ROTATE_HANDLE_OFFSET * centerToTopVector;
-        painter->drawLine(topCenter, rotateHandlePos);
-        painter->drawEllipse(rotateHandlePos, HANDLE_SIZE / 2, HANDLE_SIZE / 2);
+    const QRectF r = rect();
+    m_geom.bounds = r.normalized();
+    m_geom.center = r.center();
+
+    // 缩放控制点 (四个角，位于矩形内侧)
+    const qreal hs = handleSize();
+    m_geom.handles[TopLeft - 1]     = QRectF(r.topLeft(), QSizeF(hs, hs));
+    m_geom.handles[TopRight - 1]    = QRectF(r.topRight() - QPointF(hs, 0), QSizeF(hs, hs));
+    m_geom.handles[BottomLeft - 1]  = QRectF(r.bottomLeft() - QPointF(0, hs), QSizeF(hs, hs));
+    m_geom.handles[BottomRight - 1] = QRectF(r.bottomRight() - QPointF(hs, hs), QSizeF(hs, hs));
+    m_geom.handleCount = 4;
+
+    // 旋转控制点 (顶部中心上方)
+    QPointF topCenter = QPointF(r.center().x(), r.top());
+    QPointF centerToTopVector = topCenter - r.center();
+    qreal centerToTopVectorNorm2 = QPointF::dotProduct(centerToTopVector, centerToTopVector);
+    if(centerToTopVectorNorm2 > PRECISION){
+        centerToTopVector /= sqrt(centerToTopVectorNorm2);
     }
+    m_geom.rotateAnchor = topCenter;
+    m_geom.rotateHandle = topCenter + rotateHandleOffset() * centerToTopVector;
 }
 
-void TransformableRectItem::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+void TransformableRectItem::paintHandles(QPainter *painter) const
 {
-    // 判断鼠标当前位置是否在某个控制点上，并设置相应的鼠标样式
-    Handle handle = handleAt(event->pos());
-    setHandleCursor(handle);
-    QGraphicsItem::hoverMoveEvent(event);
+    painter->setPen(QPen(Qt::black, 0, Qt::SolidLine));
+    painter->setBrush(Qt::white);
+
+    // 缩放控制点 (四个角)
+    painter->drawRects(m_geom.handles.data(), m_geom.handleCount);
+
+    // 旋转控制点 (顶部中心)
+    painter->drawLine(m_geom.rotateAnchor, m_geom.rotateHandle);
+    painter->drawEllipse(m_geom.rotateHandle, handleSize() / 2, handleSize() / 2);
 }
 
-void TransformableRectItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
+void TransformableRectItem::beginHandleDrag(int handle, const QPointF &pos)
 {
-    // 判断是否按下了某个控制点
-    m_currentHandle = handleAt(event->pos());
-    if (m_currentHandle != NoHandle) {
-        m_mouseDownPos = event->pos();
-        m_mouseDownRect = rect();
-        m_centerPoint = rect().center();
-
-        // 如果是旋转操作，记录下当前的旋转角度
-        if (m_currentHandle == RotateHandle) {
-            m_initialRotation = this->rotation();
-        }
-    } else {
-        // 如果没有按下控制点，则执行基类的默认行为（例如移动图形）
-        QGraphicsRectItem::mousePressEvent(event);
+    m_currentHandle = Handle(handle);
+    m_mouseDownPos = pos;
+    m_mouseDownRect = rect();
+    m_centerPoint = m_geom.center;
+
+    // 如果是旋转操作，记录下当前的旋转角度
+    if (m_currentHandle == RotateHandle) {
+        m_initialRotation = this->rotation();
     }
 }
 
-void TransformableRectItem::mouseMoveEvent(QGraphicsSceneMouseEvent *event)
+void TransformableRectItem::dragHandle(const QPointF &pos)
 {
-    if (m_currentHandle != NoHandle) {
-        QPointF pos = event->pos();
-        prepareGeometryChange(); // 准备更新几何形状
-
-        QRectF newRect = m_mouseDownRect;
-        switch (m_currentHandle) {
-        case TopLeft: {
-            newRect.setTopLeft(pos);
-            break;
-        }
-        case TopRight: {
-            newRect.setTopRight(pos);
-            break;
-        }
-        case BottomLeft: {
-            newRect.setBottomLeft(pos);
-            break;
-        }
-        case BottomRight: {
-            newRect.setBottomRight(pos);
-            break;
-        }
-        case RotateHandle: {
-            break;
-        }
-        default: break;
-        }
-        newRect = newRect.normalized();
-        setRect(newRect);
-        setTransformOriginPoint(newRect.center());
-    } else {
-        QGraphicsRectItem::mouseMoveEvent(event);
+    QRectF newRect = m_mouseDownRect;
+    switch (m_currentHandle) {
+    case TopLeft: {
+        newRect.setTopLeft(pos);
+        break;
+    }
+    case TopRight: {
+        newRect.setTopRight(pos);
+        break;
+    }
+    case BottomLeft: {
+        newRect.setBottomLeft(pos);
+        break;
     }
+    case BottomRight: {
+        newRect.setBottomRight(pos);
+        break;
+    }
+    default: return; // 旋转在 receiveSceneMousePosition 中处理
+    }
+    newRect = newRect.normalized();
+    setRect(newRect);
+    setTransformOriginPoint(newRect.center());
 }
 
-void TransformableRectItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
+void TransformableRectItem::endHandleDrag()
 {
     m_currentHandle = NoHandle;
-    QGraphicsRectItem::mouseReleaseEvent(event);
 }
 
 // 辅助函数：判断点在哪个控制点上
-TransformableRectItem::Handle TransformableRectItem::handleAt(const QPointF &pos)
+int TransformableRectItem::handleAt(const QPointF &pos) const
 {
-    QRectF topLeftHandle(rect().topLeft(), QSizeF(HANDLE_SIZE, HANDLE_SIZE));
-    QRectF topRightHandle(rect().topRight() - QPointF(HANDLE_SIZE, 0), QSizeF(HANDLE_SIZE, HANDLE_SIZE));
-    QRectF bottomLeftHandle(rect().bottomLeft() - QPointF(0, HANDLE_SIZE), QSizeF(HANDLE_SIZE, HANDLE_SIZE));
-    QRectF bottomRightHandle(rect().bottomRight() - QPointF(HANDLE_SIZE, HANDLE_SIZE), QSizeF(HANDLE_SIZE, HANDLE_SIZE));
-
-    QPointF topCenter = QPointF(rect().center().x(), rect().top());
-    QPointF centerToTopVector = topCenter - rect().center();
-    qreal centerToTopVectorNorm2 = QPointF::dotProduct(centerToTopVector, centerToTopVector);
-    if(centerToTopVectorNorm2 > PRECISION){
-        centerToTopVector /= sqrt(QPointF::dotProduct(centerToTopVector, centerToTopVector));
-    }
-
-    QPointF rotateHandlePos = topCenter + ROTATE_HANDLE_OFFSET * centerToTopVector;
-    QRectF rotateHandle(rotateHandlePos - QPointF(HANDLE_SIZE/2, HANDLE_SIZE/2), QSizeF(HANDLE_SIZE, HANDLE_SIZE));
-
-    if (topLeftHandle.contains(pos)) return TopLeft;
-    if (topRightHandle.contains(pos)) return TopRight;
-    if (bottomLeftHandle.contains(pos)) return BottomLeft;
-    if (bottomRightHandle.contains(pos)) return BottomRight;
-    if (rotateHandle.contains(pos)) return RotateHandle;
+    const int corner = m_geom.handleIndexAt(pos);
+    if (corner >= 0) return TopLeft + corner;
+    if (handleRectAt(m_geom.rotateHandle).contains(pos)) return RotateHandle;
 
     return NoHandle;
 }
 
-// 辅助函数：根据控制点设置鼠标光标
-void TransformableRectItem::setHandleCursor(Handle handle)
+Qt::CursorShape TransformableRectItem::handleCursor(int handle) const
 {
-    isRotateHandle = false;
     switch (handle) {
     case TopLeft:
     case BottomRight:
-        setCursor(Qt::SizeFDiagCursor);
-        break;
+        return Qt::SizeFDiagCursor;
     case TopRight:
     case BottomLeft:
-        setCursor(Qt::SizeBDiagCursor);
-        break;
+        return Qt::SizeBDiagCursor;
     case RotateHandle:
-        isRotateHandle = true;
-        break;
+        return Qt::SizeAllCursor;
     default:
-        setCursor(Qt::ArrowCursor);
-        break;
+        return Qt::ArrowCursor;
     }
 }
+
+// 辅助函数：记录鼠标是否停在旋转控制点上
+void TransformableRectItem::markRotateHandle(Handle handle)
+{
+    isRotateHandle = (handle == RotateHandle);
+}
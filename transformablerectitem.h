@@ -14,18 +14,28 @@ class TransformableRectItem : public QGraphicsRectItem, public IMousePositionRec
 {
 public:
     explicit TransformableRectItem(const QRectF &rect, QGraphicsItem *parent = nullptr);
+    ~TransformableRectItem() override;
 
     // 重写关键的虚函数
-    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
     QRectF boundingRect() const override;
+    QRectF tightBoundingRect() const override;
+    // 隐藏基类的同名函数：形状变化后通知画布场景更新空间索引
+    void setRect(const QRectF &rect);
     void receiveSceneMousePosition(const QPointF &scenePos, const MouseLeftClickStatus mouseLeftClickStatus) override;
 
+    // 控制点（由 SelectionOverlay 绘制和分发鼠标事件）
+    void paintHandles(QPainter *painter) const override;
+    int handleAt(const QPointF &pos) const override;
+    Qt::CursorShape handleCursor(int handle) const override;
+    void beginHandleDrag(int handle, const QPointF &pos) override;
+    void dragHandle(const QPointF &pos) override;
+    void endHandleDrag() override;
+    // setRect() 之后重新计算 m_geom
+    void updateHandleGeometry() override;
+
 protected:
-    // 重写鼠标事件以处理控制点
-    void hoverMoveEvent(QGraphicsSceneHoverEvent *event) override;
-    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
-    void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
-    void mouseReleaseEvent(QGraphicsSceneMouseEvent *event) override;
+    // 选中状态、所在场景变化时通知画布场景
+    QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
 
 private:
     // 枚举表示不同的控制点
@@ -47,8 +57,9 @@ private:
     qreal m_initialRotation;
 
     // 辅助函数
-    void setHandleCursor(Handle handle);
-    Handle handleAt(const QPointF &pos);
+    void markRotateHandle(Handle handle);
+
+    HandleGeometry m_geom;
 };
 
 #endif // TRANSFORMABLERECTITEM_H
@@ -0,0 +1,89 @@
+#include "undocommands.h"
+#include "canvasscene.h"
+
+/* ===== 添加 ===== */
+AddItemsCommand::AddItemsCommand(QGraphicsScene *scene, const QList<QGraphicsItem*> &items,
+                                 QUndoCommand *parent)
+    : QUndoCommand("添加图元", parent), m_scene(scene), m_items(items)
+{
+}
+
+AddItemsCommand::~AddItemsCommand()
+{
+    if (m_ownsItems)
+        qDeleteAll(m_items);
+}
+
+void AddItemsCommand::undo()
+{
+    for (QGraphicsItem *item : m_items)
+        m_scene->removeItem(item);
+    m_ownsItems = true;
+}
+
+void AddItemsCommand::redo()
+{
+    // 首次入栈时图元已经在场景中了
+    for (QGraphicsItem *item : m_items)
+        if (item->scene() != m_scene)
+            m_scene->addItem(item);
+    m_ownsItems = false;
+}
+
+/* ===== 删除 ===== */
+RemoveItemsCommand::RemoveItemsCommand(QGraphicsScene *scene, const QList<QGraphicsItem*> &items,
+                                       QUndoCommand *parent)
+    : QUndoCommand("删除图元", parent), m_scene(scene), m_items(items)
+{
+}
+
+RemoveItemsCommand::~RemoveItemsCommand()
+{
+    if (m_ownsItems)
+        qDeleteAll(m_items);
+}
+
+void RemoveItemsCommand::undo()
+{
+    if (auto *cs = qobject_cast<CanvasScene*>(m_scene)) {
+        cs->restoreItems(m_items, m_stackOrders);
+    } else {
+        for (QGraphicsItem *item : m_items)
+            m_scene->addItem(item);
+    }
+    m_ownsItems = false;
+}
+
+void RemoveItemsCommand::redo()
+{
+    m_stackOrders.clear();
+    for (QGraphicsItem *item : m_items) {
+        ItemCommon *common = dynamic_cast<ItemCommon*>(item);
+        m_stackOrders.append(common ? common->stackOrder : 0);
+        m_scene->removeItem(item);
+    }
+    m_ownsItems = true;
+}
+
+/* ===== 属性修改 ===== */
+void MoveItemsCommand::apply(QGraphicsItem *item, const QPointF &pos)
+{
+    item->setPos(pos);
+}
+
+void RotateItemsCommand::apply(QGraphicsItem *item, const ItemRotation &value)
+{
+    item->setTransformOriginPoint(value.origin);
+    item->setRotation(value.rotation);
+}
+
+void ReshapeItemsCommand::apply(QGraphicsItem *item, const ItemShape &value)
+{
+    setItemGeometry(item, value.geometry);
+    item->setTransformOriginPoint(value.origin);
+}
+
+void RestyleItemsCommand::apply(QGraphicsItem *item, const ItemStyle &style)
+{
+    setItemStyle(item, style);
+}
@@ -0,0 +1,119 @@
+#ifndef UNDOCOMMANDS_H
+#define UNDOCOMMANDS_H
+
+#include <QUndoCommand>
+#include <QGraphicsScene>
+#include <QList>
+#include "itemstate.h"
+
+// 撤销重做命令：每条命令只记录受影响的图元及其操作前后的值，
+// 因此一次编辑的开销只与改动的图元数量有关，而与画布大小无关
+
+// 添加图元：撤销后图元移出场景，由命令负责释放
+class AddItemsCommand : public QUndoCommand
+{
+public:
+    AddItemsCommand(QGraphicsScene *scene, const QList<QGraphicsItem*> &items,
+                    QUndoCommand *parent = nullptr);
+    ~AddItemsCommand() override;
+
+    void undo() override;
+    void redo() override;
+
+private:
+    QGraphicsScene *m_scene;
+    QList<QGraphicsItem*> m_items;
+    bool m_ownsItems = false; // 图元当前是否不在场景中、归本命令所有
+};
+
+// 删除图元：执行后图元移出场景，由命令负责释放。撤销时图元回到删除前的堆叠位置
+class RemoveItemsCommand : public QUndoCommand
+{
+public:
+    RemoveItemsCommand(QGraphicsScene *scene, const QList<QGraphicsItem*> &items,
+                       QUndoCommand *parent = nullptr);
+    ~RemoveItemsCommand() override;
+
+    void undo() override;
+    void redo() override;
+
+private:
+    QGraphicsScene *m_scene;
+    QList<QGraphicsItem*> m_items;
+    QList<quint64> m_stackOrders; // 删除时各图元的 ItemCommon::stackOrder
+    bool m_ownsItems = false;
+};
+
+// 记录若干图元某个属性前后值的命令基类
+template <typename T>
+class ItemValueCommand : public QUndoCommand
+{
+public:
+    struct Entry {
+        QGraphicsItem *item;
+        T before;
+        T after;
+    };
+
+    ItemValueCommand(const QString &text, const QList<Entry> &entries, QUndoCommand *parent)
+        : QUndoCommand(text, parent), m_entries(entries) {}
+
+    void undo() override { for (const Entry &e : m_entries) apply(e.item, e.before); }
+    void redo() override { for (const Entry &e : m_entries) apply(e.item, e.after); }
+
+protected:
+    virtual void apply(QGraphicsItem *item, const T &value) = 0;
+
+private:
+    QList<Entry> m_entries;
+};
+
+// 旋转角度与旋转原点
+struct ItemRotation {
+    qreal rotation = 0;
+    QPointF origin;
+};
+
+// 形状与旋转原点（缩放、拖动节点时原点会随形状中心变化）
+struct ItemShape {
+    ItemGeometry geometry;
+    QPointF origin;
+};
+
+class MoveItemsCommand : public ItemValueCommand<QPointF>
+{
+public:
+    explicit MoveItemsCommand(const QList<Entry> &entries, QUndoCommand *parent = nullptr)
+        : ItemValueCommand("移动图元", entries, parent) {}
+protected:
+    void apply(QGraphicsItem *item, const QPointF &pos) override;
+};
+
+class RotateItemsCommand : public ItemValueCommand<ItemRotation>
+{
+public:
+    explicit RotateItemsCommand(const QList<Entry> &entries, QUndoCommand *parent = nullptr)
+        : ItemValueCommand("旋转图元", entries, parent) {}
+protected:
+    void apply(QGraphicsItem *item, const ItemRotation &value) override;
+};
+
+class ReshapeItemsCommand : public ItemValueCommand<ItemShape>
+{
+public:
+    explicit ReshapeItemsCommand(const QList<Entry> &entries, QUndoCommand *parent = nullptr)
+        : ItemValueCommand("变换图元", entries, parent) {}
+protected:
+    void apply(QGraphicsItem *item, const ItemShape &value) override;
+};
+
+class RestyleItemsCommand : public ItemValueCommand<ItemStyle>
+{
+public:
+    explicit RestyleItemsCommand(const QList<Entry> &entries, QUndoCommand *parent = nullptr)
+        : ItemValueCommand("修改样式", entries, parent) {}
+protected:
+    void apply(QGraphicsItem *item, const ItemStyle &style) override;
+};
+
+#endif // UNDOCOMMANDS_H
@@ -0,0 +1,91 @@
+#include "vertexgrid.h"
+#include <QtMath>
+
+qint64 VertexGrid::cellCoord(qreal v) const
+{
+    return qint64(std::floor(v / m_cell));
+}
+
+quint64 VertexGrid::key(qint64 cx, qint64 cy)
+{
+    return (quint64(quint32(cx)) << 32) | quint32(cy);
+}
+
+void VertexGrid::build(const QPolygonF &points)
+{
+    m_cells.clear();
+    for (int i = 0; i < points.size(); ++i) {
+        const QPointF &p = points.at(i);
+        m_cells[key(cellCoord(p.x()), cellCoord(p.y()))].append(i);
+    }
+}
+
+void VertexGrid::move(int index, const QPointF &from, const QPointF &to)
+{
+    const quint64 oldKey = key(cellCoord(from.x()), cellCoord(from.y()));
+    const quint64 newKey = key(cellCoord(to.x()), cellCoord(to.y()));
+    if (oldKey == newKey) return;
+
+    auto it = m_cells.find(oldKey);
+    if (it != m_cells.end()) {
+        it->removeOne(index);
+        if (it->isEmpty()) m_cells.erase(it);
+    }
+    m_cells[newKey].append(index);
+}
+
+int VertexGrid::nearest(const QPolygonF &points, const QPointF &pos, qreal radius) const
+{
+    int best = -1;
+    qreal bestDist = 0;
+    const qint64 x0 = cellCoord(pos.x() - radius), x1 = cellCoord(pos.x() + radius);
+    const qint64 y0 = cellCoord(pos.y() - radius), y1 = cellCoord(pos.y() + radius);
+    auto visit = [&](int i) {
+        const QPointF d = points.at(i) - pos;
+        if (qAbs(d.x()) > radius || qAbs(d.y()) > radius) return;
+        const qreal dist = QPointF::dotProduct(d, d);
+        if (best < 0 || dist < bestDist || (dist == bestDist && i < best)) {
+            best = i;
+            bestDist = dist;
+        }
+    };
+    // 视图缩得很小时 radius 远大于格子，覆盖的格子比顶点还多时直接遍历顶点
+    if ((x1 - x0 + 1) * (y1 - y0 + 1) > qint64(points.size())) {
+        for (int i = 0; i < points.size(); ++i)
+            visit(i);
+        return best;
+    }
+    for (qint64 cx = x0; cx <= x1; ++cx) {
+        for (qint64 cy = y0; cy <= y1; ++cy) {
+            auto it = m_cells.constFind(key(cx, cy));
+            if (it == m_cells.cend()) continue;
+            for (int i : *it)
+                visit(i);
+        }
+    }
+    return best;
+}
+
+QList<int> VertexGrid::inRect(const QPolygonF &points, const QRectF &rect) const
+{
+    QList<int> result;
+    const qint64 x0 = cellCoord(rect.left()), x1 = cellCoord(rect.right());
+    const qint64 y0 = cellCoord(rect.top()), y1 = cellCoord(rect.bottom());
+    // 区域覆盖的格子比顶点还多时直接遍历顶点
+    if ((x1 - x0 + 1) * (y1 - y0 + 1) > qint64(points.size())) {
+        for (int i = 0; i < points.size(); ++i)
+            if (rect.contains(points.at(i)))
+                result.append(i);
+        return result;
+    }
+    for (qint64 cx = x0; cx <= x1; ++cx) {
+        for (qint64 cy = y0; cy <= y1; ++cy) {
+            auto it = m_cells.constFind(key(cx, cy));
+            if (it == m_cells.cend()) continue;
+            for (int i : *it)
+                if (rect.contains(points.at(i)))
+                    result.append(i);
+        }
+    }
+    return result;
+}
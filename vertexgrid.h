@@ -0,0 +1,31 @@
+#ifndef VERTEXGRID_H
+#define VERTEXGRID_H
+
+#include <QPolygonF>
+#include <QHash>
+#include <QList>
+
+// 顶点的均匀网格索引（图元坐标），用于控制点的命中测试和按区域取顶点。
+// 只保存顶点下标，坐标仍从调用方传入的 points 中读取；顶点移动时调用 move() 增量更新
+class VertexGrid
+{
+public:
+    explicit VertexGrid(qreal cellSize) : m_cell(cellSize) {}
+
+    void build(const QPolygonF &points);
+    void move(int index, const QPointF &from, const QPointF &to);
+
+    // 与 pos 的横纵距离都不超过 radius 的顶点中离 pos 最近的一个（相同时取下标小的），没有时返回 -1
+    int nearest(const QPolygonF &points, const QPointF &pos, qreal radius) const;
+    // 落在 rect 内的顶点下标（不排序）
+    QList<int> inRect(const QPolygonF &points, const QRectF &rect) const;
+
+private:
+    qint64 cellCoord(qreal v) const;
+    static quint64 key(qint64 cx, qint64 cy);
+
+    qreal m_cell;
+    QHash<quint64, QList<int>> m_cells;
+};
+
+#endif // VERTEXGRID_H